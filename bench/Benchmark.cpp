@@ -0,0 +1,309 @@
+#include "Benchmark.hpp"
+#include "../src/BackupIndex.hpp"
+#include "../src/ChunkStore.hpp"
+#include "../src/DeltaChain.hpp"
+#include "../src/LevelPack.hpp"
+#include "../src/ParseCC.hpp"
+#include "../src/SaveDecode.hpp"
+#include "../src/Zstd.hpp"
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+using namespace bench;
+
+static size_t getConfigValue(matjson::Value const& json, std::string_view key, size_t fallback) {
+    if (json.contains(key)) {
+        if (auto value = json[key].asInt()) {
+            return static_cast<size_t>(*value);
+        }
+    }
+    return fallback;
+}
+
+// How a save file in a backup actually ended up being stored, since every 
+// storage falls back to a plain copy for files it can't handle
+static std::string_view getStoredAs(Storage const& storage, std::filesystem::path const& dir, std::string_view name) {
+    auto has = [&](std::string_view ext) {
+        auto path = dir / name;
+        path += ext;
+        return storage.exists(path);
+    };
+    if (has(ChunkStore::MANIFEST_EXT)) {
+        return "chunks";
+    }
+    if (has(DeltaChain::DELTA_EXT)) {
+        return "delta";
+    }
+    if (has(DeltaChain::LINK_EXT)) {
+        return "keyframe";
+    }
+    if (has(zstd::EXT)) {
+        return "zstd";
+    }
+    if (has(LevelPack::TABLE_EXT)) {
+        return "level-pack";
+    }
+    return storage.exists(dir / name) ? "copy" : "missing";
+}
+
+BenchmarkConfig bench::loadConfig(std::filesystem::path const& path) {
+    auto config = BenchmarkConfig();
+    auto json = file::readJson(path).unwrapOrDefault();
+    config.save.starCount = static_cast<int>(getConfigValue(json, "star-count", config.save.starCount));
+    config.save.savedLevels = getConfigValue(json, "saved-levels", config.save.savedLevels);
+    config.save.levelCount = getConfigValue(json, "level-count", config.save.levelCount);
+    config.save.levelSize = getConfigValue(json, "level-size", config.save.levelSize);
+    config.save.seed = getConfigValue(json, "seed", config.save.seed);
+    config.iterations = std::max<size_t>(1, getConfigValue(json, "iterations", config.iterations));
+    config.backupCount = getConfigValue(json, "backup-count", config.backupCount);
+    return config;
+}
+
+namespace {
+    class BenchmarkSuite final {
+    private:
+        BenchmarkConfig m_config;
+        std::filesystem::path m_dir;
+        std::vector<matjson::Value> m_results;
+
+        // Times `run` a few times. `bytes` is how much data one run goes 
+        // through, if that makes sense for it
+        template <class F>
+        Result<> measure(std::string const& name, size_t iterations, size_t bytes, F&& run) {
+            std::vector<double> times;
+            for (size_t i = 0; i < iterations; i += 1) {
+                auto start = std::chrono::steady_clock::now();
+                auto res = run(i);
+                if (!res) {
+                    return Err("{} failed: {}", name, res.unwrapErr());
+                }
+                times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            }
+            std::sort(times.begin(), times.end());
+            auto median = times[times.size() / 2];
+            auto result = matjson::makeObject({
+                { "name", name },
+                { "iterations", iterations },
+                { "min-ms", times.front() },
+                { "median-ms", median },
+                { "mean-ms", std::accumulate(times.begin(), times.end(), 0.0) / times.size() },
+                { "max-ms", times.back() },
+            });
+            if (bytes) {
+                result.set("bytes", bytes);
+                result.set("mb-per-second", median > 0 ? bytes / 1'000'000.0 / (median / 1000) : 0.0);
+            }
+            log::info("{}: {:.2f} ms", name, median);
+            m_results.push_back(std::move(result));
+            return Ok();
+        }
+
+        BackupOptions makeOptions(BackupStorage storage) const {
+            auto options = BackupOptions();
+            options.meta = m_config.meta;
+            options.saveDir = m_dir / "save";
+            options.storage = storage;
+            return options;
+        }
+
+        Result<matjson::Value> generateSaves() {
+            auto saveDir = m_dir / "save";
+            GEODE_UNWRAP(file::createDirectoryAll(saveDir));
+            GEODE_UNWRAP_INTO(auto gm, generateGameManager(saveDir / "CCGameManager.dat", m_config.save));
+            GEODE_UNWRAP_INTO(auto ll, generateLocalLevels(saveDir / "CCLocalLevels.dat", m_config.save));
+            std::error_code ec;
+            return Ok(matjson::makeObject({
+                { "game-manager-data-size", gm.dataSize },
+                { "game-manager-file-size", std::filesystem::file_size(saveDir / "CCGameManager.dat", ec) },
+                { "local-levels-data-size", ll.dataSize },
+                { "local-levels-file-size", std::filesystem::file_size(saveDir / "CCLocalLevels.dat", ec) },
+            }));
+        }
+
+        // Lots of tiny backups, since listing and cleaning up only ever look 
+        // at metadata and folder sizes
+        Result<> generateBackups(std::filesystem::path const& dir) {
+            auto smallSave = m_dir / "small-save.dat";
+            auto options = m_config.save;
+            options.savedLevels = 0;
+            GEODE_UNWRAP(generateGameManager(smallSave, options));
+            for (size_t i = 0; i < m_config.backupCount; i += 1) {
+                auto backup = dir / fmt::format("backup-{}", i);
+                GEODE_UNWRAP(file::createDirectoryAll(backup));
+                std::error_code ec;
+                std::filesystem::copy_file(smallSave, backup / "CCGameManager.dat", ec);
+                if (ec) {
+                    return Err("Unable to create backup: {}", ec.message());
+                }
+                auto meta = m_config.meta;
+                meta.time = m_config.meta.time - std::chrono::hours(i);
+                GEODE_UNWRAP(file::writeToJson(backup / "metadata.json", meta));
+                GEODE_UNWRAP(file::writeString(backup / "auto-remove.txt", ""));
+            }
+            return Ok();
+        }
+
+    public:
+        BenchmarkSuite(BenchmarkConfig config, std::filesystem::path const& dir)
+          : m_config(std::move(config)), m_dir(dir) {}
+
+        Result<matjson::Value> run() {
+            auto its = m_config.iterations;
+            auto& disk = *Storage::local();
+            GEODE_UNWRAP_INTO(auto saves, this->generateSaves());
+            auto saveDir = m_dir / "save";
+            auto gmSize = static_cast<size_t>(saves["game-manager-data-size"].asInt().unwrapOr(0));
+            auto llSize = static_cast<size_t>(saves["local-levels-data-size"].asInt().unwrapOr(0));
+
+            GEODE_UNWRAP(this->measure("parse-game-manager", its, gmSize, [&](size_t) -> Result<> {
+                GEODE_UNWRAP(cc::parseCompressedCCFile(disk, saveDir / "CCGameManager.dat"));
+                return Ok();
+            }));
+            GEODE_UNWRAP(this->measure("parse-local-levels", its, llSize, [&](size_t) -> Result<> {
+                GEODE_UNWRAP(cc::parseCompressedCCFile(disk, saveDir / "CCLocalLevels.dat"));
+                return Ok();
+            }));
+            GEODE_UNWRAP(this->measure("stream-local-levels", its, llSize, [&](size_t) -> Result<> {
+                return cc::streamCompressedCCFile(disk, saveDir / "CCLocalLevels.dat", [](std::string_view) {});
+            }));
+
+            // Backups are made and read both on disk and in memory, so the 
+            // difference between the two is the time spent on I/O
+            auto memory = MemoryStorage();
+            GEODE_UNWRAP(memory.load(saveDir, saveDir));
+            std::pair<std::string_view, Storage*> targets[] = {
+                { "", &disk },
+                { "-memory", &memory },
+            };
+
+            std::pair<std::string_view, BackupStorage> storages[] = {
+                { "copies", BackupStorage::Copies },
+                { "deduplicated", BackupStorage::Deduplicated },
+                { "delta", BackupStorage::Delta },
+                { "zstd", BackupStorage::Zstd },
+                { "levels", BackupStorage::Levels },
+            };
+            std::optional<std::filesystem::path> firstBackup;
+            std::optional<uint64_t> middleLevel;
+            for (auto [name, storage] : storages) {
+                for (auto [suffix, target] : targets) {
+                    auto backupsDir = m_dir / fmt::format("backups-{}", name);
+                    GEODE_UNWRAP(target->createDirectories(backupsDir));
+                    auto options = this->makeOptions(storage);
+                    std::filesystem::path latest;
+                    GEODE_UNWRAP(this->measure(fmt::format("create-backup-{}{}", name, suffix), its, gmSize + llSize, [&](size_t) -> Result<> {
+                        GEODE_UNWRAP_INTO(auto created, core::writeBackup(*target, backupsDir, options));
+                        latest = created.entry.path;
+                        if (!firstBackup && target == &disk) {
+                            firstBackup = created.entry.path;
+                        }
+                        return Ok();
+                    }));
+                    m_results.back().set("bytes-on-disk", target->size(backupsDir));
+                    m_results.back().set("stored-as", matjson::makeObject({
+                        { "CCGameManager.dat", getStoredAs(*target, latest, "CCGameManager.dat") },
+                        { "CCLocalLevels.dat", getStoredAs(*target, latest, "CCLocalLevels.dat") },
+                    }));
+
+                    auto restoreDir = m_dir / "restored";
+                    GEODE_UNWRAP(target->createDirectories(restoreDir));
+                    GEODE_UNWRAP(this->measure(fmt::format("restore-backup-{}{}", name, suffix), its, gmSize + llSize, [&](size_t) -> Result<> {
+                        return core::restoreBackup(*target, latest, restoreDir);
+                    }));
+
+                    if (!middleLevel) {
+                        GEODE_UNWRAP_INTO(auto levels, core::computeLevels(*target, latest));
+                        if (levels.empty()) {
+                            return Err("Generated save has no levels");
+                        }
+                        middleLevel = levels[levels.size() / 2].hash;
+                    }
+                    GEODE_UNWRAP(this->measure(fmt::format("extract-level-{}{}", name, suffix), its, 0, [&](size_t) -> Result<> {
+                        GEODE_UNWRAP(core::extractLevels(*target, latest, { *middleLevel }));
+                        return Ok();
+                    }));
+                }
+            }
+            GEODE_UNWRAP(this->measure("load-info", its, gmSize + llSize, [&](size_t) -> Result<> {
+                GEODE_UNWRAP_INTO(auto info, core::computeInfo(disk, *firstBackup));
+                if (info.starCount != m_config.save.starCount) {
+                    return Err("Read {} stars instead of {}", info.starCount, m_config.save.starCount);
+                }
+                return Ok();
+            }));
+
+            auto manyDir = m_dir / "many-backups";
+            GEODE_UNWRAP(this->generateBackups(manyDir));
+            GEODE_UNWRAP(memory.load(manyDir, manyDir));
+            for (auto [suffix, target] : targets) {
+                GEODE_UNWRAP(this->measure(fmt::format("scan-backups-unindexed{}", suffix), its, 0, [&](size_t) -> Result<> {
+                    (void)target->remove(manyDir / BackupIndex::FILE_NAME);
+                    if (core::scanBackups(*target, manyDir).size() != m_config.backupCount) {
+                        return Err("Not every backup was found");
+                    }
+                    return Ok();
+                }));
+                GEODE_UNWRAP(this->measure(fmt::format("scan-backups-indexed{}", suffix), its, 0, [&](size_t) -> Result<> {
+                    if (core::scanBackups(*target, manyDir).size() != m_config.backupCount) {
+                        return Err("Not every backup was found");
+                    }
+                    return Ok();
+                }));
+                GEODE_UNWRAP(this->measure(fmt::format("folder-size{}", suffix), its, 0, [&](size_t) -> Result<> {
+                    (void)target->size(manyDir);
+                    return Ok();
+                }));
+                // Only reads metadata, so this is mostly scanning
+                GEODE_UNWRAP(this->measure(fmt::format("plan-retention{}", suffix), its, 0, [&](size_t) -> Result<> {
+                    auto policy = RetentionPolicy { .keepLast = 5, .keepDaily = 7, .keepWeekly = 4, .keepMonthly = 12 };
+                    auto plan = core::planRetention(core::scanBackups(*target, manyDir), policy);
+                    if (plan.kept.size() + plan.removed.size() != m_config.backupCount) {
+                        return Err("Not every backup was planned for");
+                    }
+                    return Ok();
+                }));
+                // Deletes things, so this can only be measured once. Keeps 
+                // the default limit of automated backups
+                GEODE_UNWRAP(this->measure(fmt::format("cleanup-automated{}", suffix), 1, 0, [&](size_t) -> Result<> {
+                    auto policy = RetentionPolicy { .keepLast = 5 };
+                    auto cleanup = core::cleanupAutomated(*target, manyDir, core::scanBackups(*target, manyDir), policy);
+                    if (cleanup.kept.size() != 5) {
+                        return Err("Not every backup was removed");
+                    }
+                    return Ok();
+                }));
+            }
+
+            auto results = matjson::Value::array();
+            for (auto& result : m_results) {
+                results.push(result);
+            }
+            return Ok(matjson::makeObject({
+                { "version", BACKUPS_VERSION },
+                { "time", std::chrono::duration_cast<std::chrono::seconds>(Clock::now().time_since_epoch()).count() },
+                { "decode-kernel", cc::getDecodeKernelName(cc::getBestDecodeKernel()) },
+                { "config", matjson::makeObject({
+                    { "star-count", m_config.save.starCount },
+                    { "saved-levels", m_config.save.savedLevels },
+                    { "level-count", m_config.save.levelCount },
+                    { "level-size", m_config.save.levelSize },
+                    { "seed", m_config.save.seed },
+                    { "iterations", m_config.iterations },
+                    { "backup-count", m_config.backupCount },
+                }) },
+                { "saves", saves },
+                { "results", results },
+            }));
+        }
+    };
+}
+
+Result<matjson::Value> bench::run(BenchmarkConfig const& config, std::filesystem::path const& scratch) {
+    std::error_code ec;
+    std::filesystem::remove_all(scratch, ec);
+    GEODE_UNWRAP(file::createDirectoryAll(scratch));
+    auto results = BenchmarkSuite(config, scratch).run();
+    std::filesystem::remove_all(scratch, ec);
+    return results;
+}
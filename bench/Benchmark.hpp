@@ -0,0 +1,22 @@
+#pragma once
+
+#include "SaveGenerator.hpp"
+#include "../src/BackupCore.hpp"
+
+namespace bench {
+    struct BenchmarkConfig final {
+        SaveGeneratorOptions save;
+        size_t iterations = 5;
+        // Amount of (small) backups for listing, sizing and cleaning up
+        size_t backupCount = 2000;
+        BackupMetadata meta;
+    };
+
+    // Read from a JSON file, if it exists. Keys are the same as the field 
+    // names in kebab-case
+    BenchmarkConfig loadConfig(std::filesystem::path const& path);
+
+    // Generate saves and time the hot paths of the backup core against them 
+    // in a scratch directory, which is removed afterwards
+    Result<matjson::Value> run(BenchmarkConfig const& config, std::filesystem::path const& scratch);
+}
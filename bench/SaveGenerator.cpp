@@ -0,0 +1,184 @@
+#include "SaveGenerator.hpp"
+#include <fstream>
+#include <functional>
+#include <zlib-ng.h>
+
+static constexpr std::string_view BASE64_URL = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+static constexpr size_t PIECE_SIZE = 256 * 1024;
+
+namespace {
+    // xorshift64*, so the same seed always gives the same save
+    class Random final {
+    private:
+        uint64_t m_state;
+
+    public:
+        Random(uint64_t seed) : m_state(seed ? seed : 1) {}
+
+        uint64_t next() {
+            m_state ^= m_state >> 12;
+            m_state ^= m_state << 25;
+            m_state ^= m_state >> 27;
+            return m_state * 0x2545F4914F6CDD1Dull;
+        }
+        size_t below(size_t max) {
+            return static_cast<size_t>(next() % max);
+        }
+    };
+
+    // Encodes XML into a save file the same way the game does, as it comes in
+    class SaveWriter final {
+    private:
+        std::ofstream m_file;
+        zng_stream m_stream {};
+        bool m_deflating = false;
+        // Base64 works on groups of 3 bytes, so up to 2 are held back
+        std::string m_pending;
+        std::string m_encoded;
+        std::vector<uint8_t> m_deflated = std::vector<uint8_t>(PIECE_SIZE);
+        bench::GeneratedSave m_stats;
+
+        Result<> flushEncoded() {
+            for (auto& c : m_encoded) {
+                c ^= 11;
+            }
+            m_file.write(m_encoded.data(), m_encoded.size());
+            m_stats.fileSize += m_encoded.size();
+            m_encoded.clear();
+            if (!m_file) {
+                return Err("Unable to write save file");
+            }
+            return Ok();
+        }
+        void encode(uint8_t const* data, size_t size, bool last) {
+            m_pending.append(reinterpret_cast<char const*>(data), size);
+            size_t i = 0;
+            for (; i + 3 <= m_pending.size(); i += 3) {
+                uint32_t bits =
+                    static_cast<uint8_t>(m_pending[i]) << 16 |
+                    static_cast<uint8_t>(m_pending[i + 1]) << 8 |
+                    static_cast<uint8_t>(m_pending[i + 2]);
+                m_encoded += BASE64_URL[bits >> 18];
+                m_encoded += BASE64_URL[(bits >> 12) & 63];
+                m_encoded += BASE64_URL[(bits >> 6) & 63];
+                m_encoded += BASE64_URL[bits & 63];
+            }
+            m_pending.erase(0, i);
+            if (last && !m_pending.empty()) {
+                uint32_t bits = static_cast<uint8_t>(m_pending[0]) << 16;
+                if (m_pending.size() == 2) {
+                    bits |= static_cast<uint8_t>(m_pending[1]) << 8;
+                }
+                m_encoded += BASE64_URL[bits >> 18];
+                m_encoded += BASE64_URL[(bits >> 12) & 63];
+                m_encoded += m_pending.size() == 2 ? BASE64_URL[(bits >> 6) & 63] : '=';
+                m_encoded += '=';
+                m_pending.clear();
+            }
+        }
+        Result<> compress(std::string_view data, int flush) {
+            m_stream.next_in = reinterpret_cast<uint8_t const*>(data.data());
+            m_stream.avail_in = static_cast<uint32_t>(data.size());
+            do {
+                m_stream.next_out = m_deflated.data();
+                m_stream.avail_out = static_cast<uint32_t>(m_deflated.size());
+                auto res = zng_deflate(&m_stream, flush);
+                if (res == Z_STREAM_ERROR) {
+                    return Err("Unable to compress save data");
+                }
+                this->encode(m_deflated.data(), m_deflated.size() - m_stream.avail_out, res == Z_STREAM_END);
+                GEODE_UNWRAP(this->flushEncoded());
+            } while (m_stream.avail_out == 0);
+            return Ok();
+        }
+
+    public:
+        SaveWriter(std::filesystem::path const& path) : m_file(path, std::ios::binary) {
+            // Gzip header like the game uses
+            m_deflating = zng_deflateInit2(&m_stream, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+        }
+        SaveWriter(SaveWriter const&) = delete;
+        ~SaveWriter() {
+            if (m_deflating) {
+                zng_deflateEnd(&m_stream);
+            }
+        }
+
+        Result<> write(std::string_view xml) {
+            if (!m_file || !m_deflating) {
+                return Err("Unable to create save file");
+            }
+            m_stats.dataSize += xml.size();
+            return this->compress(xml, Z_NO_FLUSH);
+        }
+        Result<bench::GeneratedSave> finish() {
+            GEODE_UNWRAP(this->compress({}, Z_FINISH));
+            m_file.close();
+            return Ok(m_stats);
+        }
+    };
+}
+
+static void appendRandomBase64(std::string& out, Random& random, size_t size) {
+    for (size_t i = 0; i < size; i += 1) {
+        out += BASE64_URL[random.below(64)];
+    }
+}
+
+// Feeds the writer whenever enough XML has piled up
+static Result<bench::GeneratedSave> generate(
+    std::filesystem::path const& path, size_t count, std::string_view header, std::string_view footer,
+    std::function<void(std::string&, size_t)> const& appendItem
+) {
+    auto writer = SaveWriter(path);
+    std::string xml;
+    xml += R"(<?xml version="1.0"?><plist version="1.0" gjver="2.0"><dict>)";
+    xml += header;
+    for (size_t i = 0; i < count; i += 1) {
+        appendItem(xml, i);
+        if (xml.size() >= PIECE_SIZE) {
+            GEODE_UNWRAP(writer.write(xml));
+            xml.clear();
+        }
+    }
+    xml += footer;
+    xml += "</dict></plist>";
+    GEODE_UNWRAP(writer.write(xml));
+    return writer.finish();
+}
+
+Result<bench::GeneratedSave> bench::generateGameManager(std::filesystem::path const& path, SaveGeneratorOptions const& options) {
+    auto random = Random(options.seed);
+    auto header = fmt::format(
+        "<k>GS_value</k><d><k>1</k><s>{}</s><k>2</k><s>{}</s><k>6</k><s>{}</s><k>8</k><s>{}</s></d>"
+        "<k>playerName</k><s>Player</s><k>playerFrame</k><i>{}</i><k>playerColor</k><i>{}</i>"
+        "<k>playerColor2</k><i>{}</i><k>playerGlow</k><t /><k>GLM_03</k><d>",
+        random.below(1'000'000), random.below(100'000), options.starCount, random.below(1000),
+        1 + random.below(400), random.below(100), random.below(100)
+    );
+    return generate(path, options.savedLevels, header, "</d>", [&](std::string& xml, size_t i) {
+        auto id = 100'000 + random.below(100'000'000);
+        xml += fmt::format(
+            "<k>{}</k><d><k>kCEK</k><i>4</i><k>k1</k><i>{}</i><k>k2</k><s>Online Level {}</s>"
+            "<k>k5</k><s>Creator{}</s><k>k18</k><i>{}</i><k>k23</k><i>{}</i><k>k3</k><s>",
+            id, id, i, random.below(10'000), random.below(100), random.below(6)
+        );
+        // Descriptions are base64 too
+        appendRandomBase64(xml, random, 40 + random.below(80));
+        xml += "</s></d>";
+    });
+}
+
+Result<bench::GeneratedSave> bench::generateLocalLevels(std::filesystem::path const& path, SaveGeneratorOptions const& options) {
+    auto random = Random(options.seed ^ 0x9E3779B97F4A7C15ull);
+    return generate(path, options.levelCount, "<k>LLM_01</k><d><k>_isArr</k><t />", "</d><k>LLM_02</k><i>38</i>", [&](std::string& xml, size_t i) {
+        xml += fmt::format(
+            "<k>k_{}</k><d><k>kCEK</k><i>4</i><k>k2</k><s>Level {}</s><k>k5</k><s>Player</s>"
+            "<k>k13</k><t /><k>k21</k><i>2</i><k>k16</k><i>{}</i><k>k80</k><i>{}</i><k>k4</k><s>H4sIAAAAAAAAC",
+            i, i, 1 + random.below(20), random.below(100'000)
+        );
+        // Level strings are gzipped and base64 encoded, so they look random
+        appendRandomBase64(xml, random, options.levelSize);
+        xml += "</s></d>";
+    });
+}
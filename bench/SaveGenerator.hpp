@@ -0,0 +1,29 @@
+#pragma once
+
+#include "../src/Platform.hpp"
+#include <cstdint>
+#include <filesystem>
+
+namespace bench {
+    struct SaveGeneratorOptions final {
+        int starCount = 5000;
+        // Online levels saved in CCGameManager, which is most of its size
+        size_t savedLevels = 500;
+        size_t levelCount = 100;
+        // Bytes of (already compressed) level data per created level
+        size_t levelSize = 64 * 1024;
+        uint64_t seed = 1;
+    };
+
+    struct GeneratedSave final {
+        // Size of the XML inside
+        size_t dataSize = 0;
+        size_t fileSize = 0;
+    };
+
+    // Write saves in GD's format (gzip, URL-safe base64, XOR 11) that look 
+    // enough like real ones for everything the mod reads. Data is produced 
+    // and encoded piece by piece, so saves can be hundreds of MB
+    Result<GeneratedSave> generateGameManager(std::filesystem::path const& path, SaveGeneratorOptions const& options);
+    Result<GeneratedSave> generateLocalLevels(std::filesystem::path const& path, SaveGeneratorOptions const& options);
+}
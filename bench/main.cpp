@@ -0,0 +1,36 @@
+#include "Benchmark.hpp"
+
+static constexpr std::string_view USAGE = R"(Usage: backups-bench <results-dir> [config]
+
+Generates saves and times making, restoring, listing and cleaning up backups
+of them. Results are written as JSON to the results directory, which is also
+where the scratch files go while running. The config is a JSON file with any
+of these keys:
+  star-count, saved-levels, level-count, level-size, seed, iterations,
+  backup-count
+)";
+
+static Result<std::filesystem::path> runBenchmarks(std::filesystem::path const& dir, bench::BenchmarkConfig const& config) {
+    GEODE_UNWRAP_INTO(auto json, bench::run(config, dir / "scratch"));
+    auto path = dir / fmt::format("{}-{}.json", BACKUPS_VERSION, json["time"].asInt().unwrapOr(0));
+    GEODE_UNWRAP(file::writeString(path, json.dump()));
+    return Ok(path);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        fmt::print(stderr, "{}", USAGE);
+        return 2;
+    }
+    log::setLevel(log::Severity::Info);
+
+    auto config = argc > 2 ? bench::loadConfig(argv[2]) : bench::BenchmarkConfig();
+    config.meta.user = "backups-bench";
+    auto res = runBenchmarks(argv[1], config);
+    if (!res) {
+        fmt::print(stderr, "error: benchmarks failed: {}\n", res.unwrapErr());
+        return 1;
+    }
+    fmt::print("Results saved to {}\n", *res);
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include "../src/SaveDecode.hpp"
+#include <cppcodec/base64_url.hpp>
+#include <cppcodec/base64_url_unpadded.hpp>
+#include <random>
+
+// Checks every decode kernel the CPU supports against cppcodec, which is what
+// saves were decoded with before the kernels existed. Runs with a fixed seed
+// so failures can be reproduced
+
+static constexpr size_t ITERATIONS = 2000;
+static constexpr size_t MAX_SIZE = 300;
+static constexpr cc::DecodeKernel KERNELS[] = {
+    cc::DecodeKernel::Scalar,
+    cc::DecodeKernel::SSE41,
+    cc::DecodeKernel::AVX2,
+};
+static constexpr std::string_view ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// Decodes the way the game's files were read before: XOR, then base64
+static std::optional<std::vector<uint8_t>> decodeReference(std::string encoded, uint8_t key) {
+    for (auto& c : encoded) {
+        c ^= key;
+    }
+    try {
+        if (encoded.ends_with('=')) {
+            return cppcodec::base64_url::decode(encoded.data(), encoded.size());
+        }
+        return cppcodec::base64_url_unpadded::decode(encoded.data(), encoded.size());
+    }
+    catch (cppcodec::parse_error const&) {
+        return std::nullopt;
+    }
+}
+
+static std::optional<std::vector<uint8_t>> decodeKernel(
+    std::string const& xored, uint8_t key, cc::DecodeKernel kernel, bool inPlace
+) {
+    std::vector<uint8_t> in(xored.begin(), xored.end());
+    std::vector<uint8_t> out(inPlace ? 0 : in.size());
+    auto& target = inPlace ? in : out;
+    auto written = cc::decodeXorBase64(in.data(), in.size(), target.data(), key, kernel);
+    if (!written) {
+        return std::nullopt;
+    }
+    target.resize(*written);
+    return target;
+}
+
+int main() {
+    std::mt19937 rng(2024);
+    size_t failures = 0;
+    size_t checked = 0;
+
+    auto check = [&](std::string const& encoded, uint8_t key, std::string_view what) {
+        auto xored = encoded;
+        for (auto& c : xored) {
+            c ^= key;
+        }
+        auto expected = decodeReference(xored, key);
+        for (auto kernel : KERNELS) {
+            if (!cc::isDecodeKernelSupported(kernel)) {
+                continue;
+            }
+            for (bool inPlace : { false, true }) {
+                auto got = decodeKernel(xored, key, kernel, inPlace);
+                checked += 1;
+                // Input cppcodec rejects has to be rejected by every kernel
+                // too, or corrupted saves would be read as garbage
+                if (got.has_value() != expected.has_value() || (got && *got != *expected)) {
+                    failures += 1;
+                    fmt::print(
+                        "{} kernel {} ({}) differs on {} of {} characters with key {}\n",
+                        cc::getDecodeKernelName(kernel), inPlace ? "in place" : "out of place",
+                        !expected ? "should fail" : !got ? "failed" : "wrong output",
+                        what, encoded.size(), key
+                    );
+                }
+            }
+        }
+    };
+
+    std::uniform_int_distribution<size_t> sizeDist(0, MAX_SIZE);
+    std::uniform_int_distribution<int> byteDist(0, 255);
+    std::uniform_int_distribution<size_t> symbolDist(0, ALPHABET.size() - 1);
+    for (size_t i = 0; i < ITERATIONS; i += 1) {
+        uint8_t key = i % 2 ? 11 : 0;
+
+        std::vector<uint8_t> data(sizeDist(rng));
+        for (auto& b : data) {
+            b = static_cast<uint8_t>(byteDist(rng));
+        }
+        check(cppcodec::base64_url::encode(data.data(), data.size()), key, "padded data");
+        check(cppcodec::base64_url_unpadded::encode(data.data(), data.size()), key, "unpadded data");
+
+        // Random symbols, so some lengths can't be base64 at all
+        std::string symbols(sizeDist(rng), '\0');
+        for (auto& c : symbols) {
+            c = ALPHABET[symbolDist(rng)];
+        }
+        check(symbols, key, "random symbols");
+
+        // A stray character anywhere has to fail the same as cppcodec
+        if (!symbols.empty()) {
+            auto broken = symbols;
+            broken[std::uniform_int_distribution<size_t>(0, broken.size() - 1)(rng)] = "!+/.~"[i % 5];
+            check(broken, key, "an invalid character");
+        }
+    }
+
+    // Big enough that the vector loops run many times over
+    std::vector<uint8_t> large(1 << 20);
+    for (auto& b : large) {
+        b = static_cast<uint8_t>(byteDist(rng));
+    }
+    check(cppcodec::base64_url::encode(large.data(), large.size()), 11, "large data");
+
+    fmt::print("{} decodes checked, {} failed\n", checked, failures);
+    return failures ? 1 : 0;
+}
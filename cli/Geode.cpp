@@ -0,0 +1,123 @@
+#include "Geode.hpp"
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+
+using namespace geode;
+
+static std::atomic<log::Severity> LOG_LEVEL = log::Severity::Warning;
+// Import workers log from several threads at once
+static std::mutex LOG_MUTEX;
+
+void log::setLevel(Severity level) {
+    LOG_LEVEL = level;
+}
+void log::write(Severity severity, std::string_view message) {
+    if (severity < LOG_LEVEL) {
+        return;
+    }
+    std::string_view prefix;
+    switch (severity) {
+        case Severity::Debug: prefix = "debug"; break;
+        case Severity::Info: prefix = "info"; break;
+        case Severity::Warning: prefix = "warning"; break;
+        case Severity::Error: prefix = "error"; break;
+    }
+    std::lock_guard lock(LOG_MUTEX);
+    fmt::print(stderr, "{}: {}\n", prefix, message);
+}
+
+Result<std::string> file::readString(std::filesystem::path const& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return Err("Unable to open file");
+    }
+    std::string data;
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    if (!ec) {
+        data.reserve(size);
+    }
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (in.bad()) {
+        return Err("Unable to read file");
+    }
+    return Ok(std::move(data));
+}
+Result<ByteVector> file::readBinary(std::filesystem::path const& path) {
+    GEODE_UNWRAP_INTO(auto data, readString(path));
+    return Ok(ByteVector(data.begin(), data.end()));
+}
+Result<> file::writeString(std::filesystem::path const& path, std::string const& data) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        return Err("Unable to open file");
+    }
+    out.write(data.data(), data.size());
+    if (!out) {
+        return Err("Unable to write file");
+    }
+    return Ok();
+}
+Result<> file::writeBinary(std::filesystem::path const& path, ByteVector const& data) {
+    return writeString(path, std::string(data.begin(), data.end()));
+}
+Result<> file::createDirectoryAll(std::filesystem::path const& path) {
+    std::error_code ec;
+    std::filesystem::create_directories(path, ec);
+    if (ec) {
+        return Err("Unable to create directory: {} (code {})", ec.message(), ec.value());
+    }
+    return Ok();
+}
+Result<std::vector<std::filesystem::path>> file::readDirectory(std::filesystem::path const& path, bool recursive) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(path, ec)) {
+        return Err("Not a directory");
+    }
+    std::vector<std::filesystem::path> entries;
+    if (recursive) {
+        for (auto& entry : std::filesystem::recursive_directory_iterator(path, ec)) {
+            entries.push_back(entry.path());
+        }
+    }
+    else {
+        for (auto& entry : std::filesystem::directory_iterator(path, ec)) {
+            entries.push_back(entry.path());
+        }
+    }
+    if (ec) {
+        return Err("Unable to read directory: {} (code {})", ec.message(), ec.value());
+    }
+    return Ok(std::move(entries));
+}
+Result<matjson::Value> file::readJson(std::filesystem::path const& path) {
+    GEODE_UNWRAP_INTO(auto data, readString(path));
+    auto json = matjson::parse(data);
+    if (!json) {
+        return Err("Unable to parse JSON");
+    }
+    return Ok(std::move(*json));
+}
+
+JsonExpectedValue::Field JsonExpectedValue::has(std::string_view key) {
+    return Field(*this, m_value.contains(key) ? &m_value[key] : nullptr, key);
+}
+JsonExpectedValue::Field JsonExpectedValue::needs(std::string_view key) {
+    if (!m_value.contains(key)) {
+        this->fail(fmt::format("missing \"{}\"", key));
+        return Field(*this, nullptr, key);
+    }
+    return Field(*this, &m_value[key], key);
+}
+void JsonExpectedValue::fail(std::string error) {
+    if (!m_error) {
+        m_error = std::move(error);
+    }
+}
+
+JsonExpectedValue geode::checkJson(matjson::Value const& value, std::string_view name) {
+    return JsonExpectedValue(value, name);
+}
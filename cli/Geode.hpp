@@ -0,0 +1,133 @@
+#pragma once
+
+// The parts of Geode the backup core uses, for building it without the game.
+// Results and JSON come from the same standalone libraries Geode itself is
+// built on; logging and file utilities are reimplemented here
+#include <Geode/Result.hpp>
+#include <matjson.hpp>
+#include <matjson/std.hpp>
+#include <fmt/format.h>
+#include <fmt/chrono.h>
+#include <fmt/std.h>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace geode {
+    // Geode's Err also takes a format string
+    template <class... Args> requires (sizeof...(Args) > 0)
+    inline auto Err(fmt::format_string<Args...> format, Args&&... args) {
+        return Err(fmt::format(format, std::forward<Args>(args)...));
+    }
+
+    using ByteVector = std::vector<uint8_t>;
+
+    namespace log {
+        enum class Severity {
+            Debug,
+            Info,
+            Warning,
+            Error,
+        };
+
+        // Messages less severe than this aren't printed. Defaults to warnings
+        void setLevel(Severity level);
+        void write(Severity severity, std::string_view message);
+
+        template <class... Args>
+        void debug(fmt::format_string<Args...> format, Args&&... args) {
+            write(Severity::Debug, fmt::format(format, std::forward<Args>(args)...));
+        }
+        template <class... Args>
+        void info(fmt::format_string<Args...> format, Args&&... args) {
+            write(Severity::Info, fmt::format(format, std::forward<Args>(args)...));
+        }
+        template <class... Args>
+        void warn(fmt::format_string<Args...> format, Args&&... args) {
+            write(Severity::Warning, fmt::format(format, std::forward<Args>(args)...));
+        }
+        template <class... Args>
+        void error(fmt::format_string<Args...> format, Args&&... args) {
+            write(Severity::Error, fmt::format(format, std::forward<Args>(args)...));
+        }
+    }
+
+    namespace utils::file {
+        Result<std::string> readString(std::filesystem::path const& path);
+        Result<ByteVector> readBinary(std::filesystem::path const& path);
+        Result<> writeString(std::filesystem::path const& path, std::string const& data);
+        Result<> writeBinary(std::filesystem::path const& path, ByteVector const& data);
+        Result<> createDirectoryAll(std::filesystem::path const& path);
+        Result<std::vector<std::filesystem::path>> readDirectory(std::filesystem::path const& path, bool recursive = false);
+        Result<matjson::Value> readJson(std::filesystem::path const& path);
+
+        template <class T>
+        Result<T> readFromJson(std::filesystem::path const& path) {
+            GEODE_UNWRAP_INTO(auto json, readJson(path));
+            return json.template as<T>();
+        }
+        template <class T>
+        Result<> writeToJson(std::filesystem::path const& path, T const& value) {
+            return writeString(path, matjson::Value(value).dump());
+        }
+    }
+    namespace file = utils::file;
+
+    // Only what the core's JSON deserializers use of Geode's JsonValidation
+    class JsonExpectedValue final {
+    private:
+        matjson::Value const& m_value;
+        std::string m_name;
+        std::optional<std::string> m_error;
+
+    public:
+        class Field final {
+        private:
+            JsonExpectedValue& m_parent;
+            matjson::Value const* m_value;
+            std::string_view m_key;
+
+        public:
+            Field(JsonExpectedValue& parent, matjson::Value const* value, std::string_view key)
+              : m_parent(parent), m_value(value), m_key(key) {}
+
+            template <class T>
+            void into(T& target) {
+                if (!m_value) {
+                    return;
+                }
+                if (auto value = m_value->template as<T>()) {
+                    target = std::move(*value);
+                }
+                else {
+                    m_parent.fail(fmt::format("\"{}\" has the wrong type", m_key));
+                }
+            }
+        };
+
+        JsonExpectedValue(matjson::Value const& value, std::string_view name)
+          : m_value(value), m_name(name) {}
+
+        // Missing keys are skipped
+        Field has(std::string_view key);
+        // Missing keys are an error
+        Field needs(std::string_view key);
+        void fail(std::string error);
+
+        template <class T>
+        Result<T> ok(T value) {
+            if (m_error) {
+                return Err("{}: {}", m_name, *m_error);
+            }
+            return Ok(std::move(value));
+        }
+    };
+
+    JsonExpectedValue checkJson(matjson::Value const& value, std::string_view name);
+
+    namespace prelude {
+        using namespace ::geode;
+    }
+}
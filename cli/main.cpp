@@ -0,0 +1,437 @@
+#include "../src/BackupCore.hpp"
+#include "../src/Import.hpp"
+#include "../src/LevelIndex.hpp"
+#include <algorithm>
+#include <charconv>
+#include <unordered_map>
+#include <unordered_set>
+
+static constexpr std::string_view USAGE = R"(Usage: backups-cli <command> [options]
+
+Commands:
+  list <backups-dir>
+      List the backups in a backups directory, newest first
+  info <backup>
+      Show what's in a backup
+  create <backups-dir> --save-dir <dir>
+      Back up the save files in a save directory
+        --storage <copies|deduplicated|delta|zstd|levels>  (default: copies)
+        --name <name>
+        --user <user>                Who the backup is listed as being made by
+        --auto                       Mark the backup as automated
+        --skip-unchanged             Don't back up save files that haven't
+                                     changed since the latest backup
+        --cleanup-limit <n>          --limit mentioned in auto-remove.txt (default: 5)
+        --keyframe-interval <n>      Delta backups in a row before a full copy (default: 10)
+        --zstd-level <n>             (default: 9)
+        --zstd-dictionary            Train and use a shared zstd dictionary
+  restore <backup> --save-dir <dir>
+      Overwrite the save files in a save directory with the backup's. The
+      game should be closed
+  prune <backups-dir>
+      Delete the automated backups none of these keep. Periods are in UTC
+        --limit <n>                  Newest automated backups (default: 5)
+        --hourly <n>                 Newest automated backup of each of the
+        --daily <n>                  latest n hours, days, weeks and months
+        --weekly <n>                 that have one (default: 0)
+        --monthly <n>
+        --size-limit <bytes>         Delete the oldest automated backups until
+                                     all backups fit, keeping the newest
+        --dry-run                    Only list what would be deleted
+  import <from> <backups-dir> [--user <user>]
+      Move every backup found inside a folder into a backups directory
+  find-level <backups-dir> <query>
+      List the backups that have a level, by name, online ID or #hash.
+      Backups that haven't had their levels indexed yet are indexed first
+  extract-level <backup> <#hash>...
+      Print levels from a backup exactly as they're stored in the save, one
+      per line. Hashes are the ones find-level shows
+
+Options:
+  -v, --verbose                      Print what's being done
+)";
+
+// Options that don't take a value
+static const std::unordered_set<std::string> FLAGS = {
+    "auto", "zstd-dictionary", "skip-unchanged", "dry-run", "verbose"
+};
+
+namespace {
+    struct Args final {
+        std::string command;
+        std::vector<std::string> positional;
+        std::unordered_map<std::string, std::string> options;
+        std::unordered_set<std::string> flags;
+
+        bool has(std::string const& flag) const {
+            return flags.contains(flag);
+        }
+        std::optional<std::string> get(std::string const& option) const {
+            auto value = options.find(option);
+            if (value == options.end()) {
+                return std::nullopt;
+            }
+            return value->second;
+        }
+        Result<std::string> need(std::string const& option) const {
+            if (auto value = this->get(option)) {
+                return Ok(*value);
+            }
+            return Err("Missing --{}", option);
+        }
+        Result<std::filesystem::path> path(size_t index, std::string_view what) const {
+            if (index >= positional.size()) {
+                return Err("Missing {}", what);
+            }
+            std::error_code ec;
+            auto path = std::filesystem::absolute(positional[index], ec).lexically_normal();
+            // Backups find the rest of their backups directory through their 
+            // parent, which "backup/" wouldn't give
+            if (!path.has_filename()) {
+                path = path.parent_path();
+            }
+            return Ok(std::move(path));
+        }
+        template <class T>
+        Result<T> number(std::string const& option, T fallback) const {
+            auto value = this->get(option);
+            if (!value) {
+                return Ok(fallback);
+            }
+            T result {};
+            auto [end, ec] = std::from_chars(value->data(), value->data() + value->size(), result);
+            if (ec != std::errc() || end != value->data() + value->size()) {
+                return Err("--{} should be a number", option);
+            }
+            return Ok(result);
+        }
+    };
+}
+
+static Result<Args> parseArgs(int argc, char** argv) {
+    auto args = Args();
+    for (int i = 1; i < argc; i += 1) {
+        std::string_view arg = argv[i];
+        if (arg == "-v") {
+            args.flags.insert("verbose");
+            continue;
+        }
+        if (!arg.starts_with("--")) {
+            if (args.command.empty()) {
+                args.command = arg;
+            }
+            else {
+                args.positional.emplace_back(arg);
+            }
+            continue;
+        }
+        arg.remove_prefix(2);
+        auto eq = arg.find('=');
+        auto name = std::string(arg.substr(0, eq));
+        if (FLAGS.contains(name)) {
+            args.flags.insert(name);
+        }
+        else if (eq != std::string_view::npos) {
+            args.options[name] = arg.substr(eq + 1);
+        }
+        else if (i + 1 < argc) {
+            args.options[name] = argv[i += 1];
+        }
+        else {
+            return Err("--{} needs a value", name);
+        }
+    }
+    return Ok(std::move(args));
+}
+
+static std::string formatSize(std::optional<size_t> size) {
+    if (!size) {
+        return "?";
+    }
+    if (*size < 1000) {
+        return fmt::format("{} B", *size);
+    }
+    if (*size < 1000 * 1000) {
+        return fmt::format("{:.1f} KB", *size / 1000.0);
+    }
+    if (*size < 1000 * 1000 * 1000) {
+        return fmt::format("{:.1f} MB", *size / 1000.0 / 1000.0);
+    }
+    return fmt::format("{:.2f} GB", *size / 1000.0 / 1000.0 / 1000.0);
+}
+static std::string formatTime(Time time) {
+    return fmt::format("{:%Y-%m-%d %H:%M} UTC", std::chrono::floor<std::chrono::minutes>(time));
+}
+
+static Result<BackupStorage> parseStorage(std::string_view storage) {
+    if (storage == "copies") {
+        return Ok(BackupStorage::Copies);
+    }
+    if (storage == "deduplicated") {
+        return Ok(BackupStorage::Deduplicated);
+    }
+    if (storage == "delta") {
+        return Ok(BackupStorage::Delta);
+    }
+    if (storage == "zstd") {
+        return Ok(BackupStorage::Zstd);
+    }
+    if (storage == "levels") {
+        return Ok(BackupStorage::Levels);
+    }
+    return Err("Unknown storage \"{}\"", storage);
+}
+
+// The CLI only ever works on local folders
+static Storage& storage() {
+    static auto local = Storage::local();
+    return *local;
+}
+
+static Result<> requireBackup(std::filesystem::path const& path) {
+    if (!core::isBackup(storage(), path)) {
+        return Err("{} is not a backup", path.string());
+    }
+    return Ok();
+}
+
+static Result<> runList(Args const& args) {
+    GEODE_UNWRAP_INTO(auto dir, args.path(0, "backups directory"));
+    auto backups = core::scanBackups(storage(), dir);
+    for (auto& entry : backups) {
+        fmt::print(
+            "{:<24} {:<20} {:<16} {:>10}{}{}\n",
+            entry.path.filename().string(), formatTime(entry.meta.time),
+            entry.meta.user.empty() ? "-" : entry.meta.user, formatSize(entry.meta.size),
+            entry.autoRemove ? "  auto" : "",
+            entry.meta.name ? fmt::format("  \"{}\"", *entry.meta.name) : ""
+        );
+    }
+    fmt::print("{} backups\n", backups.size());
+    return Ok();
+}
+
+static Result<> runInfo(Args const& args) {
+    GEODE_UNWRAP_INTO(auto path, args.path(0, "backup"));
+    GEODE_UNWRAP(requireBackup(path));
+    auto entry = BackupEntry::load(storage(), path);
+    GEODE_UNWRAP_INTO(auto info, core::loadInfo(storage(), path));
+    if (entry.meta.name) {
+        fmt::print("Name:         {}\n", *entry.meta.name);
+    }
+    fmt::print("User:         {}\n", entry.meta.user.empty() ? "-" : entry.meta.user);
+    fmt::print("Time:         {}\n", formatTime(entry.meta.time));
+    fmt::print("Size:         {}\n", formatSize(entry.meta.size));
+    fmt::print("Automated:    {}\n", entry.autoRemove ? "yes" : "no");
+    fmt::print("Deduplicated: {}\n", core::isDeduplicated(storage(), path) ? "yes" : "no");
+    if (info.hasGameManager) {
+        fmt::print("Stars:        {}\n", info.starCount);
+        fmt::print(
+            "Icon:         {} (colors {} and {}{})\n",
+            info.playerIcon, info.playerColor1, info.playerColor2,
+            info.playerGlow.has_value() ? ", glow" : ""
+        );
+    }
+    else {
+        fmt::print("No CCGameManager.dat\n");
+    }
+    if (info.hasLocalLevels) {
+        fmt::print("Levels:       {}\n", info.levelCount);
+        for (auto& level : info.levels) {
+            fmt::print("  {}\n", level);
+        }
+        if (info.levelCount > info.levels.size()) {
+            fmt::print("  ...and {} more\n", info.levelCount - info.levels.size());
+        }
+    }
+    else {
+        fmt::print("No CCLocalLevels.dat\n");
+    }
+    return Ok();
+}
+
+static Result<> runCreate(Args const& args) {
+    GEODE_UNWRAP_INTO(auto dir, args.path(0, "backups directory"));
+    auto options = BackupOptions();
+    GEODE_UNWRAP_INTO(auto saveDir, args.need("save-dir"));
+    options.saveDir = saveDir;
+    GEODE_UNWRAP_INTO(options.storage, parseStorage(args.get("storage").value_or("copies")));
+    options.meta.name = args.get("name");
+    options.meta.user = args.get("user").value_or("");
+    options.autoRemove = args.has("auto");
+    GEODE_UNWRAP_INTO(options.retention.keepLast, args.number<size_t>("cleanup-limit", 5));
+    GEODE_UNWRAP_INTO(options.keyframeInterval, args.number<size_t>("keyframe-interval", options.keyframeInterval));
+    GEODE_UNWRAP_INTO(options.zstdLevel, args.number<int>("zstd-level", options.zstdLevel));
+    options.zstdDictionary = args.has("zstd-dictionary");
+
+    std::error_code ec;
+    if (!std::filesystem::is_directory(options.saveDir, ec)) {
+        return Err("{} is not a directory", options.saveDir.string());
+    }
+    GEODE_UNWRAP(storage().createDirectories(dir));
+    if (args.has("skip-unchanged")) {
+        auto backups = core::scanBackups(storage(), dir);
+        if (!backups.empty() && core::isUnchanged(storage(), options.saveDir, backups.front().path)) {
+            fmt::print("Save files haven't changed since {}, skipped\n", backups.front().path.filename().string());
+            return Ok();
+        }
+    }
+    GEODE_UNWRAP_INTO(auto created, core::writeBackup(storage(), dir, options));
+    fmt::print("Created {} ({})\n", created.entry.path.string(), formatSize(created.entry.meta.size));
+    if (created.chunkBytes) {
+        fmt::print("Added {} of new chunks\n", formatSize(created.chunkBytes));
+    }
+    return Ok();
+}
+
+static Result<> runRestore(Args const& args) {
+    GEODE_UNWRAP_INTO(auto path, args.path(0, "backup"));
+    GEODE_UNWRAP(requireBackup(path));
+    GEODE_UNWRAP_INTO(auto saveDir, args.need("save-dir"));
+    std::error_code ec;
+    if (!std::filesystem::is_directory(saveDir, ec)) {
+        return Err("{} is not a directory", saveDir);
+    }
+    GEODE_UNWRAP(core::restoreBackup(storage(), path, saveDir));
+    fmt::print("Restored {} to {}\n", path.filename().string(), saveDir);
+    return Ok();
+}
+
+static Result<> runPrune(Args const& args) {
+    GEODE_UNWRAP_INTO(auto dir, args.path(0, "backups directory"));
+    auto policy = RetentionPolicy();
+    GEODE_UNWRAP_INTO(policy.keepLast, args.number<size_t>("limit", policy.keepLast));
+    GEODE_UNWRAP_INTO(policy.keepHourly, args.number<size_t>("hourly", 0));
+    GEODE_UNWRAP_INTO(policy.keepDaily, args.number<size_t>("daily", 0));
+    GEODE_UNWRAP_INTO(policy.keepWeekly, args.number<size_t>("weekly", 0));
+    GEODE_UNWRAP_INTO(policy.keepMonthly, args.number<size_t>("monthly", 0));
+    GEODE_UNWRAP_INTO(policy.byteBudget, args.number<size_t>("size-limit", 0));
+
+    if (args.has("dry-run")) {
+        std::optional<size_t> totalSize;
+        if (policy.byteBudget) {
+            totalSize = core::measureSizes(storage(), dir).total;
+        }
+        auto plan = core::planRetention(core::scanBackups(storage(), dir), policy, totalSize);
+        for (auto& entry : plan.removed) {
+            fmt::print(
+                "Would remove {} ({}, {})\n",
+                entry.path.filename().string(), formatTime(entry.meta.time), formatSize(entry.meta.size)
+            );
+        }
+        fmt::print(
+            "Would remove {} backups ({}), {} kept ({})\n",
+            plan.removed.size(), formatSize(plan.removedBytes), plan.kept.size(), formatSize(plan.keptBytes)
+        );
+        return Ok();
+    }
+    auto cleanup = core::cleanupAutomated(storage(), dir, core::scanBackups(storage(), dir), policy);
+    for (auto& entry : cleanup.removed) {
+        fmt::print("Removed {}\n", entry.path.filename().string());
+    }
+    fmt::print(
+        "Removed {} backups, {} kept ({} of chunks freed)\n",
+        cleanup.removed.size(), cleanup.kept.size(), formatSize(cleanup.freedChunkBytes)
+    );
+    if (cleanup.detachedBytes) {
+        fmt::print("Delta backups made whole grew by {}\n", formatSize(cleanup.detachedBytes));
+    }
+    return Ok();
+}
+
+static Result<> runImport(Args const& args) {
+    GEODE_UNWRAP_INTO(auto from, args.path(0, "folder to import from"));
+    GEODE_UNWRAP_INTO(auto dir, args.path(1, "backups directory"));
+    GEODE_UNWRAP(storage().createDirectories(dir));
+    auto progress = ImportProgress();
+    auto summary = BackupImporter::run(storage(), from, dir, args.get("user").value_or(""), progress);
+    for (auto& failure : progress.takeFailures()) {
+        fmt::print("Unable to import {}: {}\n", failure.path.string(), failure.error);
+    }
+    fmt::print("Imported {} backups, {} failed\n", summary.imported, summary.failed);
+    if (summary.failed) {
+        return Err("Some backups couldn't be imported");
+    }
+    return Ok();
+}
+
+static Result<> runFindLevel(Args const& args) {
+    GEODE_UNWRAP_INTO(auto dir, args.path(0, "backups directory"));
+    if (args.positional.size() < 2) {
+        return Err("Missing query");
+    }
+    auto index = LevelIndex::sync(storage(), dir, core::scanBackups(storage(), dir));
+    auto results = index.search(args.positional[1]);
+    for (auto result : results) {
+        fmt::print(
+            "{} (ID {}, version {}, #{:016x})\n",
+            result->level.name, result->level.id, result->level.version, result->level.hash
+        );
+        for (auto& backup : result->backups) {
+            fmt::print("  {}\n", backup);
+        }
+    }
+    fmt::print("{} versions found in {} backups\n", results.size(), index.getBackupCount());
+    return Ok();
+}
+
+static Result<> runExtractLevel(Args const& args) {
+    GEODE_UNWRAP_INTO(auto path, args.path(0, "backup"));
+    GEODE_UNWRAP(requireBackup(path));
+    if (args.positional.size() < 2) {
+        return Err("Missing level hash");
+    }
+    std::unordered_set<uint64_t> hashes;
+    for (size_t i = 1; i < args.positional.size(); i += 1) {
+        std::string_view arg = args.positional[i];
+        if (arg.starts_with('#')) {
+            arg.remove_prefix(1);
+        }
+        uint64_t hash = 0;
+        auto [end, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), hash, 16);
+        if (ec != std::errc() || end != arg.data() + arg.size()) {
+            return Err("{} is not a level hash", args.positional[i]);
+        }
+        hashes.insert(hash);
+    }
+    GEODE_UNWRAP_INTO(auto levels, core::extractLevels(storage(), path, std::move(hashes)));
+    for (auto& level : levels) {
+        fmt::print("{}\n", level);
+    }
+    return Ok();
+}
+
+int main(int argc, char** argv) {
+    auto args = parseArgs(argc, argv);
+    if (!args) {
+        fmt::print(stderr, "{}\n\n{}", args.unwrapErr(), USAGE);
+        return 2;
+    }
+    if (args->has("verbose")) {
+        log::setLevel(log::Severity::Info);
+    }
+
+    using Command = Result<>(*)(Args const&);
+    std::pair<std::string_view, Command> commands[] = {
+        { "list", &runList },
+        { "info", &runInfo },
+        { "create", &runCreate },
+        { "restore", &runRestore },
+        { "prune", &runPrune },
+        { "import", &runImport },
+        { "find-level", &runFindLevel },
+        { "extract-level", &runExtractLevel },
+    };
+    for (auto [name, command] : commands) {
+        if (args->command == name) {
+            auto res = command(*args);
+            if (!res) {
+                fmt::print(stderr, "error: {}\n", res.unwrapErr());
+                return 1;
+            }
+            return 0;
+        }
+    }
+    fmt::print(stderr, "{}", USAGE);
+    return args->command.empty() || args->command == "help" ? 0 : 2;
+}
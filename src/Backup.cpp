@@ -1,96 +1,32 @@
-#include <pugixml.hpp>
 #include "Backup.hpp"
-#include "ParseCC.hpp"
-#include <Geode/utils/JsonValidation.hpp>
-#include <Geode/utils/file.hpp>
-#include <matjson/std.hpp>
+#include "BackupIndex.hpp"
+#include <Geode/binding/DS_Dictionary.hpp>
+#include <Geode/binding/GameManager.hpp>
+#include <Geode/binding/GJGameLevel.hpp>
+#include <Geode/binding/LocalLevelManager.hpp>
 #include <Geode/loader/Dirs.hpp>
 #include <Geode/loader/Mod.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <unordered_map>
 
-// Thanks Globed devs
-// this is to ensure we are using pugixml v1.15 or whatever
-static_assert(std::is_trivially_destructible_v<pugi::xml_node>);
-
-matjson::Value matjson::Serialize<BackupMetadata>::toJson(BackupMetadata const& info) {
-    return matjson::makeObject({
-        { "name", info.name },
-        { "user", info.user },
-        { "time", std::chrono::duration_cast<std::chrono::hours>(info.time.time_since_epoch()).count() },
-    });
-}
-Result<BackupMetadata> matjson::Serialize<BackupMetadata>::fromJson(matjson::Value const& value) {
-    auto info = BackupMetadata();
-    auto json = checkJson(value, "BackupMetadata");
-    json.has("name").into(info.name);
-    json.needs("user").into(info.user);
-    int time;
-    json.needs("time").into(time);
-    info.time = Time(std::chrono::hours(time));
-    return json.ok(info);
+static std::filesystem::path getLiveSaveDir() {
+    #ifdef GEODE_IS_IOS
+    return dirs::getSaveDir().parent_path();
+    #else
+    return dirs::getSaveDir();
+    #endif
 }
 
-Backup::Backup(std::filesystem::path const& path) : m_path(path) {
-    if (auto meta = file::readFromJson<BackupMetadata>(path / "metadata.json")) {
-        m_meta = *meta;
-    }
-    // Fix corrupt metadata
-    else {
-        std::error_code ec;
-        auto time = std::chrono::time_point_cast<Time::duration>(
-            std::filesystem::last_write_time(path, ec) - std::chrono::file_clock::now() + Clock::now()
-        );
-        (void)file::writeToJson(path / "metadata.json", BackupMetadata(time));
-    }
-    std::error_code ec;
-    if (std::filesystem::exists(path / "auto-remove.txt", ec)) {
+Backup::Backup(BackupEntry const& entry) : m_path(entry.path), m_meta(entry.meta) {
+    if (entry.autoRemove) {
         m_autoRemoveOrder = 0;
     }
     this->autorelease();
 }
 
-Result<> Backup::migrate(std::filesystem::path const& backupsDir, std::filesystem::path const& existingDir) {
-    GEODE_UNWRAP(file::createDirectoryAll(backupsDir));
-
-    // Try to infer backup creation date from folder write time
-    std::error_code ec;
-    auto time = std::chrono::time_point_cast<Time::duration>(
-        std::filesystem::last_write_time(existingDir, ec) - std::chrono::file_clock::now() + Clock::now()
-    );
-
-    std::string dirname;
-    try {
-        // fmt::format uses exceptions :sob:
-        dirname = fmt::format("{:%Y-%m-%d_%H-%M}", time);
-    }
-    catch(...) {
-        dirname = "unktime";
-    }
-
-    std::string findname = dirname;
-    size_t num = 0;
-    while (std::filesystem::exists(backupsDir / findname)) {
-        findname = dirname + "-" + std::to_string(num);
-        num += 1;
-    }
-
-    auto dir = backupsDir / findname;
-
-    std::filesystem::rename(existingDir, dir, ec);
-    if (ec) {
-        return Err("Unable to migrate backup: {} (code {})", ec.message(), ec.value());
-    }
-    // Save metadata
-    GEODE_UNWRAP(file::writeToJson(dir / "metadata.json", BackupMetadata(time)));
-
-    return Ok();
-}
-
-bool Backup::isBackup(std::filesystem::path const& path) {
-    return 
-        std::filesystem::exists(path / "CCGameManager.dat") || 
-        std::filesystem::exists(path / "CCLocalLevels.dat");
-}
-
 std::filesystem::path Backup::getPath() const {
     return m_path;
 }
@@ -103,11 +39,24 @@ std::string Backup::getUser() const {
 std::chrono::hours Backup::getTimeSince() const {
     return std::chrono::duration_cast<std::chrono::hours>(Clock::now() - m_meta.time);
 }
+std::optional<size_t> Backup::getSize() const {
+    return m_meta.size;
+}
+BackupEntry Backup::getEntry() const {
+    auto entry = BackupEntry();
+    entry.path = m_path;
+    entry.meta = m_meta;
+    entry.autoRemove = m_autoRemoveOrder.has_value();
+    return entry;
+}
 bool Backup::hasLocalLevels() const {
-    return std::filesystem::exists(m_path / "CCLocalLevels.dat");
+    return core::hasSaveFile(*Backups::get()->m_storage, m_path, "CCLocalLevels.dat");
 }
 bool Backup::hasGameManager() const {
-    return std::filesystem::exists(m_path / "CCGameManager.dat");
+    return core::hasSaveFile(*Backups::get()->m_storage, m_path, "CCGameManager.dat");
+}
+bool Backup::isDeduplicated() const {
+    return core::isDeduplicated(*Backups::get()->m_storage, m_path);
 }
 
 bool Backup::isAutoRemove() const {
@@ -117,95 +66,125 @@ std::optional<size_t> Backup::getAutoRemoveOrder() const {
     return m_autoRemoveOrder;
 }
 void Backup::preserve() {
-    std::error_code ec;
-    std::filesystem::remove(m_path / "auto-remove.txt", ec);
-    if (!ec) {
+    auto& storage = *Backups::get()->m_storage;
+    auto stamp = BackupIndex::begin(storage, m_path.parent_path());
+    if (storage.remove(m_path / "auto-remove.txt")) {
         m_autoRemoveOrder = std::nullopt;
+        BackupIndex::update(storage, m_path.parent_path(), stamp, this->getEntry());
+        Backups::get()->updateAutoRemoveOrder();
     }
 }
 
-arc::Future<BackupInfo> Backup::loadInfo() {
-    auto info = BackupInfo();
-
-    auto ccgmData = (co_await async::runtime().spawnBlocking<Result<std::string>>([path = m_path] {
-        return cc::parseCompressedCCFile(path / "CCGameManager.dat");
-    })).unwrapOrDefault();
+std::shared_ptr<InfoRequest> Backup::requestInfo(InfoPriority priority) const {
+    return Backups::get()->m_infoLoader.request(m_path, priority);
+}
 
-    pugi::xml_document ccgm;
-    if (ccgm.load_buffer(ccgmData.data(), ccgmData.size())) {
-        if (auto find = ccgm.select_single_node(
-            "//k[normalize-space()=\"GS_value\"]/following-sibling::d/k[normalize-space()=\"6\"]/following-sibling::s"
-        )) {
-            info.starCount = find.node().text().as_int();
-        }
-        if (auto find = ccgm.select_single_node(
-            "//k[normalize-space()=\"playerFrame\"]/following-sibling::i"
-        )) {
-            info.playerIcon = find.node().text().as_int();
-        }
-        if (auto find = ccgm.select_single_node(
-            "//k[normalize-space()=\"playerColor\"]/following-sibling::i"
-        )) {
-            info.playerColor1 = find.node().text().as_int();
-        }
-        if (auto find = ccgm.select_single_node(
-            "//k[normalize-space()=\"playerColor2\"]/following-sibling::i"
-        )) {
-            info.playerColor2 = find.node().text().as_int();
-        }
-        if (ccgm.select_single_node(
-            "//k[normalize-space()=\"playerGlow\"]/following-sibling::t"
-        )) {
-            info.playerGlow = true;
+arc::Future<Result<std::vector<std::string>>> Backup::extractLevels(std::unordered_set<uint64_t> hashes) const {
+    co_return co_await async::runtime().spawnBlocking<Result<std::vector<std::string>>>(
+        [storage = Backups::get()->m_storage, path = m_path, hashes = std::move(hashes)] {
+            return core::extractLevels(*storage, path, hashes);
         }
-    }
+    );
+}
 
-    auto ccllData = (co_await async::runtime().spawnBlocking<Result<std::string>>([path = m_path] {
-        return cc::parseCompressedCCFile(path / "CCLocalLevels.dat");
-    })).unwrapOrDefault();
+Result<> Backup::restoreBackup() const {
+    return core::restoreBackup(*Backups::get()->m_storage, m_path, getLiveSaveDir());
+}
 
-    pugi::xml_document ccll;
-    if (ccll.load_buffer(ccllData.data(), ccllData.size())) {
-        for (auto node : ccll
-            .select_nodes("//k[normalize-space()=\"LLM_01\"]/following-sibling::d/d/k[normalize-space()=\"k2\"]/following-sibling::s[position()=1]")
-        ) {
-            info.levels.push_back(node.node().text().as_string());
-        }
+struct AutoBackupJob final {
+    std::atomic_bool cancelled = false;
+    std::atomic_bool finished = false;
+};
+
+// Jobs are counted from when they're started on the main thread, so even 
+// ones that haven't gotten to run yet are waited for
+struct DirectoryUsers final {
+    std::mutex lock;
+    std::condition_variable unused;
+    size_t count = 0;
+
+    // The directory is in use until the returned handle is let go of, which 
+    // also happens if the job is cancelled before it runs
+    static std::shared_ptr<void> use(std::shared_ptr<DirectoryUsers> users) {
+        std::lock_guard guard(users->lock);
+        users->count += 1;
+        return std::shared_ptr<void>(nullptr, [users](void*) {
+            {
+                std::lock_guard guard(users->lock);
+                users->count -= 1;
+            }
+            users->unused.notify_all();
+        });
+    }
+    void wait() {
+        std::unique_lock guard(lock);
+        unused.wait(guard, [this] { return count == 0; });
+    }
+};
+
+static AutoBackupResult runAutoBackupJob(
+    Storage& storage, std::filesystem::path const& dir, BackupOptions const& options,
+    std::chrono::hours rate, AutoBackupJob const& job
+) {
+    auto result = AutoBackupResult();
+
+    // Restoring a backup in old versions resulted in the new backup being 
+    // nested inside the old one
+    core::fixNestedBackups(storage, dir, options.meta.user);
+
+    // Backups is sorted from latest to oldest
+    result.backups = core::scanBackups(storage, dir);
+    if (
+        !result.backups.empty() && 
+        std::chrono::duration_cast<std::chrono::hours>(Clock::now() - result.backups.front().meta.time) < rate
+    ) {
+        return result;
+    }
+    // Another backup of the same save would only take up a slot. Checked 
+    // before cleaning up so nothing is removed to make room for it
+    if (!result.backups.empty() && core::isUnchanged(storage, options.saveDir, result.backups.front().path)) {
+        log::info("Save files haven't changed since the latest backup, not making another one");
+        return result;
+    }
+    if (job.cancelled) {
+        result.cancelled = true;
+        return result;
     }
 
-    co_return info;
-}
+    // Try cleaning up automated backups. If this fails, not a big deal honestly
+    auto cleanup = core::cleanupAutomated(storage, dir, std::move(result.backups), options.retention, [&] {
+        return job.cancelled.load();
+    });
+    result.backups = std::move(cleanup.kept);
+    result.removed = std::move(cleanup.removed);
+    result.freedChunkBytes = cleanup.freedChunkBytes;
+    result.detachedBytes = cleanup.detachedBytes;
+    if (job.cancelled) {
+        result.cancelled = true;
+        return result;
+    }
 
-Result<> Backup::restoreBackup() const {
-    std::error_code ec;
-    #ifdef GEODE_IS_IOS
-    auto saveDir = dirs::getSaveDir().parent_path();
-    #else
-    auto saveDir = dirs::getSaveDir();
-    #endif
-    std::filesystem::copy_file(
-        m_path / "CCGameManager.dat", saveDir / "CCGameManager.dat",
-        std::filesystem::copy_options::overwrite_existing, ec
-    );
-    std::filesystem::copy_file(
-        m_path / "CCLocalLevels.dat", saveDir / "CCLocalLevels.dat",
-        std::filesystem::copy_options::overwrite_existing, ec
-    );
-    if (ec) {
-        return Err("Unable to restore backup: {} (code {})", ec.message(), ec.value());
+    // Create new backup
+    auto created = core::writeBackup(storage, dir, options);
+    if (created) {
+        result.backups.insert(result.backups.begin(), created->entry);
     }
-    return Ok();
+    result.created.emplace(std::move(created));
+    return result;
 }
-Result<> Backup::deleteBackup() const {
-    std::error_code ec;
-    std::filesystem::remove_all(m_path, ec);
-    if (ec) {
-        return Err("Unable to delete backup: {} (code {})", ec.message(), ec.value());
-    }
-    return Ok();
+
+static arc::Future<AutoBackupResult> runAutoBackup(
+    std::shared_ptr<Storage> storage, std::filesystem::path dir, BackupOptions options,
+    std::chrono::hours rate, std::shared_ptr<AutoBackupJob> job, std::shared_ptr<void> use
+) {
+    co_return co_await async::runtime().spawnBlocking<AutoBackupResult>([storage, dir, options, rate, job, use] {
+        auto result = runAutoBackupJob(*storage, dir, options, rate, *job);
+        job->finished = true;
+        return result;
+    });
 }
 
-Backups::Backups() {
+Backups::Backups() : m_dirUsers(std::make_shared<DirectoryUsers>()) {
     // Android doesn't have the setting
     // I think the if statement below should work too but this is just to make 
     // 100% absolutely sure
@@ -217,6 +196,14 @@ Backups::Backups() {
         m_dir = dirs::getSaveDir() / "geode-backups";
     }
 #endif
+
+    auto totalSize = Mod::get()->template getSavedValue<int64_t>("backups-total-size", -1);
+    if (totalSize >= 0) {
+        m_totalSize = static_cast<size_t>(totalSize);
+    }
+    else {
+        m_sizeStale = true;
+    }
 }
 
 Backups* Backups::get() {
@@ -228,95 +215,241 @@ std::filesystem::path Backups::getDirectory() const {
     return m_dir;
 }
 
-Result<> Backups::createBackup(bool autoRemove) {
-    auto time = std::chrono::system_clock::now();
-    std::string dirname;
-    try {
-        // fmt::format uses exceptions :sob:
-        dirname = fmt::format("{:%Y-%m-%d_%H-%M}", time);
+std::string Backups::getCurrentUser() const {
+    return GameManager::get()->m_playerName;
+}
+
+BackupOptions Backups::getOptions(bool autoRemove) const {
+    auto options = BackupOptions();
+    options.meta.user = this->getCurrentUser();
+    options.saveDir = getLiveSaveDir();
+    options.autoRemove = autoRemove;
+    auto storage = Mod::get()->template getSettingValue<std::string>("backup-storage");
+    if (storage == "Deduplicated") {
+        options.storage = BackupStorage::Deduplicated;
     }
-    catch(...) {
-        dirname = "unktime";
+    else if (storage == "Delta Chains") {
+        options.storage = BackupStorage::Delta;
     }
-
-    std::string findname = dirname;
-    size_t num = 0;
-    while (std::filesystem::exists(m_dir / findname)) {
-        findname = dirname + "-" + std::to_string(num);
-        num += 1;
+    else if (storage == "Zstandard") {
+        options.storage = BackupStorage::Zstd;
     }
-
-    auto dir = m_dir / findname;
-    GEODE_UNWRAP(file::createDirectoryAll(dir));
-
-    // Copy CC files
-    std::error_code ec;
-    #ifdef GEODE_IS_IOS
-    auto saveDir = dirs::getSaveDir().parent_path();
-    #else
-    auto saveDir = dirs::getSaveDir();
-    #endif
-    std::filesystem::copy_file(saveDir / "CCGameManager.dat", dir / "CCGameManager.dat", ec);
-    std::filesystem::copy_file(saveDir / "CCLocalLevels.dat", dir / "CCLocalLevels.dat", ec);
-    if (ec) {
-        return Err("Unable to create backup: {} (code {})", ec.message(), ec.value());
+    else if (storage == "Level Packs") {
+        options.storage = BackupStorage::Levels;
     }
+    options.keyframeInterval = Mod::get()->template getSettingValue<int64_t>("delta-keyframe-interval");
+    options.zstdLevel = Mod::get()->template getSettingValue<int64_t>("zstd-level");
+    options.zstdDictionary = Mod::get()->template getSettingValue<bool>("zstd-dictionary");
+    options.retention = this->getRetentionPolicy();
+    return options;
+}
+RetentionPolicy Backups::getRetentionPolicy() const {
+    auto policy = RetentionPolicy();
+    policy.keepLast = Mod::get()->template getSettingValue<int64_t>("auto-backup-cleanup-limit");
+    policy.keepHourly = Mod::get()->template getSettingValue<int64_t>("auto-backup-keep-hourly");
+    policy.keepDaily = Mod::get()->template getSettingValue<int64_t>("auto-backup-keep-daily");
+    policy.keepWeekly = Mod::get()->template getSettingValue<int64_t>("auto-backup-keep-weekly");
+    policy.keepMonthly = Mod::get()->template getSettingValue<int64_t>("auto-backup-keep-monthly");
+    // The setting is in MB
+    policy.byteBudget = Mod::get()->template getSettingValue<int64_t>("auto-backup-size-limit") * 1'000'000;
+    return policy;
+}
 
-    // Save metadata
-    GEODE_UNWRAP(file::writeToJson(dir / "metadata.json", BackupMetadata(time)));
-
-    if (autoRemove) {
-        // Not a big deal if this fails
-        (void)file::writeString(dir / "auto-remove.txt", fmt::format(
-            "This backup will be removed when your set auto backup limit of {} is reached.\n\nIf you'd like to preserve this backup, delete this text file.",
-            Mod::get()->getSettingValue<int64_t>("auto-backup-cleanup-limit")
-        ));
+static arc::Future<Result<NewBackup>> runCreateBackup(
+    std::shared_ptr<Storage> storage, std::filesystem::path dir, BackupOptions options, std::shared_ptr<void> use
+) {
+    co_return co_await async::runtime().spawnBlocking<Result<NewBackup>>([storage, dir, options, use] {
+        return core::writeBackup(*storage, dir, options);
+    });
+}
+bool Backups::createBackup(bool autoRemove, std::function<void(Result<>)> onCreated) {
+    if (m_creating) {
+        return false;
     }
-
+    m_creating = true;
+    // Options are read from the game and the settings here, since that 
+    // can only be done on the main thread
+    m_createTask.spawn(
+        runCreateBackup(m_storage, m_dir, this->getOptions(autoRemove), DirectoryUsers::use(m_dirUsers)),
+        [this, onCreated = std::move(onCreated)](Result<NewBackup> created) {
+            m_creating = false;
+            if (!created) {
+                return onCreated(Err(created.unwrapErr()));
+            }
+            this->onBackupCreated(*created);
+            onCreated(Ok());
+        }
+    );
+    return true;
+}
+void Backups::onBackupCreated(NewBackup const& created) {
+    this->addTrackedSize(created.entry.meta.size.value_or(0) + created.chunkBytes);
     if (m_backupsCache) {
-        m_backupsCache->insert(m_backupsCache->begin(), new Backup(dir));
+        m_backupsCache->insert(m_backupsCache->begin(), Ref(new Backup(created.entry)));
+        this->updateAutoRemoveOrder();
     }
-
-    return Ok();
 }
 std::pair<size_t, size_t> Backups::migrateAllFrom(std::filesystem::path const& path) {
-    if (Backup::isBackup(path)) {
-        if (Backup::migrate(m_dir, path)) {
-            return std::make_pair(1, 0);
+    auto progress = ImportProgress();
+    auto summary = BackupImporter::run(*m_storage, path, m_dir, this->getCurrentUser(), progress);
+    if (summary.imported) {
+        // Imported backups don't have a size yet
+        m_sizeStale = true;
+        this->invalidateCache();
+    }
+    return std::make_pair(summary.imported, summary.failed);
+}
+static arc::Future<ImportSummary> runImport(
+    std::shared_ptr<Storage> storage, std::filesystem::path from, std::filesystem::path backupsDir,
+    std::string user, std::shared_ptr<ImportProgress> progress, std::shared_ptr<DirectoryUsers> waitFor
+) {
+    co_return co_await async::runtime().spawnBlocking<ImportSummary>([storage, from, backupsDir, user, progress, waitFor] {
+        if (waitFor) {
+            waitFor->wait();
         }
-        else {
-            return std::make_pair(0, 1);
+        return BackupImporter::run(*storage, from, backupsDir, user, *progress);
+    });
+}
+std::shared_ptr<ImportProgress> Backups::startImport(
+    std::filesystem::path const& path, std::function<void(ImportSummary)> onFinished
+) {
+    return this->startImport(path, nullptr, std::move(onFinished));
+}
+std::shared_ptr<ImportProgress> Backups::startImport(
+    std::filesystem::path const& path, std::shared_ptr<DirectoryUsers> waitFor,
+    std::function<void(ImportSummary)> onFinished
+) {
+    if (m_import && !m_import->isFinished()) {
+        return nullptr;
+    }
+    auto progress = std::make_shared<ImportProgress>();
+    m_import = progress;
+    m_importTask.spawn(
+        runImport(m_storage, path, m_dir, this->getCurrentUser(), progress, std::move(waitFor)),
+        [this, onFinished = std::move(onFinished)](ImportSummary summary) {
+            if (summary.imported) {
+                m_sizeStale = true;
+                this->invalidateCache();
+            }
+            onFinished(summary);
         }
+    );
+    return progress;
+}
+std::shared_ptr<ImportProgress> Backups::updateBackupsDirectory(
+    std::filesystem::path const& dir, std::function<void(ImportSummary)> onFinished
+) {
+    if (m_dir == dir) {
+        return nullptr;
     }
-
-    size_t imported = 0;
-    size_t failed = 0;
-    for (auto folder : file::readDirectory(path).unwrapOrDefault()) {
-        if (std::filesystem::is_directory(folder)) {
-            auto [i, f] = this->migrateAllFrom(folder);
-            imported += i;
-            failed += f;
+    // Backups still being made or deleted in the old directory are waited 
+    // for, and the auto backup is told to stop early so it isn't waited on 
+    // for long
+    this->cancelAutoBackup();
+    auto oldDir = m_dir;
+    auto oldUsers = m_dirUsers;
+    m_dir = dir;
+    m_dirUsers = std::make_shared<DirectoryUsers>();
+    m_sizeStale = true;
+    this->invalidateCache();
+
+    // Remembered until everything has been moved so an interrupted move can 
+    // be continued on the next startup
+    Mod::get()->setSavedValue<std::string>("backups-moving-from", oldDir.string());
+    return this->moveBackupsFrom(oldDir, std::move(oldUsers), std::move(onFinished));
+}
+std::shared_ptr<ImportProgress> Backups::resumeDirectoryMove(std::function<void(ImportSummary)> onFinished) {
+    auto from = std::filesystem::path(Mod::get()->template getSavedValue<std::string>("backups-moving-from", ""));
+    if (from.empty() || from == m_dir || !m_storage->exists(from)) {
+        return nullptr;
+    }
+    log::info("Continuing to move backups from {}", from);
+    return this->moveBackupsFrom(from, nullptr, std::move(onFinished));
+}
+std::shared_ptr<ImportProgress> Backups::moveBackupsFrom(
+    std::filesystem::path const& from, std::shared_ptr<DirectoryUsers> users,
+    std::function<void(ImportSummary)> onFinished
+) {
+    auto progress = this->startImport(from, std::move(users), [this, from, onFinished = std::move(onFinished)](ImportSummary summary) {
+        if (!summary.cancelled && summary.failed == 0) {
+            Mod::get()->setSavedValue<std::string>("backups-moving-from", "");
+            // Only small files are left by now, since the chunks were moved
+            auto res = BackupImporter::removeMovedFrom(*m_storage, from);
+            if (!res) {
+                log::warn("Unable to clean up {}: {}", from, res.unwrapErr());
+            }
         }
+        onFinished(summary);
+    });
+    if (!progress) {
+        log::warn("Another import is running, backups from {} will be moved on the next startup", from);
     }
-    return std::make_pair(imported, failed);
+    return progress;
+}
+static arc::Future<CleanupResult> runDeleteBackups(
+    std::shared_ptr<Storage> storage, std::vector<BackupEntry> entries, std::shared_ptr<void> use
+) {
+    co_return co_await async::runtime().spawnBlocking<CleanupResult>([storage, entries, use] {
+        return core::removeBackups(*storage, entries);
+    });
+}
+bool Backups::deleteBackups(std::vector<Ref<Backup>> backups, std::function<void(Result<>)> onDeleted) {
+    if (m_deleting) {
+        return false;
+    }
+    m_deleting = true;
+    std::vector<BackupEntry> entries;
+    for (auto& backup : backups) {
+        entries.push_back(backup->getEntry());
+    }
+    m_deleteTask.spawn(
+        runDeleteBackups(m_storage, std::move(entries), DirectoryUsers::use(m_dirUsers)),
+        [this, onDeleted = std::move(onDeleted)](CleanupResult result) {
+            m_deleting = false;
+            for (auto& removed : result.removed) {
+                this->refreshCached(removed.path);
+                this->removeTrackedSize(removed.meta.size);
+            }
+            for (auto& other : result.detached) {
+                this->refreshCached(other);
+            }
+            if (result.freedChunkBytes) {
+                this->removeTrackedSize(result.freedChunkBytes);
+            }
+            if (result.detachedBytes) {
+                this->addTrackedSize(result.detachedBytes);
+            }
+            if (result.error) {
+                return onDeleted(Err(*result.error));
+            }
+            onDeleted(Ok());
+        }
+    );
+    return true;
 }
-Result<> Backups::updateBackupsDirectory(std::filesystem::path const& dir) {
-    if (m_dir != dir) {
-        auto oldDir = m_dir;
-        m_dir = dir;
-        this->migrateAllFrom(oldDir);
+RetentionPlan Backups::planCleanup() {
+    std::vector<BackupEntry> entries;
+    for (auto& backup : this->getAllBackups()) {
+        entries.push_back(backup->getEntry());
     }
-    return Ok();
+    // The tracked size is only used once it's known to be right
+    return core::planRetention(
+        std::move(entries), this->getRetentionPolicy(),
+        m_sizeStale ? std::nullopt : std::optional<size_t>(m_totalSize)
+    );
 }
-Result<> Backups::cleanupAutomated() {
-    this->getAllBackups();
-    int64_t limit = Mod::get()->getSettingValue<int64_t>("auto-backup-cleanup-limit");
-    for (auto backup : *m_backupsCache) {
-        if (backup->getAutoRemoveOrder() >= limit) {
-            GEODE_UNWRAP(backup->deleteBackup());
+bool Backups::cleanupAutomated(std::function<void(Result<>)> onDeleted) {
+    std::set<std::filesystem::path> planned;
+    for (auto& entry : this->planCleanup().removed) {
+        planned.insert(entry.path);
+    }
+    std::vector<Ref<Backup>> removed;
+    for (auto& backup : this->getAllBackups()) {
+        if (planned.contains(backup->getPath())) {
+            removed.push_back(backup);
         }
     }
-    return Ok();
+    return this->deleteBackups(std::move(removed), std::move(onDeleted));
 }
 std::vector<Ref<Backup>> Backups::getAllBackups(bool invalidateCache) {
     if (invalidateCache) {
@@ -325,52 +458,266 @@ std::vector<Ref<Backup>> Backups::getAllBackups(bool invalidateCache) {
 
     // Load backups from disk if no cache
     if (!m_backupsCache) {
-        m_backupsCache.emplace(std::vector<Ref<Backup>>());
-        for (auto b : file::readDirectory(m_dir, false).unwrapOrDefault()) {
-            if (
-                std::filesystem::exists(b / "CCGameManager.dat") || 
-                std::filesystem::exists(b / "CCLocalLevels.dat")
-            ) {
-                m_backupsCache->push_back(Ref(new Backup(b)));
-            }
+        this->setBackups(core::scanBackups(*m_storage, m_dir));
+    }
+
+    // This is always true if we are here
+    return *m_backupsCache;
+}
+void Backups::setBackups(std::vector<BackupEntry> entries) {
+    m_backupsCache.emplace(std::vector<Ref<Backup>>());
+    m_backupsCache->reserve(entries.size());
+
+    if (!m_watcher) {
+        m_watcher = std::make_unique<DirectoryWatcher>(m_dir);
+    }
+    for (auto& entry : entries) {
+        m_backupsCache->push_back(Ref(new Backup(entry)));
+        m_watcher->watch(entry.path);
+    }
+    this->updateAutoRemoveOrder();
+}
+void Backups::updateAutoRemoveOrder() {
+    if (!m_backupsCache) {
+        return;
+    }
+    // Backups are sorted by time, so the auto-remove order is just a count
+    size_t autoRemoveOrder = 0;
+    for (auto& backup : *m_backupsCache) {
+        if (backup->m_autoRemoveOrder) {
+            backup->m_autoRemoveOrder = autoRemoveOrder;
+            autoRemoveOrder += 1;
         }
-        std::sort(m_backupsCache->begin(), m_backupsCache->end(), [](auto first, auto second) {
-            return first->m_meta.time > second->m_meta.time;
-        });
+    }
+}
+void Backups::refreshCached(std::filesystem::path const& path) {
+    if (!m_backupsCache) {
+        return;
+    }
+    auto existing = std::find_if(m_backupsCache->begin(), m_backupsCache->end(), [&](auto const& backup) {
+        return backup->m_path == path;
+    });
 
-        // Set auto-remove order after sorting by time
-        size_t autoRemoveOrder = 0;
-        for (auto& b : *m_backupsCache) {
-            if (b->m_autoRemoveOrder) {
-                b->m_autoRemoveOrder = autoRemoveOrder;
-                autoRemoveOrder += 1;
-            }
+    if (!core::isBackup(*m_storage, path)) {
+        if (existing != m_backupsCache->end()) {
+            m_backupsCache->erase(existing);
+            this->updateAutoRemoveOrder();
         }
+        return;
+    }
+    // Metadata is written last, so a backup without it is still being 
+    // written (or was copied in without one, in which case it shows up the 
+    // next time the list is reloaded)
+    if (!m_storage->exists(path / "metadata.json")) {
+        return;
     }
 
-    // This is always true if we are here
-    return *m_backupsCache;
+    // Existing backups are updated in place so anything holding onto them 
+    // stays valid
+    auto entry = BackupEntry::load(*m_storage, path);
+    Ref<Backup> backup;
+    if (existing != m_backupsCache->end()) {
+        backup = *existing;
+        m_backupsCache->erase(existing);
+        backup->m_meta = entry.meta;
+        backup->m_autoRemoveOrder = entry.autoRemove ? std::optional<size_t>(0) : std::nullopt;
+    }
+    else {
+        backup = Ref(new Backup(entry));
+    }
+    auto pos = std::find_if(m_backupsCache->begin(), m_backupsCache->end(), [&](auto const& other) {
+        return !core::isNewer(
+            other->m_meta.time, other->m_path.filename().string(),
+            backup->m_meta.time, backup->m_path.filename().string()
+        );
+    });
+    m_backupsCache->insert(pos, backup);
+    this->updateAutoRemoveOrder();
+}
+bool Backups::pollChanges() {
+    if (!m_watcher || !m_backupsCache) {
+        return false;
+    }
+    auto changes = m_watcher->poll();
+    if (!changes) {
+        log::warn("Missed changes to the backups directory, reloading everything");
+        this->invalidateCache();
+        return true;
+    }
+    for (auto& path : *changes) {
+        this->refreshCached(path);
+    }
+    return !changes->empty();
+}
+
+void Backups::startAutoBackup(std::chrono::hours rate, std::function<void(Result<>)> onCreated) {
+    // Don't pile up jobs if the menu is entered again before one finishes
+    if (m_autoBackupJob && !m_autoBackupJob->finished) {
+        return;
+    }
+    auto job = std::make_shared<AutoBackupJob>();
+    m_autoBackupJob = job;
+    m_autoBackupTask.spawn(
+        runAutoBackup(m_storage, m_dir, this->getOptions(true), rate, job, DirectoryUsers::use(m_dirUsers)),
+        [this, onCreated = std::move(onCreated)](AutoBackupResult result) {
+            for (auto& removed : result.removed) {
+                this->removeTrackedSize(removed.meta.size);
+            }
+            if (result.freedChunkBytes) {
+                this->removeTrackedSize(result.freedChunkBytes);
+            }
+            if (result.detachedBytes) {
+                this->addTrackedSize(result.detachedBytes);
+            }
+            // The job already listed everything, so no need to scan again
+            this->setBackups(std::move(result.backups));
+
+            if (result.cancelled) {
+                log::info("Automatic backup was cancelled");
+                return;
+            }
+            if (!result.created) {
+                return;
+            }
+            if (result.created->isOk()) {
+                auto& created = result.created->unwrap();
+                this->addTrackedSize(created.entry.meta.size.value_or(0) + created.chunkBytes);
+                onCreated(Ok());
+            }
+            else {
+                onCreated(Err(result.created->unwrapErr()));
+            }
+        }
+    );
+}
+void Backups::cancelAutoBackup() {
+    if (!m_autoBackupJob || m_autoBackupJob->finished) {
+        return;
+    }
+    // The job checks this between steps; it never stops halfway through 
+    // writing a backup
+    m_autoBackupJob->cancelled = true;
+    m_autoBackupTask.cancel();
+    // Whatever the job got done won't be reported back
+    m_sizeStale = true;
+    this->invalidateCache();
 }
 void Backups::invalidateCache() {
     m_backupsCache = std::nullopt;
+    // Start watching from scratch when the backups are loaded again
+    m_watcher = nullptr;
 }
-void Backups::fixNestedBackups(std::filesystem::path const& current) {
-    for (auto folder : file::readDirectory(current).unwrapOrDefault()) {
-        if (Backup::isBackup(folder)) {
-            this->fixNestedBackups(folder);
-            if (m_dir != current) {
-                auto res = Backup::migrate(m_dir, folder);
-                if (res) {
-                    log::info("Fixed nested backup {}", folder);
-                }
-                else {
-                    log::error("Unable to fix nested backup {}: {}", folder, res.unwrapErr());
-                }
-            }
+
+void Backups::addTrackedSize(size_t size) {
+    m_totalSize += size;
+    this->saveTrackedSize();
+}
+void Backups::removeTrackedSize(std::optional<size_t> size) {
+    if (!size) {
+        m_sizeStale = true;
+        return;
+    }
+    m_totalSize -= std::min(m_totalSize, *size);
+    this->saveTrackedSize();
+}
+void Backups::saveTrackedSize() {
+    Mod::get()->setSavedValue<int64_t>("backups-total-size", static_cast<int64_t>(m_totalSize));
+}
+size_t Backups::getTotalSize() const {
+    return m_totalSize;
+}
+bool Backups::needsSizeReconcile() const {
+    if (m_sizeStale) {
+        return true;
+    }
+    // Catch any drift from backups being added or removed by hand once a day
+    auto reconciled = Time(std::chrono::hours(
+        Mod::get()->template getSavedValue<int64_t>("backups-size-reconciled", 0)
+    ));
+    return Clock::now() - reconciled > std::chrono::hours(24);
+}
+arc::Future<BackupSizes> Backups::measureSizes() const {
+    co_return co_await async::runtime().spawnBlocking<BackupSizes>([storage = m_storage, dir = m_dir] {
+        return core::measureSizes(*storage, dir);
+    });
+}
+void Backups::applySizes(BackupSizes const& sizes) {
+    std::unordered_map<std::string, size_t> byPath;
+    for (auto& [path, size] : sizes.backups) {
+        byPath.emplace(path.string(), size);
+    }
+    std::vector<BackupEntry> entries;
+    for (auto& backup : this->getAllBackups()) {
+        auto size = byPath.find(backup->m_path.string());
+        if (size != byPath.end() && backup->m_meta.size != size->second) {
+            backup->m_meta.size = size->second;
+            (void)m_storage->write(backup->m_path / "metadata.json", matjson::Value(backup->m_meta).dump());
         }
+        entries.push_back(backup->getEntry());
     }
+    auto layout = BackupIndex::hasCurrentLayout(*m_storage, m_dir) ? BackupIndex::LAYOUT_VERSION : 0;
+    (void)BackupIndex::write(*m_storage, m_dir, entries, layout);
+    m_totalSize = sizes.total;
+    m_sizeStale = false;
+    this->saveTrackedSize();
+    Mod::get()->setSavedValue<int64_t>(
+        "backups-size-reconciled",
+        std::chrono::duration_cast<std::chrono::hours>(Clock::now().time_since_epoch()).count()
+    );
 }
 void Backups::fixNestedBackups() {
-    log::info("Fixing nested backups...");
-    this->fixNestedBackups(m_dir);
+    core::fixNestedBackups(*m_storage, m_dir, this->getCurrentUser());
+}
+
+arc::Future<LevelIndex> Backups::loadLevelIndex() const {
+    co_return co_await async::runtime().spawnBlocking<LevelIndex>([storage = m_storage, dir = m_dir] {
+        return LevelIndex::load(*storage, dir);
+    });
+}
+static arc::Future<LevelIndex> runLevelIndexSync(
+    std::shared_ptr<Storage> storage, std::filesystem::path dir, std::vector<BackupEntry> entries,
+    std::shared_ptr<std::atomic_bool> cancelled
+) {
+    co_return co_await async::runtime().spawnBlocking<LevelIndex>([storage, dir, entries, cancelled] {
+        return LevelIndex::sync(*storage, dir, entries, [&] {
+            return cancelled->load();
+        });
+    });
+}
+arc::Future<LevelIndex> Backups::syncLevelIndex(std::shared_ptr<std::atomic_bool> cancelled) {
+    // The cached backups can only be read on the main thread
+    std::vector<BackupEntry> entries;
+    for (auto& backup : this->getAllBackups()) {
+        entries.push_back(backup->getEntry());
+    }
+    return runLevelIndexSync(m_storage, m_dir, std::move(entries), std::move(cancelled));
+}
+
+Result<size_t> Backups::addLocalLevels(std::vector<std::string> const& levels) {
+    // Read them all first so a broken one doesn't leave only some added
+    std::vector<Ref<GJGameLevel>> added;
+    for (auto& data : levels) {
+        // Levels are stored as plain dictionaries, which DS_Dictionary can 
+        // only read as part of a whole plist
+        auto dict = std::make_unique<DS_Dictionary>();
+        if (!dict->loadRootSubDictFromString(
+            "<?xml version=\"1.0\"?><plist version=\"1.0\" gjver=\"2.0\"><dict><k>root</k>" + data + "</dict></plist>"
+        )) {
+            return Err("Unable to read level data");
+        }
+        dict->stepIntoSubDictWithKey("root");
+        auto level = GJGameLevel::createWithCoder(dict.get());
+        if (!level) {
+            return Err("Unable to read level data");
+        }
+        level->m_levelType = GJLevelType::Editor;
+        added.push_back(level);
+    }
+    // Newest levels are first, same as when creating a level. The game saves 
+    // them along with the rest of its created levels
+    auto localLevels = LocalLevelManager::get()->m_localLevels;
+    for (auto level = added.rbegin(); level != added.rend(); ++level) {
+        localLevels->insertObject(*level, 0);
+    }
+    return Ok(added.size());
 }
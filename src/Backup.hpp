@@ -1,41 +1,34 @@
 #pragma once
 
 #include <Geode/DefaultInclude.hpp>
-#include <Geode/binding/GameManager.hpp>
 #include <Geode/utils/cocos.hpp>
-#include <matjson.hpp>
 #include <Geode/utils/async.hpp>
+#include "BackupCore.hpp"
+#include "DirectoryWatcher.hpp"
+#include "Import.hpp"
+#include "InfoLoader.hpp"
+#include "LevelIndex.hpp"
+#include "Mover.hpp"
+#include <atomic>
 
 using namespace geode::prelude;
 
 class Backups;
 
-using Clock = std::chrono::system_clock;
-using Time = std::chrono::time_point<Clock>;
-
-struct BackupMetadata final {
-	std::optional<std::string> name;
-	std::string user = GameManager::get()->m_playerName;
-	Time time = Clock::now();
-
-	inline BackupMetadata() = default;
-	inline BackupMetadata(Time time) : time(time) {}
+struct AutoBackupResult final {
+	// Newest first, after cleaning up and including the new backup
+	std::vector<BackupEntry> backups;
+	std::vector<BackupEntry> removed;
+	size_t freedChunkBytes = 0;
+	size_t detachedBytes = 0;
+	// Missing if there was already a recent enough backup, or if the save 
+	// files haven't changed since the latest one
+	std::optional<Result<NewBackup>> created;
+	bool cancelled = false;
 };
 
-template <>
-struct matjson::Serialize<BackupMetadata> {
-    static matjson::Value toJson(BackupMetadata const& info);
-    static Result<BackupMetadata> fromJson(matjson::Value const& value);
-};
-
-struct BackupInfo final {
-	int playerIcon = 0;
-	int playerColor1 = 0;
-	int playerColor2 = 0;
-	std::optional<int> playerGlow = 0;
-	int starCount = 0;
-	std::vector<std::string> levels;
-};
+struct AutoBackupJob;
+struct DirectoryUsers;
 
 class Backup final : public CCObject {
 private:
@@ -43,49 +36,147 @@ private:
 	BackupMetadata m_meta;
 	std::optional<size_t> m_autoRemoveOrder;
 
-	Backup(std::filesystem::path const& path);
+	Backup(BackupEntry const& entry);
 
 	friend class Backups;
 
 public:
-	static Result<> migrate(std::filesystem::path const& backupsDir, std::filesystem::path const& existingDir);
-
-    static bool isBackup(std::filesystem::path const& dir);
-
 	std::filesystem::path getPath() const;
 	Time getTime() const;
 	std::string getUser() const;
 	std::chrono::hours getTimeSince() const;
+	std::optional<size_t> getSize() const;
+	BackupEntry getEntry() const;
 	bool hasLocalLevels() const;
 	bool hasGameManager() const;
+	bool isDeduplicated() const;
 	
 	bool isAutoRemove() const;
 	std::optional<size_t> getAutoRemoveOrder() const;
 	void preserve();
 
-	arc::Future<BackupInfo> loadInfo();
+	// Queues the backup's info to be loaded, sharing the request with 
+	// anyone else who asked for it. Letting go of it cancels the load
+	std::shared_ptr<InfoRequest> requestInfo(InfoPriority priority) const;
+	// Copies levels out of the backup on a background thread, without 
+	// decompressing more than its CCLocalLevels.dat
+	arc::Future<Result<std::vector<std::string>>> extractLevels(std::unordered_set<uint64_t> hashes) const;
 
 	Result<> restoreBackup() const;
-	Result<> deleteBackup() const;
 };
 
 class Backups final {
 private:
+	// Always local in the mod, but everything goes through it
+	std::shared_ptr<Storage> m_storage = Storage::local();
+	InfoLoader m_infoLoader { m_storage };
 	std::filesystem::path m_dir;
+	// Background jobs that were started on the current directory
+	std::shared_ptr<DirectoryUsers> m_dirUsers;
 	std::optional<std::vector<Ref<Backup>>> m_backupsCache;
+	size_t m_totalSize = 0;
+	bool m_sizeStale = false;
+	std::shared_ptr<AutoBackupJob> m_autoBackupJob;
+	async::TaskHolder<AutoBackupResult> m_autoBackupTask;
+	async::TaskHolder<Result<NewBackup>> m_createTask;
+	bool m_creating = false;
+	async::TaskHolder<CleanupResult> m_deleteTask;
+	bool m_deleting = false;
+	std::unique_ptr<DirectoryWatcher> m_watcher;
+	std::shared_ptr<ImportProgress> m_import;
+	async::TaskHolder<ImportSummary> m_importTask;
 
 	Backups();
-    void fixNestedBackups(std::filesystem::path const& current);
+
+	BackupOptions getOptions(bool autoRemove) const;
+	RetentionPolicy getRetentionPolicy() const;
+	// Who new and imported backups are listed as being made by
+	std::string getCurrentUser() const;
+	void setBackups(std::vector<BackupEntry> entries);
+	void onBackupCreated(NewBackup const& created);
+	// Re-read a single backup into the cache, or remove it if it's gone
+	void refreshCached(std::filesystem::path const& path);
+	void updateAutoRemoveOrder();
+	// Waits for the jobs in `waitFor` to be done with the directory being 
+	// imported from before importing anything
+	std::shared_ptr<ImportProgress> startImport(
+		std::filesystem::path const& path, std::shared_ptr<DirectoryUsers> waitFor,
+		std::function<void(ImportSummary)> onFinished
+	);
+	std::shared_ptr<ImportProgress> moveBackupsFrom(
+		std::filesystem::path const& from, std::shared_ptr<DirectoryUsers> users,
+		std::function<void(ImportSummary)> onFinished
+	);
+
+	void addTrackedSize(size_t size);
+	void removeTrackedSize(std::optional<size_t> size);
+	void saveTrackedSize();
+
+	friend class Backup;
 
 public:
 	static Backups* get();
 
 	std::filesystem::path getDirectory() const;
 	std::pair<size_t, size_t> migrateAllFrom(std::filesystem::path const& path);
-	Result<> createBackup(bool autoRemove);
-	Result<> updateBackupsDirectory(std::filesystem::path const& dir);
-	Result<> cleanupAutomated();
+	// Like migrateAllFrom, but on a background thread. Progress can be read 
+	// from the returned object while the import is running. Returns null if 
+	// an import is already running
+	std::shared_ptr<ImportProgress> startImport(
+		std::filesystem::path const& path, std::function<void(ImportSummary)> onFinished
+	);
+	// Creates a backup on a background thread, calling back on the main 
+	// thread once it's done. Returns false if one is already being created
+	bool createBackup(bool autoRemove, std::function<void(Result<>)> onCreated);
+	// Moves every backup from the current directory to the new one in the 
+	// background. Returns null if nothing is being moved
+	std::shared_ptr<ImportProgress> updateBackupsDirectory(
+		std::filesystem::path const& dir, std::function<void(ImportSummary)> onFinished
+	);
+	// Continues moving backups from a previous directory if the game was 
+	// closed before it finished
+	std::shared_ptr<ImportProgress> resumeDirectoryMove(std::function<void(ImportSummary)> onFinished);
+	// Deletes backups on a background thread, calling back on the main 
+	// thread once they're all gone. Unused chunks are collected once at the 
+	// end. Returns false if backups are already being deleted
+	bool deleteBackups(std::vector<Ref<Backup>> backups, std::function<void(Result<>)> onDeleted);
+	// Which automated backups cleaning up would remove right now, without 
+	// removing anything
+	RetentionPlan planCleanup();
+	// Deletes the backups planCleanup lists, same as deleteBackups
+	bool cleanupAutomated(std::function<void(Result<>)> onDeleted);
 	std::vector<Ref<Backup>> getAllBackups(bool invalidateCache = false);
 	void invalidateCache();
+	// Apply changes made to the backups directory since the last call to 
+	// the cached backups. Returns true if the cache changed
+	bool pollChanges();
+
+	// Fixes nested backups, cleans up automated backups and creates a new 
+	// one if the latest backup is older than the given rate, all on a 
+	// background thread. The callback is called on the main thread if a new 
+	// backup was attempted
+	void startAutoBackup(std::chrono::hours rate, std::function<void(Result<>)> onCreated);
+	void cancelAutoBackup();
+
+	// Total size of the backups directory, tracked as backups are created 
+	// and deleted so it never requires walking the directory
+	size_t getTotalSize() const;
+	// Whether the tracked size may have drifted and should be reconciled 
+	// with measureSizes
+	bool needsSizeReconcile() const;
+	// Walks the whole backups directory on a background thread. The result 
+	// should be passed to applySizes on the main thread
+	arc::Future<BackupSizes> measureSizes() const;
+	void applySizes(BackupSizes const& sizes);
     void fixNestedBackups();
+
+	// Reads the level index on a background thread
+	arc::Future<LevelIndex> loadLevelIndex() const;
+	// Indexes the levels in every backup the level index doesn't have yet on 
+	// a background thread, which is slow if there are many of them
+	arc::Future<LevelIndex> syncLevelIndex(std::shared_ptr<std::atomic_bool> cancelled);
+	// Adds levels copied out of a backup to the player's created levels 
+	// without touching the rest of them, so unlike restoring a whole backup 
+	// nothing is lost and the game doesn't have to be restarted
+	Result<size_t> addLocalLevels(std::vector<std::string> const& levels);
 };
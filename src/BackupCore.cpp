@@ -0,0 +1,1224 @@
+#include "BackupCore.hpp"
+#include "BackupIndex.hpp"
+#include "ChunkStore.hpp"
+#include "DeltaChain.hpp"
+#include "Hash.hpp"
+#include "LevelIndex.hpp"
+#include "LevelPack.hpp"
+#include "ParseCC.hpp"
+#include "Zstd.hpp"
+#include <matjson/std.hpp>
+#include <algorithm>
+#include <charconv>
+#include <future>
+#include <mutex>
+
+matjson::Value matjson::Serialize<BackupMetadata>::toJson(BackupMetadata const& info) {
+    return matjson::makeObject({
+        { "name", info.name },
+        { "user", info.user },
+        // Older versions only read the hour
+        { "time", std::chrono::duration_cast<std::chrono::hours>(info.time.time_since_epoch()).count() },
+        { "timestamp", std::chrono::duration_cast<std::chrono::seconds>(info.time.time_since_epoch()).count() },
+        { "size", info.size },
+    });
+}
+Result<BackupMetadata> matjson::Serialize<BackupMetadata>::fromJson(matjson::Value const& value) {
+    auto info = BackupMetadata();
+    auto json = checkJson(value, "BackupMetadata");
+    json.has("name").into(info.name);
+    json.needs("user").into(info.user);
+    int time;
+    json.needs("time").into(time);
+    info.time = Time(std::chrono::hours(time));
+    std::optional<int64_t> timestamp;
+    json.has("timestamp").into(timestamp);
+    if (timestamp) {
+        info.time = Time(std::chrono::seconds(*timestamp));
+    }
+    json.has("size").into(info.size);
+    return json.ok(info);
+}
+
+matjson::Value matjson::Serialize<BackupInfo>::toJson(BackupInfo const& info) {
+    return matjson::makeObject({
+        { "version", BackupInfo::VERSION },
+        { "icon", info.playerIcon },
+        { "color1", info.playerColor1 },
+        { "color2", info.playerColor2 },
+        { "glow", info.playerGlow },
+        { "stars", info.starCount },
+        { "has-game-manager", info.hasGameManager },
+        { "has-local-levels", info.hasLocalLevels },
+        { "level-count", info.levelCount },
+        { "levels", info.levels },
+    });
+}
+Result<BackupInfo> matjson::Serialize<BackupInfo>::fromJson(matjson::Value const& value) {
+    auto info = BackupInfo();
+    auto json = checkJson(value, "BackupInfo");
+    int version = 0;
+    json.needs("version").into(version);
+    if (version != BackupInfo::VERSION) {
+        return Err("Outdated summary version {}", version);
+    }
+    json.needs("icon").into(info.playerIcon);
+    json.needs("color1").into(info.playerColor1);
+    json.needs("color2").into(info.playerColor2);
+    json.has("glow").into(info.playerGlow);
+    json.needs("stars").into(info.starCount);
+    json.needs("has-game-manager").into(info.hasGameManager);
+    json.needs("has-local-levels").into(info.hasLocalLevels);
+    json.needs("level-count").into(info.levelCount);
+    json.needs("levels").into(info.levels);
+    return json.ok(info);
+}
+
+bool SaveFingerprint::operator==(SaveFingerprint const& other) const {
+    return std::equal(files.begin(), files.end(), other.files.begin(), other.files.end(), [](auto const& a, auto const& b) {
+        return a.name == b.name && a.size == b.size && a.hash == b.hash;
+    });
+}
+
+matjson::Value matjson::Serialize<SaveFingerprint>::toJson(SaveFingerprint const& fingerprint) {
+    auto files = matjson::Value::array();
+    for (auto& file : fingerprint.files) {
+        files.push(matjson::makeObject({
+            { "name", file.name },
+            { "size", file.size },
+            { "time", file.time },
+            // Not every 64-bit number fits in a JSON number
+            { "hash", fmt::format("{:016x}", file.hash) },
+        }));
+    }
+    return matjson::makeObject({
+        { "version", SaveFingerprint::VERSION },
+        { "files", files },
+    });
+}
+Result<SaveFingerprint> matjson::Serialize<SaveFingerprint>::fromJson(matjson::Value const& value) {
+    if (value["version"].asInt().unwrapOr(0) != SaveFingerprint::VERSION) {
+        return Err("Outdated fingerprint version");
+    }
+    auto files = value["files"].asArray();
+    if (!files) {
+        return Err("Fingerprint has no files");
+    }
+    auto fingerprint = SaveFingerprint();
+    for (auto& file : *files) {
+        auto& added = fingerprint.files.emplace_back();
+        added.name = file["name"].asString().unwrapOrDefault();
+        added.size = file["size"].asUInt().unwrapOr(0);
+        added.time = file["time"].asInt().unwrapOr(0);
+        auto hash = file["hash"].asString().unwrapOrDefault();
+        std::from_chars(hash.data(), hash.data() + hash.size(), added.hash, 16);
+    }
+    return Ok(std::move(fingerprint));
+}
+
+size_t core::getBackupSize(Storage const& storage, std::filesystem::path const& dir) {
+    return storage.size(dir) - storage.size(dir / "metadata.json");
+}
+
+static std::filesystem::path getManifestPath(std::filesystem::path const& dir, std::string_view name) {
+    auto path = dir / name;
+    path += ChunkStore::MANIFEST_EXT;
+    return path;
+}
+
+static std::filesystem::path getZstdPath(std::filesystem::path const& dir, std::string_view name) {
+    auto path = dir / name;
+    path += zstd::EXT;
+    return path;
+}
+
+// Save files are either stored as plain copies, as chunk manifests in 
+// deduplicated backups, as deltas in delta chains, as zstd frames or as 
+// level packs
+bool core::hasSaveFile(Storage const& storage, std::filesystem::path const& dir, std::string_view name) {
+    return 
+        storage.exists(dir / name) ||
+        storage.exists(getManifestPath(dir, name)) ||
+        storage.exists(DeltaChain::getDeltaPath(dir, name)) ||
+        storage.exists(getZstdPath(dir, name)) ||
+        storage.exists(LevelPack::getTablePath(dir, name));
+}
+
+// Get the decompressed contents of a save file in a backup, regardless of how 
+// it's stored
+static Result<std::string> readSaveFile(Storage& storage, std::filesystem::path const& dir, std::string_view name) {
+    auto manifest = getManifestPath(dir, name);
+    if (storage.exists(manifest)) {
+        // The chunk store is shared by all backups in the same directory
+        return ChunkStore(storage, dir.parent_path()).read(manifest);
+    }
+    if (storage.exists(DeltaChain::getDeltaPath(dir, name))) {
+        // Chains also go through the other backups in the same directory
+        return DeltaChain(storage, dir.parent_path()).read(dir, name);
+    }
+    auto zst = getZstdPath(dir, name);
+    if (storage.exists(zst)) {
+        GEODE_UNWRAP_INTO(auto frame, storage.read(zst));
+        std::string dict;
+        if (auto id = zstd::getDictID(frame)) {
+            GEODE_UNWRAP_INTO(dict, zstd::loadDictionary(storage, dir.parent_path(), id));
+        }
+        return zstd::decompress(frame, dict);
+    }
+    if (storage.exists(LevelPack::getTablePath(dir, name))) {
+        GEODE_UNWRAP_INTO(auto pack, LevelPack::open(storage, dir, name));
+        return pack.read();
+    }
+    return cc::parseCompressedCCFile(storage, dir / name);
+}
+
+// Other formats are decompressed all at once, but still passed on in pieces 
+// so whatever is parsing them can be cancelled
+static constexpr size_t STREAM_PIECE_SIZE = 1024 * 1024;
+
+// Same as readSaveFile, but plain copies are decompressed a block at a time 
+// instead of all at once
+static Result<> streamSaveFile(
+    Storage& storage, std::filesystem::path const& dir, std::string_view name, cc::DataCallback const& onData,
+    std::function<bool()> const& isCancelled = nullptr
+) {
+    if (storage.exists(dir / name)) {
+        return cc::streamCompressedCCFile(storage, dir / name, onData, isCancelled);
+    }
+    if (isCancelled && isCancelled()) {
+        return Err("Cancelled");
+    }
+    GEODE_UNWRAP_INTO(auto data, readSaveFile(storage, dir, name));
+    for (size_t i = 0; i < data.size(); i += STREAM_PIECE_SIZE) {
+        if (isCancelled && isCancelled()) {
+            return Err("Cancelled");
+        }
+        onData(std::string_view(data).substr(i, STREAM_PIECE_SIZE));
+    }
+    return Ok();
+}
+
+static Result<> copySaveFile(
+    Storage& storage, std::filesystem::path const& from, std::filesystem::path const& to, bool overwrite
+) {
+    GEODE_UNWRAP(storage.copy(from, to, overwrite));
+    log::info("Copied {} to {}", from.filename(), to.parent_path());
+    return Ok();
+}
+
+static Result<> restoreSaveFile(
+    Storage& storage, std::filesystem::path const& dir, std::string_view name, std::filesystem::path const& saveDir
+) {
+    if (
+        storage.exists(getManifestPath(dir, name)) ||
+        storage.exists(DeltaChain::getDeltaPath(dir, name)) ||
+        storage.exists(getZstdPath(dir, name)) ||
+        storage.exists(LevelPack::getTablePath(dir, name))
+    ) {
+        GEODE_UNWRAP_INTO(auto data, readSaveFile(storage, dir, name));
+        // Re-encode the same way the game saves its files. Same as copies, 
+        // the save is replaced all at once
+        return storage.write(saveDir / name, cc::compressString(data, 11));
+    }
+    return copySaveFile(storage, dir / name, saveDir / name, true);
+}
+
+// Restored by re-encoding the decompressed data like deduplicated and delta 
+// backups, so the restored file has the same save data but isn't the same 
+// bytes as the game's own encoding. What was written is read back to make 
+// sure of that much. Levels are packed one per frame when storing as level 
+// packs
+static Result<size_t> writeZstdSaveFile(
+    Storage& storage, std::filesystem::path const& backupsDir,
+    std::filesystem::path const& dir, std::string_view name, std::string const& data,
+    BackupOptions const& options
+) {
+    std::string dict;
+    if (options.zstdDictionary) {
+        auto res = zstd::getDictionary(storage, backupsDir, data);
+        if (res) {
+            dict = std::move(*res);
+        }
+        else {
+            log::warn("Not using a zstd dictionary: {}", res.unwrapErr());
+        }
+    }
+    if (options.storage == BackupStorage::Levels && name == "CCLocalLevels.dat") {
+        GEODE_UNWRAP_INTO(auto written, LevelPack::write(storage, dir, name, data, options.zstdLevel, dict));
+        GEODE_UNWRAP_INTO(auto pack, LevelPack::open(storage, dir, name));
+        GEODE_UNWRAP_INTO(auto packed, pack.read());
+        if (packed != data) {
+            (void)storage.remove(LevelPack::getTablePath(dir, name));
+            (void)storage.remove(LevelPack::getBlocksPath(dir, name));
+            return Err("the level pack doesn't decode to the same save data");
+        }
+        return Ok(written);
+    }
+    GEODE_UNWRAP_INTO(auto frame, zstd::compress(data, options.zstdLevel, dict));
+    GEODE_UNWRAP_INTO(auto decompressed, zstd::decompress(frame, dict));
+    if (decompressed != data) {
+        return Err("the frame doesn't decode to the same save data");
+    }
+    GEODE_UNWRAP(storage.write(getZstdPath(dir, name), frame));
+    return Ok(frame.size());
+}
+
+static int parseInt(std::string_view str) {
+    int value = 0;
+    std::from_chars(str.data(), str.data() + str.size(), value);
+    return value;
+}
+
+class GameManagerInfoHandler final : public cc::PlistHandler {
+private:
+    BackupInfo& m_info;
+    bool m_foundStars = false;
+    bool m_foundIcon = false;
+    bool m_foundColor1 = false;
+    bool m_foundColor2 = false;
+
+public:
+    GameManagerInfoHandler(BackupInfo& info) : m_info(info) {}
+
+    bool onKey(cc::PlistPath path, std::string_view key) override {
+        // Stats are stored under GS_value, star count being stat 6
+        if (!path.empty() && path.back() == "GS_value") {
+            return key == "6" && !m_foundStars;
+        }
+        return
+            (key == "playerFrame" && !m_foundIcon) ||
+            (key == "playerColor" && !m_foundColor1) ||
+            (key == "playerColor2" && !m_foundColor2) ||
+            key == "playerGlow";
+    }
+    void onValue(cc::PlistPath path, std::string_view key, char type, std::string_view value) override {
+        if (key == "6" && type == 's') {
+            m_info.starCount = parseInt(value);
+            m_foundStars = true;
+        }
+        else if (key == "playerFrame" && type == 'i') {
+            m_info.playerIcon = parseInt(value);
+            m_foundIcon = true;
+        }
+        else if (key == "playerColor" && type == 'i') {
+            m_info.playerColor1 = parseInt(value);
+            m_foundColor1 = true;
+        }
+        else if (key == "playerColor2" && type == 'i') {
+            m_info.playerColor2 = parseInt(value);
+            m_foundColor2 = true;
+        }
+        else if (key == "playerGlow" && type == 't') {
+            m_info.playerGlow = true;
+        }
+    }
+};
+
+class LocalLevelsInfoHandler final : public cc::PlistHandler {
+private:
+    BackupInfo& m_info;
+    std::vector<BackupLevel>* m_levels;
+    // Key of the level dictionary the last key was in
+    std::string m_current;
+    xxh::Hasher m_hasher;
+
+    static bool isLevel(cc::PlistPath path) {
+        // LLM_01 holds one dictionary per level
+        return path.size() >= 2 && path[path.size() - 2] == "LLM_01";
+    }
+
+public:
+    LocalLevelsInfoHandler(BackupInfo& info, std::vector<BackupLevel>* levels = nullptr)
+      : m_info(info), m_levels(levels) {}
+
+    bool onKey(cc::PlistPath path, std::string_view key) override {
+        if (!isLevel(path)) {
+            return false;
+        }
+        if (!m_levels) {
+            return key == "k2";
+        }
+        if (m_levels->empty() || path.back() != m_current) {
+            m_current = path.back();
+            m_levels->emplace_back();
+        }
+        // Name, online ID and version
+        return key == "k2" || key == "k1" || key == "k16";
+    }
+    void onValue(cc::PlistPath path, std::string_view key, char type, std::string_view value) override {
+        if (key == "k2" && type == 's') {
+            m_info.levelCount += 1;
+            if (m_info.levels.size() < BackupInfo::MAX_LEVEL_NAMES) {
+                m_info.levels.emplace_back(value);
+            }
+            if (m_levels) {
+                m_levels->back().name = value;
+            }
+        }
+        else if (key == "k1" && type == 'i') {
+            m_levels->back().id = parseInt(value);
+        }
+        else if (key == "k16" && type == 'i') {
+            m_levels->back().version = parseInt(value);
+        }
+    }
+
+    // Level strings are way too big to be buffered, so they're hashed as 
+    // they're read
+    bool onStreamKey(cc::PlistPath path, std::string_view key) override {
+        if (m_levels && key == "k4" && isLevel(path)) {
+            m_hasher = xxh::Hasher();
+            return true;
+        }
+        return false;
+    }
+    void onValueData(std::string_view data) override {
+        m_hasher.update(data);
+    }
+    void onValueEnd() override {
+        m_levels->back().hash = m_hasher.digest();
+    }
+};
+
+static void parseGameManagerInfo(std::string_view data, BackupInfo& info) {
+    auto handler = GameManagerInfoHandler(info);
+    cc::PlistReader(handler).feed(data);
+}
+static void parseLocalLevelsInfo(std::string_view data, BackupInfo& info, std::vector<BackupLevel>* levels) {
+    auto handler = LocalLevelsInfoHandler(info, levels);
+    cc::PlistReader(handler).feed(data);
+}
+
+static std::filesystem::path getSummaryPath(std::filesystem::path const& dir) {
+    return dir / "summary.json";
+}
+static std::filesystem::path getFingerprintPath(std::filesystem::path const& dir) {
+    return dir / "fingerprint.json";
+}
+
+// Decompresses and parses both save files, so this is slow for big saves. 
+// Backups never change after being created so the result is cached in the 
+// backup's summary
+Result<BackupInfo> core::computeInfo(
+    Storage& storage, std::filesystem::path const& dir, std::vector<BackupLevel>* levels,
+    std::function<bool()> const& isCancelled
+) {
+    auto info = BackupInfo();
+    info.hasGameManager = hasSaveFile(storage, dir, "CCGameManager.dat");
+    info.hasLocalLevels = hasSaveFile(storage, dir, "CCLocalLevels.dat");
+    // Both files are decoded at the same time. Their handlers fill in 
+    // different fields, so they can share the info
+    std::future<Result<>> gameManager;
+    if (info.hasGameManager) {
+        gameManager = std::async(std::launch::async, [&] {
+            auto handler = GameManagerInfoHandler(info);
+            auto reader = cc::PlistReader(handler);
+            return streamSaveFile(storage, dir, "CCGameManager.dat", [&](std::string_view data) {
+                reader.feed(data);
+            }, isCancelled);
+        });
+    }
+    std::optional<std::string> error;
+    if (info.hasLocalLevels) {
+        auto handler = LocalLevelsInfoHandler(info, levels);
+        auto reader = cc::PlistReader(handler);
+        auto res = streamSaveFile(storage, dir, "CCLocalLevels.dat", [&](std::string_view data) {
+            reader.feed(data);
+        }, isCancelled);
+        if (!res) {
+            error = fmt::format("Unable to read CCLocalLevels.dat: {}", res.unwrapErr());
+        }
+    }
+    // Has to be waited for even if the other file failed, since it's still 
+    // filling in the info
+    if (gameManager.valid()) {
+        auto res = gameManager.get();
+        if (!res) {
+            error = fmt::format("Unable to read CCGameManager.dat: {}", res.unwrapErr());
+        }
+    }
+    if (error) {
+        return Err(std::move(*error));
+    }
+    return Ok(std::move(info));
+}
+Result<std::vector<BackupLevel>> core::computeLevels(Storage& storage, std::filesystem::path const& dir) {
+    std::vector<BackupLevel> levels;
+    // Level packs already list every level, so nothing is decompressed
+    if (storage.exists(LevelPack::getTablePath(dir, "CCLocalLevels.dat"))) {
+        GEODE_UNWRAP_INTO(auto pack, LevelPack::open(storage, dir, "CCLocalLevels.dat"));
+        if (pack.hasLevelInfo()) {
+            for (auto const& level : pack.getLevels()) {
+                levels.push_back(BackupLevel { level.name, level.id, level.version, level.hash });
+            }
+            return Ok(std::move(levels));
+        }
+    }
+    auto info = BackupInfo();
+    if (hasSaveFile(storage, dir, "CCLocalLevels.dat")) {
+        auto handler = LocalLevelsInfoHandler(info, &levels);
+        auto reader = cc::PlistReader(handler);
+        auto res = streamSaveFile(storage, dir, "CCLocalLevels.dat", [&](std::string_view data) {
+            reader.feed(data);
+        });
+        if (!res) {
+            return Err("Unable to read CCLocalLevels.dat: {}", res.unwrapErr());
+        }
+    }
+    return Ok(std::move(levels));
+}
+
+template <class T>
+static Result<T> readJson(Storage const& storage, std::filesystem::path const& path) {
+    GEODE_UNWRAP_INTO(auto str, storage.read(path));
+    GEODE_UNWRAP_INTO(auto json, matjson::parse(str).mapErr([](auto const& err) {
+        return err.message;
+    }));
+    return json.template as<T>();
+}
+template <class T>
+static Result<> writeJson(Storage& storage, std::filesystem::path const& path, T const& value) {
+    return storage.write(path, matjson::Value(value).dump());
+}
+
+// Folder write times are used as a fallback for when backups were made
+static Time getWriteTime(Storage const& storage, std::filesystem::path const& path) {
+    auto time = storage.getWriteTime(path).value_or(std::filesystem::file_time_type());
+    return std::chrono::time_point_cast<Time::duration>(
+        time - std::filesystem::file_time_type::clock::now() + Clock::now()
+    );
+}
+
+static BackupEntry readEntry(Storage const& storage, std::filesystem::path const& path, bool& corrupt) {
+    auto entry = BackupEntry();
+    entry.path = path;
+    if (auto meta = readJson<BackupMetadata>(storage, path / "metadata.json")) {
+        entry.meta = *meta;
+    }
+    else {
+        entry.meta = BackupMetadata(getWriteTime(storage, path));
+        corrupt = true;
+    }
+    entry.autoRemove = storage.exists(path / "auto-remove.txt");
+    return entry;
+}
+BackupEntry BackupEntry::load(Storage& storage, std::filesystem::path const& path) {
+    bool corrupt = false;
+    auto entry = readEntry(storage, path, corrupt);
+    // Fix corrupt metadata
+    if (corrupt) {
+        (void)writeJson(storage, path / "metadata.json", entry.meta);
+    }
+    return entry;
+}
+BackupEntry BackupEntry::read(Storage const& storage, std::filesystem::path const& path) {
+    bool corrupt = false;
+    return readEntry(storage, path, corrupt);
+}
+
+Result<BackupInfo> core::loadInfo(
+    Storage& storage, std::filesystem::path const& dir, std::function<bool()> const& isCancelled
+) {
+    if (auto summary = readJson<BackupInfo>(storage, getSummaryPath(dir))) {
+        return summary;
+    }
+    // Backups made before summaries existed get theirs filled in the first 
+    // time they're needed. Only a summary of both files is worth keeping
+    GEODE_UNWRAP_INTO(auto info, computeInfo(storage, dir, nullptr, isCancelled));
+    (void)writeJson(storage, getSummaryPath(dir), info);
+    return Ok(std::move(info));
+}
+
+// Save files are hashed as they are on disk, which is much less data than 
+// what they decompress to
+static constexpr size_t HASH_BLOCK_SIZE = 1024 * 1024;
+
+Result<SaveFingerprint> core::fingerprintSaves(
+    Storage const& storage, std::filesystem::path const& saveDir, SaveFingerprint const* previous
+) {
+    auto fingerprint = SaveFingerprint();
+    std::string block;
+    for (auto name : { "CCGameManager.dat", "CCLocalLevels.dat" }) {
+        auto path = saveDir / name;
+        if (!storage.exists(path)) {
+            continue;
+        }
+        auto& file = fingerprint.files.emplace_back();
+        file.name = name;
+        file.size = storage.size(path);
+        file.time = storage.getWriteTime(path).value_or(std::filesystem::file_time_type()).time_since_epoch().count();
+        if (previous) {
+            auto same = std::find_if(previous->files.begin(), previous->files.end(), [&](auto const& other) {
+                return other.name == file.name && other.size == file.size && other.time == file.time;
+            });
+            if (same != previous->files.end()) {
+                file.hash = same->hash;
+                continue;
+            }
+        }
+        GEODE_UNWRAP_INTO(auto reader, storage.open(path));
+        auto hasher = xxh::Hasher();
+        block.resize(HASH_BLOCK_SIZE);
+        while (auto read = reader->read(block.data(), block.size())) {
+            hasher.update(std::string_view(block.data(), read));
+        }
+        file.hash = hasher.digest();
+    }
+    return Ok(std::move(fingerprint));
+}
+bool core::isUnchanged(Storage const& storage, std::filesystem::path const& saveDir, std::filesystem::path const& backup) {
+    auto previous = readJson<SaveFingerprint>(storage, getFingerprintPath(backup));
+    if (!previous) {
+        return false;
+    }
+    auto current = fingerprintSaves(storage, saveDir, &*previous);
+    return current && *current == *previous;
+}
+
+static std::shared_mutex STORE_MUTEX;
+// Imports migrate several backups at once while new ones may be made, and 
+// two of them may want the same name
+static std::mutex NAMING_MUTEX;
+
+std::shared_lock<std::shared_mutex> core::lockForAdding() {
+    return std::shared_lock(STORE_MUTEX);
+}
+
+// Tries the name and then ones with a number after it, creating the folder 
+// in the same step as checking it's free
+static Result<std::filesystem::path> createBackupFolder(
+    Storage& storage, std::filesystem::path const& backupsDir, std::string const& dirname, BackupIndex::Stamp& stamp
+) {
+    std::lock_guard lock(NAMING_MUTEX);
+    GEODE_UNWRAP(storage.createDirectories(backupsDir));
+    stamp = BackupIndex::begin(storage, backupsDir);
+    for (size_t num = 0;; num += 1) {
+        auto dir = backupsDir / (num == 0 ? dirname : dirname + "-" + std::to_string(num - 1));
+        GEODE_UNWRAP_INTO(auto created, storage.createDirectory(dir));
+        if (created) {
+            return Ok(dir);
+        }
+    }
+}
+
+static std::filesystem::path renameIntoBackups(
+    Storage& storage, std::filesystem::path const& backupsDir, std::string const& dirname,
+    std::filesystem::path const& from, BackupIndex::Stamp& stamp, std::error_code& ec
+) {
+    // Renaming can't fail if the target exists everywhere, so this relies on 
+    // new backups' folders being created under the same lock
+    std::lock_guard lock(NAMING_MUTEX);
+
+    std::string findname = dirname;
+    size_t num = 0;
+    while (storage.exists(backupsDir / findname)) {
+        findname = dirname + "-" + std::to_string(num);
+        num += 1;
+    }
+
+    auto dir = backupsDir / findname;
+    stamp = BackupIndex::begin(storage, backupsDir);
+    ec = storage.rename(from, dir);
+    return dir;
+}
+
+Result<> core::migrateBackup(
+    Storage& storage, std::filesystem::path const& backupsDir, std::filesystem::path const& existingDir,
+    std::string const& user, mover::ProgressCallback const& onProgress
+) {
+    GEODE_UNWRAP(storage.createDirectories(backupsDir));
+
+    // Backups moved from another backups directory keep their metadata as it 
+    // is, since it has their name, size, who made them and exactly when. 
+    // Otherwise try to infer backup creation date from folder write time
+    auto existingMeta = readJson<BackupMetadata>(storage, existingDir / "metadata.json");
+    auto time = existingMeta ? existingMeta->time : getWriteTime(storage, existingDir);
+
+    std::string dirname;
+    try {
+        // fmt::format uses exceptions :sob:
+        dirname = fmt::format("{:%Y-%m-%d_%H-%M}", time);
+    }
+    catch(...) {
+        dirname = "unktime";
+    }
+
+    BackupIndex::Stamp stamp;
+    std::error_code ec;
+    auto dir = renameIntoBackups(storage, backupsDir, dirname, existingDir, stamp, ec);
+
+    // Renaming doesn't work across drives, so the backup has to be copied. 
+    // The original is only removed once the copy has been checked. Only 
+    // local storage can ever fail like this
+    if (ec && mover::isCrossDevice(ec)) {
+        auto staging = mover::getStagingPath(backupsDir, existingDir);
+        auto copied = mover::copyVerified(existingDir, staging, onProgress);
+        if (!copied) {
+            return Err("Unable to copy backup: {}", copied.unwrapErr());
+        }
+        if (copied->resumed) {
+            log::info("Resumed moving {} ({} files were already copied)", existingDir, copied->resumed);
+        }
+        dir = renameIntoBackups(storage, backupsDir, dirname, staging, stamp, ec);
+        if (!ec) {
+            auto removed = storage.remove(existingDir);
+            if (!removed) {
+                log::warn("Moved {} but couldn't remove the original: {}", existingDir, removed.unwrapErr());
+            }
+        }
+    }
+    if (ec) {
+        return Err("Unable to migrate backup: {} (code {})", ec.message(), ec.value());
+    }
+
+    if (!existingMeta) {
+        auto meta = BackupMetadata(time);
+        meta.user = user;
+        GEODE_UNWRAP(writeJson(storage, dir / "metadata.json", meta));
+    }
+    BackupIndex::add(storage, backupsDir, stamp, BackupEntry::load(storage, dir));
+
+    return Ok();
+}
+
+bool core::isBackup(Storage const& storage, std::filesystem::path const& path) {
+    return hasSaveFile(storage, path, "CCGameManager.dat") || hasSaveFile(storage, path, "CCLocalLevels.dat");
+}
+bool core::isDeduplicated(Storage const& storage, std::filesystem::path const& dir) {
+    return 
+        storage.exists(getManifestPath(dir, "CCGameManager.dat")) ||
+        storage.exists(getManifestPath(dir, "CCLocalLevels.dat"));
+}
+
+Result<> core::restoreBackup(Storage& storage, std::filesystem::path const& path, std::filesystem::path const& saveDir) {
+    for (auto name : { "CCGameManager.dat", "CCLocalLevels.dat" }) {
+        if (!hasSaveFile(storage, path, name)) {
+            continue;
+        }
+        auto res = restoreSaveFile(storage, path, name, saveDir);
+        if (!res) {
+            return Err("Unable to restore backup: {}", res.unwrapErr());
+        }
+    }
+    return Ok();
+}
+Result<std::vector<std::string>> core::extractLevels(
+    Storage& storage, std::filesystem::path const& path, std::unordered_set<uint64_t> hashes
+) {
+    if (!hasSaveFile(storage, path, "CCLocalLevels.dat")) {
+        return Err("Backup has no levels");
+    }
+    std::vector<std::string> levels;
+    // Level packs know where every level is, so only those levels are read
+    if (storage.exists(LevelPack::getTablePath(path, "CCLocalLevels.dat"))) {
+        GEODE_UNWRAP_INTO(auto pack, LevelPack::open(storage, path, "CCLocalLevels.dat"));
+        for (size_t i = 0; i < pack.getLevels().size(); i += 1) {
+            if (hashes.contains(pack.getLevels()[i].hash)) {
+                GEODE_UNWRAP_INTO(auto level, pack.readLevel(i));
+                levels.push_back(std::move(level));
+            }
+        }
+    }
+    else {
+        auto scanner = cc::LevelScanner([&](cc::ScannedLevel const& level) {
+            if (hashes.contains(level.hash)) {
+                levels.emplace_back(level.data);
+            }
+        });
+        auto res = streamSaveFile(storage, path, "CCLocalLevels.dat", [&](std::string_view data) {
+            scanner.feed(data);
+        });
+        if (!res) {
+            return Err("Unable to read levels: {}", res.unwrapErr());
+        }
+    }
+    if (levels.empty()) {
+        return Err("Backup doesn't have {}", hashes.size() == 1 ? "that level" : "any of those levels");
+    }
+    return Ok(std::move(levels));
+}
+
+static std::vector<BackupEntry> scanBackupFolders(Storage& storage, std::filesystem::path const& dir, bool fixMetadata = true) {
+    std::vector<BackupEntry> entries;
+    for (auto b : storage.list(dir).unwrapOrDefault()) {
+        if (core::isBackup(storage, b)) {
+            entries.push_back(fixMetadata ? BackupEntry::load(storage, b) : BackupEntry::read(storage, b));
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](auto const& first, auto const& second) {
+        return core::isNewer(first, second);
+    });
+    return entries;
+}
+
+static void fixNestedBackupsIn(
+    Storage& storage, std::filesystem::path const& backupsDir, std::filesystem::path const& current,
+    std::string const& user
+) {
+    for (auto folder : storage.list(current).unwrapOrDefault()) {
+        if (core::isBackup(storage, folder)) {
+            fixNestedBackupsIn(storage, backupsDir, folder, user);
+            if (backupsDir != current) {
+                auto res = core::migrateBackup(storage, backupsDir, folder, user);
+                if (res) {
+                    log::info("Fixed nested backup {}", folder);
+                }
+                else {
+                    log::error("Unable to fix nested backup {}: {}", folder, res.unwrapErr());
+                }
+            }
+        }
+    }
+}
+// Nested backups can only come from old versions of the mod or from backups 
+// being copied in by hand, so the (slow) check for them is skipped as long 
+// as the index says the directory has been checked and hasn't changed since
+void core::fixNestedBackups(Storage& storage, std::filesystem::path const& backupsDir, std::string const& user) {
+    if (BackupIndex::hasCurrentLayout(storage, backupsDir)) {
+        return;
+    }
+    log::info("Fixing nested backups...");
+    auto lock = core::lockForAdding();
+    fixNestedBackupsIn(storage, backupsDir, backupsDir, user);
+    auto res = BackupIndex::write(
+        storage, backupsDir, scanBackupFolders(storage, backupsDir), BackupIndex::LAYOUT_VERSION
+    );
+    if (!res) {
+        log::warn("Unable to save backup index: {}", res.unwrapErr());
+    }
+}
+
+Result<NewBackup> core::writeBackup(Storage& storage, std::filesystem::path const& backupsDir, BackupOptions const& options) {
+    auto time = options.meta.time;
+    std::string dirname;
+    try {
+        // fmt::format uses exceptions :sob:
+        dirname = fmt::format("{:%Y-%m-%d_%H-%M}", time);
+    }
+    catch(...) {
+        dirname = "unktime";
+    }
+
+    // Held until the backup is done, so that chunks it reuses can't be 
+    // collected before its manifest has been written
+    auto lock = lockForAdding();
+    BackupIndex::Stamp stamp;
+    GEODE_UNWRAP_INTO(auto dir, createBackupFolder(storage, backupsDir, dirname, stamp));
+
+    auto saveDir = options.saveDir;
+    // Hashed before anything is stored, so if the save changes while the 
+    // backup is made, the next backup sees it as changed and not the other 
+    // way around
+    auto fingerprint = fingerprintSaves(storage, saveDir);
+    std::optional<BackupInfo> info;
+    std::vector<BackupLevel> levels;
+    size_t chunkBytes = 0;
+    if (options.storage != BackupStorage::Copies) {
+        // The save data is decompressed anyway, so get the summary from it 
+        // while we're at it
+        info.emplace();
+        bool summarized = true;
+        // Store the decompressed save data as chunks shared with other 
+        // backups or as a delta against the previous backup
+        auto store = ChunkStore(storage, backupsDir);
+        auto chain = DeltaChain(storage, backupsDir);
+        for (auto name : { "CCGameManager.dat", "CCLocalLevels.dat" }) {
+            if (!storage.exists(saveDir / name)) {
+                continue;
+            }
+            auto data = cc::parseCompressedCCFile(storage, saveDir / name);
+            // Files that can't be decoded are copied as-is so they can still 
+            // be restored, but then the summary would be missing them
+            if (!data || data->empty()) {
+                auto res = copySaveFile(storage, saveDir / name, dir / name, false);
+                if (!res) {
+                    return Err("Unable to create backup: {}", res.unwrapErr());
+                }
+                summarized = false;
+                continue;
+            }
+            if (name == std::string_view("CCGameManager.dat")) {
+                info->hasGameManager = true;
+                parseGameManagerInfo(*data, *info);
+            }
+            else {
+                info->hasLocalLevels = true;
+                parseLocalLevelsInfo(*data, *info, &levels);
+            }
+            if (options.storage == BackupStorage::Zstd || options.storage == BackupStorage::Levels) {
+                auto size = writeZstdSaveFile(storage, backupsDir, dir, name, *data, options);
+                if (size) {
+                    log::info("Stored {} with zstd ({} bytes written)", name, *size);
+                    continue;
+                }
+                log::warn("Storing {} as a copy since it can't be stored with zstd: {}", name, size.unwrapErr());
+                auto res = copySaveFile(storage, saveDir / name, dir / name, false);
+                if (!res) {
+                    return Err("Unable to create backup: {}", res.unwrapErr());
+                }
+                continue;
+            }
+            if (options.storage == BackupStorage::Delta) {
+                auto stats = chain.write(dir, name, *data, options.keyframeInterval);
+                if (!stats) {
+                    return Err("Unable to create backup: {}", stats.unwrapErr());
+                }
+                log::info(
+                    "Stored {} as a {} ({} bytes written)",
+                    name, stats->keyframe ? "keyframe" : "delta", stats->bytesWritten
+                );
+                continue;
+            }
+            auto stats = store.write(*data, getManifestPath(dir, name));
+            if (!stats) {
+                return Err("Unable to create backup: {}", stats.unwrapErr());
+            }
+            chunkBytes += stats->newChunkBytes;
+            log::info(
+                "Stored {} as {} chunks ({} new, {} bytes written)",
+                name, stats->chunkCount, stats->newChunkCount, stats->bytesWritten
+            );
+        }
+        if (!summarized) {
+            info = std::nullopt;
+        }
+    }
+    else {
+        // Copy CC files
+        for (auto name : { "CCGameManager.dat", "CCLocalLevels.dat" }) {
+            auto res = copySaveFile(storage, saveDir / name, dir / name, false);
+            if (!res) {
+                return Err("Unable to create backup: {}", res.unwrapErr());
+            }
+        }
+    }
+
+    // Not a big deal if this fails, it's recomputed when needed
+    if (!info) {
+        levels.clear();
+        info = computeInfo(storage, dir, &levels).ok();
+    }
+    // Otherwise the levels are incomplete too, so they're left for the next 
+    // time the level index is synced
+    if (info) {
+        (void)writeJson(storage, getSummaryPath(dir), *info);
+        LevelIndex::add(storage, backupsDir, dir, options.meta.time, levels);
+    }
+    // Without one the next automatic backup is made even if nothing changed
+    if (fingerprint) {
+        (void)writeJson(storage, getFingerprintPath(dir), *fingerprint);
+    }
+    else {
+        log::warn("Unable to fingerprint save files: {}", fingerprint.unwrapErr());
+    }
+
+    if (options.autoRemove) {
+        // Not a big deal if this fails
+        (void)storage.write(dir / "auto-remove.txt", fmt::format(
+            "This backup will be removed once your auto backup settings no longer keep it. The latest {} automated backups are always kept.\n\nIf you'd like to preserve this backup, delete this text file.",
+            options.retention.keepLast
+        ));
+    }
+
+    // Save metadata last so it can include the size of everything else
+    auto created = NewBackup();
+    created.entry.path = dir;
+    created.entry.meta = options.meta;
+    // Only stored to the second, so the backup is ordered the same after 
+    // being listed again
+    created.entry.meta.time = std::chrono::floor<std::chrono::seconds>(options.meta.time);
+    created.entry.meta.size = getBackupSize(storage, dir);
+    created.entry.autoRemove = options.autoRemove;
+    created.chunkBytes = chunkBytes;
+    GEODE_UNWRAP(writeJson(storage, dir / "metadata.json", created.entry.meta));
+    BackupIndex::add(storage, backupsDir, stamp, created.entry);
+
+    return Ok(std::move(created));
+}
+
+bool core::isNewer(Time time, std::string_view folder, Time otherTime, std::string_view otherFolder) {
+    if (time != otherTime) {
+        return time > otherTime;
+    }
+    // Numbered folders sort naturally, so that -10 comes after -9
+    if (folder.size() != otherFolder.size()) {
+        return folder.size() > otherFolder.size();
+    }
+    return folder > otherFolder;
+}
+bool core::isNewer(BackupEntry const& backup, BackupEntry const& other) {
+    return isNewer(
+        backup.meta.time, backup.path.filename().string(),
+        other.meta.time, other.path.filename().string()
+    );
+}
+
+std::vector<BackupEntry> core::scanBackups(Storage& storage, std::filesystem::path const& dir) {
+    if (auto entries = BackupIndex::read(storage, dir)) {
+        return std::move(*entries);
+    }
+
+    // Only scan every backup if the index is missing or out of date
+    log::info("Rebuilding backup index for {}", dir);
+    auto entries = scanBackupFolders(storage, dir);
+    auto res = BackupIndex::write(storage, dir, entries);
+    if (!res) {
+        log::warn("Unable to save backup index: {}", res.unwrapErr());
+    }
+    return entries;
+}
+std::vector<BackupEntry> core::listBackups(Storage& storage, std::filesystem::path const& dir) {
+    if (auto entries = BackupIndex::read(storage, dir)) {
+        return std::move(*entries);
+    }
+    return scanBackupFolders(storage, dir, false);
+}
+
+static Result<size_t> collectUnusedChunks(Storage& storage, std::filesystem::path const& dir) {
+    std::vector<std::filesystem::path> manifests;
+    for (auto b : storage.list(dir).unwrapOrDefault()) {
+        for (auto name : { "CCGameManager.dat", "CCLocalLevels.dat" }) {
+            auto manifest = getManifestPath(b, name);
+            if (storage.exists(manifest)) {
+                manifests.push_back(manifest);
+            }
+        }
+    }
+    return ChunkStore(storage, dir).collectGarbage(manifests);
+}
+
+Result<RemovedBackup> core::removeBackup(Storage& storage, std::filesystem::path const& path, bool batched) {
+    // Also keeps new delta backups from being based on this one while it's 
+    // being removed
+    std::unique_lock lock(STORE_MUTEX);
+    auto removed = RemovedBackup();
+    auto dir = path.parent_path();
+
+    // Backups that only store their changes compared to this one need to be 
+    // made whole first. If that fails, deleting this one would lose them
+    auto detached = DeltaChain(storage, dir).detach(path);
+    if (!detached) {
+        return Err("Unable to delete backup: {}", detached.unwrapErr());
+    }
+    for (auto& other : *detached) {
+        auto entry = BackupEntry::load(storage, other);
+        auto oldSize = entry.meta.size.value_or(0);
+        entry.meta.size = getBackupSize(storage, other);
+        if (*entry.meta.size > oldSize) {
+            removed.detachedBytes += *entry.meta.size - oldSize;
+        }
+        auto stamp = BackupIndex::begin(storage, dir);
+        (void)writeJson(storage, other / "metadata.json", entry.meta);
+        BackupIndex::update(storage, dir, stamp, entry);
+        log::info("Turned {} into a full backup", other.filename());
+    }
+    removed.detached = std::move(*detached);
+
+    removed.deduplicated = isDeduplicated(storage, path);
+    auto stamp = BackupIndex::begin(storage, dir);
+    auto res = storage.remove(path);
+    if (!res) {
+        return Err("Unable to delete backup: {}", res.unwrapErr());
+    }
+    BackupIndex::remove(storage, dir, stamp, path);
+    if (batched) {
+        return Ok(std::move(removed));
+    }
+    LevelIndex::remove(storage, dir, { path });
+    if (removed.deduplicated) {
+        // Not a big deal if this fails, the chunks will be collected next time
+        auto gc = collectUnusedChunks(storage, dir);
+        if (gc) {
+            removed.freedChunkBytes = *gc;
+        }
+        else {
+            log::error("Unable to clean up unused chunks: {}", gc.unwrapErr());
+        }
+    }
+    return Ok(std::move(removed));
+}
+
+// Periods are numbered so that consecutive ones differ by one
+static int64_t getHour(Time time) {
+    return std::chrono::floor<std::chrono::hours>(time).time_since_epoch().count();
+}
+static int64_t getDay(Time time) {
+    return std::chrono::floor<std::chrono::days>(time).time_since_epoch().count();
+}
+static int64_t getWeek(Time time) {
+    // Shifted so weeks start on Monday, since the epoch was a Thursday
+    auto day = std::chrono::floor<std::chrono::days>(time) + std::chrono::days(3);
+    return std::chrono::floor<std::chrono::weeks>(day).time_since_epoch().count();
+}
+static int64_t getMonth(Time time) {
+    auto date = std::chrono::year_month_day(std::chrono::floor<std::chrono::days>(time));
+    return static_cast<int>(date.year()) * 12 + static_cast<unsigned>(date.month());
+}
+
+RetentionPlan core::planRetention(
+    std::vector<BackupEntry> backups, RetentionPolicy const& policy, std::optional<size_t> totalSize
+) {
+    // Backups are usually scanned newest first already, but the plan 
+    // shouldn't depend on that
+    std::sort(backups.begin(), backups.end(), [](auto const& a, auto const& b) {
+        return isNewer(a, b);
+    });
+
+    std::vector<bool> keep(backups.size());
+    std::optional<size_t> newest;
+    size_t automated = 0;
+    for (size_t i = 0; i < backups.size(); i += 1) {
+        if (!backups[i].autoRemove) {
+            keep[i] = true;
+            continue;
+        }
+        if (!newest) {
+            newest = i;
+        }
+        if (automated < policy.keepLast) {
+            keep[i] = true;
+        }
+        automated += 1;
+    }
+    // Since backups are sorted, the first one in each period is its newest
+    auto keepPeriods = [&](size_t count, int64_t(*getPeriod)(Time)) {
+        std::optional<int64_t> last;
+        for (size_t i = 0; i < backups.size() && count > 0; i += 1) {
+            if (!backups[i].autoRemove) {
+                continue;
+            }
+            auto period = getPeriod(backups[i].meta.time);
+            if (period != last) {
+                last = period;
+                keep[i] = true;
+                count -= 1;
+            }
+        }
+    };
+    keepPeriods(policy.keepHourly, &getHour);
+    keepPeriods(policy.keepDaily, &getDay);
+    keepPeriods(policy.keepWeekly, &getWeek);
+    keepPeriods(policy.keepMonthly, &getMonth);
+
+    if (policy.byteBudget) {
+        size_t total = 0;
+        size_t backupBytes = 0;
+        for (size_t i = 0; i < backups.size(); i += 1) {
+            backupBytes += backups[i].meta.size.value_or(0);
+            if (keep[i]) {
+                total += backups[i].meta.size.value_or(0);
+            }
+        }
+        // Chunks, keyframes and the rest of what's shared stay counted in 
+        // full, so the budget is never thought to be met before it is
+        if (totalSize && *totalSize > backupBytes) {
+            total += *totalSize - backupBytes;
+        }
+        for (size_t i = backups.size(); i > 0 && total > policy.byteBudget; i -= 1) {
+            auto& entry = backups[i - 1];
+            if (keep[i - 1] && entry.autoRemove && i - 1 != newest) {
+                keep[i - 1] = false;
+                total -= std::min(total, entry.meta.size.value_or(0));
+            }
+        }
+    }
+
+    auto plan = RetentionPlan();
+    for (size_t i = 0; i < backups.size(); i += 1) {
+        auto size = backups[i].meta.size.value_or(0);
+        if (keep[i]) {
+            plan.keptBytes += size;
+            plan.kept.push_back(std::move(backups[i]));
+        }
+        else {
+            plan.removedBytes += size;
+            plan.removed.push_back(std::move(backups[i]));
+        }
+    }
+    return plan;
+}
+
+CleanupResult core::removeBackups(
+    Storage& storage, std::vector<BackupEntry> backups, std::function<bool()> const& isCancelled
+) {
+    auto result = CleanupResult();
+    // Where chunks need collecting, if any deduplicated backups were removed
+    std::optional<std::filesystem::path> chunksDir;
+    std::vector<std::filesystem::path> removed;
+    for (auto& entry : backups) {
+        if (!(isCancelled && isCancelled())) {
+            // Every collection reads every manifest and the level index is 
+            // rewritten as a whole, so both are only done once at the end
+            auto res = removeBackup(storage, entry.path, true);
+            if (res) {
+                if (res->deduplicated) {
+                    chunksDir = entry.path.parent_path();
+                }
+                removed.push_back(entry.path);
+                result.detachedBytes += res->detachedBytes;
+                result.detached.insert(result.detached.end(), res->detached.begin(), res->detached.end());
+                result.removed.push_back(std::move(entry));
+                continue;
+            }
+            log::error("Unable to remove backup {}: {}", entry.path, res.unwrapErr());
+            if (!result.error) {
+                result.error = res.unwrapErr();
+            }
+        }
+        result.kept.push_back(std::move(entry));
+    }
+    if (!removed.empty()) {
+        LevelIndex::remove(storage, removed.front().parent_path(), removed);
+    }
+    if (chunksDir) {
+        auto gc = collectChunks(storage, *chunksDir);
+        if (gc) {
+            result.freedChunkBytes = *gc;
+        }
+        else {
+            log::error("Unable to clean up unused chunks: {}", gc.unwrapErr());
+        }
+    }
+    return result;
+}
+
+CleanupResult core::cleanupAutomated(
+    Storage& storage, std::filesystem::path const& dir, std::vector<BackupEntry> backups,
+    RetentionPolicy const& policy, std::function<bool()> const& isCancelled
+) {
+    // Measuring reads the size of every file, so it's only done if needed
+    std::optional<size_t> totalSize;
+    if (policy.byteBudget) {
+        totalSize = measureSizes(storage, dir).total;
+    }
+    auto plan = planRetention(std::move(backups), policy, totalSize);
+    auto result = removeBackups(storage, std::move(plan.removed), isCancelled);
+    result.kept.insert(result.kept.end(), plan.kept.begin(), plan.kept.end());
+    std::sort(result.kept.begin(), result.kept.end(), [](auto const& a, auto const& b) {
+        return isNewer(a, b);
+    });
+    // Backups that were made whole have new sizes
+    for (auto& entry : result.kept) {
+        if (std::find(result.detached.begin(), result.detached.end(), entry.path) != result.detached.end()) {
+            entry = BackupEntry::load(storage, entry.path);
+        }
+    }
+    return result;
+}
+
+Result<size_t> core::collectChunks(Storage& storage, std::filesystem::path const& dir) {
+    std::unique_lock lock(STORE_MUTEX);
+    return collectUnusedChunks(storage, dir);
+}
+
+BackupSizes core::measureSizes(Storage const& storage, std::filesystem::path const& dir) {
+    auto sizes = BackupSizes();
+    for (auto entry : storage.list(dir).unwrapOrDefault()) {
+        auto size = storage.size(entry);
+        sizes.total += size;
+        if (storage.isDirectory(entry) && isBackup(storage, entry)) {
+            sizes.backups.emplace_back(entry, size - storage.size(entry / "metadata.json"));
+        }
+    }
+    return sizes;
+}
@@ -0,0 +1,311 @@
+#pragma once
+
+#include "Platform.hpp"
+#include "Mover.hpp"
+#include "Storage.hpp"
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Everything about backups that only touches files, all of which goes 
+// through the given storage. Nothing here reads the game's state or the 
+// mod's settings; whatever it needs is passed in, so it can run on any 
+// thread and is also built without the game for the command line tool
+
+using Clock = std::chrono::system_clock;
+using Time = std::chrono::time_point<Clock>;
+
+struct BackupMetadata final {
+	std::optional<std::string> name;
+	// Empty if it's not known who made the backup
+	std::string user;
+	Time time = Clock::now();
+	// Size of the backup's files in bytes, excluding the metadata itself.
+	// Missing for imported backups until sizes are reconciled
+	std::optional<size_t> size;
+
+	inline BackupMetadata() = default;
+	inline BackupMetadata(Time time) : time(time) {}
+};
+
+template <>
+struct matjson::Serialize<BackupMetadata> {
+    static matjson::Value toJson(BackupMetadata const& info);
+    static Result<BackupMetadata> fromJson(matjson::Value const& value);
+};
+
+struct BackupInfo final {
+	// Bump whenever what's stored in summaries changes so old ones get
+	// recomputed
+	static constexpr int VERSION = 1;
+	// Only the first few level names are kept for the preview
+	static constexpr size_t MAX_LEVEL_NAMES = 12;
+
+	int playerIcon = 0;
+	int playerColor1 = 0;
+	int playerColor2 = 0;
+	std::optional<int> playerGlow = 0;
+	int starCount = 0;
+	bool hasGameManager = false;
+	bool hasLocalLevels = false;
+	size_t levelCount = 0;
+	std::vector<std::string> levels;
+};
+
+template <>
+struct matjson::Serialize<BackupInfo> {
+    static matjson::Value toJson(BackupInfo const& info);
+    static Result<BackupInfo> fromJson(matjson::Value const& value);
+};
+
+// The save files a backup was made from, as they were on disk, so whether 
+// they've changed since can be told without reading the backup
+struct SaveFingerprint final {
+	static constexpr int VERSION = 1;
+
+	struct File final {
+		std::string name;
+		size_t size = 0;
+		// Write time when it was hashed. Files with the same size and write 
+		// time are assumed to be the same without hashing them again
+		int64_t time = 0;
+		// XXH64 of the file as the game saved it
+		uint64_t hash = 0;
+	};
+	// Only files that exist
+	std::vector<File> files;
+
+	// Write times aren't compared, so copies of the same save still match
+	bool operator==(SaveFingerprint const& other) const;
+};
+
+template <>
+struct matjson::Serialize<SaveFingerprint> {
+    static matjson::Value toJson(SaveFingerprint const& fingerprint);
+    static Result<SaveFingerprint> fromJson(matjson::Value const& value);
+};
+
+// A level in a backup's CCLocalLevels.dat, as kept in the level index
+struct BackupLevel final {
+	std::string name;
+	// Online ID, 0 if the level was never uploaded
+	int id = 0;
+	// Version shown in the editor
+	int version = 0;
+	// XXH64 of the level string, so any edit to the level changes it
+	uint64_t hash = 0;
+};
+
+// Plain data describing a backup on disk. Unlike Backup, this is safe to
+// create and pass around on any thread
+struct BackupEntry final {
+	std::filesystem::path path;
+	BackupMetadata meta;
+	bool autoRemove = false;
+
+	// Fixes up missing or corrupt metadata
+	static BackupEntry load(Storage& storage, std::filesystem::path const& path);
+	// Like load, but never writes anything
+	static BackupEntry read(Storage const& storage, std::filesystem::path const& path);
+};
+
+enum class BackupStorage {
+	Copies,
+	// Save data split into chunks shared by all backups
+	Deduplicated,
+	// Save data stored as a diff against the previous backup
+	Delta,
+	// Save data stored as zstd-compressed XML
+	Zstd,
+	// Like Zstd, but every level in CCLocalLevels.dat is compressed on its 
+	// own so a single level can be read without the rest of the save
+	Levels,
+};
+
+// Which automated backups to keep. Manual backups are always kept. Periods
+// are counted in UTC, and only periods that have an automated backup count
+// towards their limit
+struct RetentionPolicy final {
+	// Newest automated backups to keep
+	size_t keepLast = 5;
+	// The newest automated backup of each of this many of the latest hours,
+	// days, weeks (starting on Monday) and months
+	size_t keepHourly = 0;
+	size_t keepDaily = 0;
+	size_t keepWeekly = 0;
+	size_t keepMonthly = 0;
+	// Total size of the backups directory, manual backups and shared chunks 
+	// included, to stay under by removing the oldest automated backups the 
+	// rules above would keep. The newest automated backup is always kept. 0 
+	// for no limit
+	size_t byteBudget = 0;
+};
+
+// What cleaning up would do, decided from the backups' metadata alone
+struct RetentionPlan final {
+	// Both newest first
+	std::vector<BackupEntry> kept;
+	std::vector<BackupEntry> removed;
+	// Sizes from the backups' metadata, which don't include chunks shared
+	// with other deduplicated backups, nor how much delta backups based on
+	// removed ones grow
+	size_t keptBytes = 0;
+	size_t removedBytes = 0;
+};
+
+// Everything needed to write a backup. The mod reads these from its
+// settings on the main thread so the writing itself can happen anywhere
+struct BackupOptions final {
+	BackupMetadata meta;
+	// Where the save files being backed up are
+	std::filesystem::path saveDir;
+	bool autoRemove = false;
+	BackupStorage storage = BackupStorage::Copies;
+	// How many delta backups there can be in a row before a full copy
+	size_t keyframeInterval = 10;
+	int zstdLevel = 9;
+	bool zstdDictionary = false;
+	// How automated backups are cleaned up, which auto-remove.txt explains
+	RetentionPolicy retention;
+};
+
+struct NewBackup final {
+	BackupEntry entry;
+	// Bytes added to the shared chunk store for deduplicated backups
+	size_t chunkBytes = 0;
+};
+
+struct RemovedBackup final {
+	bool deduplicated = false;
+	// Bytes freed from the shared chunk store for deduplicated backups
+	size_t freedChunkBytes = 0;
+	// Delta backups that were based on the removed one are turned into full
+	// copies, which makes them larger
+	std::vector<std::filesystem::path> detached;
+	size_t detachedBytes = 0;
+};
+
+struct CleanupResult final {
+	// Newest first, with the sizes of detached backups updated
+	std::vector<BackupEntry> kept;
+	std::vector<BackupEntry> removed;
+	size_t freedChunkBytes = 0;
+	// Kept backups that were turned into full copies
+	std::vector<std::filesystem::path> detached;
+	size_t detachedBytes = 0;
+	// Why the first backup that couldn't be removed wasn't
+	std::optional<std::string> error;
+};
+
+struct BackupSizes final {
+	size_t total = 0;
+	std::vector<std::pair<std::filesystem::path, size_t>> backups;
+};
+
+namespace core {
+    bool isBackup(Storage const& storage, std::filesystem::path const& dir);
+    bool isDeduplicated(Storage const& storage, std::filesystem::path const& dir);
+    // Whether the backup has the save file, no matter how it's stored
+    bool hasSaveFile(Storage const& storage, std::filesystem::path const& dir, std::string_view name);
+
+    // Backups in a directory share chunks, delta bases and dictionaries, so 
+    // nothing can be added while backups are being removed or unused chunks 
+    // collected. Adding holds this shared, which writeBackup does by itself. 
+    // Imports hold it for as long as they're moving chunks and backups in, 
+    // since the chunks arrive before the backups using them
+    std::shared_lock<std::shared_mutex> lockForAdding();
+
+    // Whether a backup in `folder` made at `time` is newer than the other 
+    // one. Backups made in the same second are ordered by folder name, since 
+    // a folder gets a number after its name if that name was already taken
+    bool isNewer(Time time, std::string_view folder, Time otherTime, std::string_view otherFolder);
+    bool isNewer(BackupEntry const& backup, BackupEntry const& other);
+
+    // Sorted from newest to oldest. Uses the backup index if it's up to date
+    std::vector<BackupEntry> scanBackups(Storage& storage, std::filesystem::path const& dir);
+    // Like scanBackups, but doesn't rebuild the index or fix up metadata, so 
+    // it can be used while a backup is being written into the directory
+    std::vector<BackupEntry> listBackups(Storage& storage, std::filesystem::path const& dir);
+    // The save directory is read through the same storage
+    Result<NewBackup> writeBackup(Storage& storage, std::filesystem::path const& dir, BackupOptions const& options);
+    // Chunks only the removed backup used are collected and the level index 
+    // updated right away, unless `batched` is true because several backups 
+    // are being removed at once and that's done once at the end
+    Result<RemovedBackup> removeBackup(Storage& storage, std::filesystem::path const& path, bool batched = false);
+    // Hashes the save files in saveDir. Files whose size and write time 
+    // match `previous` are taken from it instead of being read
+    Result<SaveFingerprint> fingerprintSaves(
+        Storage const& storage, std::filesystem::path const& saveDir, SaveFingerprint const* previous = nullptr
+    );
+    // Whether the save files in saveDir are the same ones the backup was made 
+    // from. False for backups made before fingerprints were saved
+    bool isUnchanged(Storage const& storage, std::filesystem::path const& saveDir, std::filesystem::path const& backup);
+    // Overwrites the save files in saveDir with the ones in the backup
+    Result<> restoreBackup(Storage& storage, std::filesystem::path const& path, std::filesystem::path const& saveDir);
+    // Copies the levels whose level strings have the given hashes out of the 
+    // backup's CCLocalLevels.dat, as the <d> elements they're stored as
+    Result<std::vector<std::string>> extractLevels(
+        Storage& storage, std::filesystem::path const& path, std::unordered_set<uint64_t> hashes
+    );
+    // Moves an existing backup into the backups directory. Backups that have
+    // metadata keep it, otherwise the user is who the backup will be listed
+    // as being made by. Moves across drives are
+    // copied and checked before the original is removed, in which case
+    // progress is reported in bytes. The caller has to hold lockForAdding
+    Result<> migrateBackup(
+        Storage& storage, std::filesystem::path const& backupsDir, std::filesystem::path const& existingDir,
+        std::string const& user, mover::ProgressCallback const& onProgress = nullptr
+    );
+    // Decides which automated backups the policy removes without touching
+    // any files, so it can be shown before anything is removed. The byte 
+    // budget is checked against `totalSize` if given, which should be the 
+    // size of the whole directory, since data shared between backups isn't 
+    // part of any one backup's size
+    RetentionPlan planRetention(
+        std::vector<BackupEntry> backups, RetentionPolicy const& policy,
+        std::optional<size_t> totalSize = std::nullopt
+    );
+    // Removes several backups, collecting unused chunks once at the end. 
+    // Stops early if `isCancelled` returns true, keeping the rest
+    CleanupResult removeBackups(
+        Storage& storage, std::vector<BackupEntry> backups, std::function<bool()> const& isCancelled = nullptr
+    );
+    // Removes the automated backups the policy doesn't keep. Stops early if
+    // `isCancelled` returns true, keeping the rest
+    CleanupResult cleanupAutomated(
+        Storage& storage, std::filesystem::path const& dir, std::vector<BackupEntry> backups,
+        RetentionPolicy const& policy, std::function<bool()> const& isCancelled = nullptr
+    );
+    // Restoring a backup in old versions of the mod resulted in the new
+    // backup being nested inside the old one. Skipped if the index says the
+    // directory has already been checked
+    void fixNestedBackups(Storage& storage, std::filesystem::path const& dir, std::string const& user);
+    Result<size_t> collectChunks(Storage& storage, std::filesystem::path const& dir);
+
+    // Decompresses and parses the save files, which is slow for big saves. 
+    // Every level is also listed in `levels` if given. The two files are 
+    // decoded on separate threads, and both stop early if `isCancelled` 
+    // (which is called from either of them) returns true. Fails if either 
+    // file couldn't be read in full
+    Result<BackupInfo> computeInfo(
+        Storage& storage, std::filesystem::path const& dir, std::vector<BackupLevel>* levels = nullptr,
+        std::function<bool()> const& isCancelled = nullptr
+    );
+    // Only decompresses CCLocalLevels.dat, and not even that for level packs
+    Result<std::vector<BackupLevel>> computeLevels(Storage& storage, std::filesystem::path const& dir);
+    // Reads the summary saved with the backup, computing it first if needed. 
+    // Summaries are only saved if they could be computed in full
+    Result<BackupInfo> loadInfo(
+        Storage& storage, std::filesystem::path const& dir, std::function<bool()> const& isCancelled = nullptr
+    );
+
+    // Excludes the backup's metadata
+    size_t getBackupSize(Storage const& storage, std::filesystem::path const& dir);
+    // Walks the whole backups directory
+    BackupSizes measureSizes(Storage const& storage, std::filesystem::path const& dir);
+}
@@ -0,0 +1,303 @@
+#include "BackupIndex.hpp"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+// Every record is the same size so the index can be read in one go without 
+// any parsing. Integers are stored as-is; every platform the mod runs on is 
+// little-endian
+struct IndexHeader final {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    int64_t stamp;
+    uint32_t layout;
+    // Files and folders directly in the directory, including the index
+    uint32_t entries;
+};
+static_assert(sizeof(IndexHeader) == 32);
+
+struct IndexRecord final {
+    // Folder name, relative to the backups directory
+    char folder[96];
+    char user[32];
+    char name[64];
+    int64_t time;
+    uint64_t size;
+    uint8_t flags;
+    char reserved[47];
+};
+static_assert(sizeof(IndexRecord) == 256);
+
+static constexpr char INDEX_MAGIC[8] = { 'B', 'K', 'P', 'I', 'N', 'D', 'E', 'X' };
+
+enum IndexFlags : uint8_t {
+    AutoRemove = 1 << 0,
+    HasName    = 1 << 1,
+    HasSize    = 1 << 2,
+    // Something didn't fit in the record, so metadata.json has to be read
+    Overflow   = 1 << 3,
+};
+
+// Backups are created from both the main thread and the automatic backup job
+static std::mutex INDEX_MUTEX;
+
+static std::filesystem::path getIndexPath(std::filesystem::path const& dir) {
+    return dir / BackupIndex::FILE_NAME;
+}
+static std::optional<int64_t> getStamp(Storage const& storage, std::filesystem::path const& dir) {
+    auto time = storage.getWriteTime(dir);
+    if (!time) {
+        return std::nullopt;
+    }
+    return static_cast<int64_t>(time->time_since_epoch().count());
+}
+static std::optional<uint32_t> getEntryCount(Storage const& storage, std::filesystem::path const& dir) {
+    auto entries = storage.list(dir);
+    if (!entries) {
+        return std::nullopt;
+    }
+    return static_cast<uint32_t>(entries->size());
+}
+
+template <size_t N>
+static bool copyString(char (&to)[N], std::string_view from) {
+    // Always leave room for the null terminator
+    if (from.size() >= N) {
+        return false;
+    }
+    std::memcpy(to, from.data(), from.size());
+    return true;
+}
+template <size_t N>
+static std::string_view readString(char const (&from)[N]) {
+    return std::string_view(from, strnlen(from, N));
+}
+
+static IndexRecord toRecord(BackupEntry const& entry) {
+    auto record = IndexRecord();
+    bool fits = copyString(record.folder, entry.path.filename().string());
+    fits = copyString(record.user, entry.meta.user) && fits;
+    if (entry.meta.name) {
+        record.flags |= HasName;
+        fits = copyString(record.name, *entry.meta.name) && fits;
+    }
+    record.time = std::chrono::duration_cast<std::chrono::seconds>(entry.meta.time.time_since_epoch()).count();
+    if (entry.meta.size) {
+        record.flags |= HasSize;
+        record.size = *entry.meta.size;
+    }
+    if (entry.autoRemove) {
+        record.flags |= AutoRemove;
+    }
+    if (!fits) {
+        record.flags |= Overflow;
+    }
+    return record;
+}
+static BackupEntry fromRecord(Storage& storage, std::filesystem::path const& dir, IndexRecord const& record) {
+    auto path = dir / readString(record.folder);
+    if (record.flags & Overflow) {
+        return BackupEntry::read(storage, path);
+    }
+    auto entry = BackupEntry();
+    entry.path = path;
+    entry.meta.user = readString(record.user);
+    if (record.flags & HasName) {
+        entry.meta.name = std::string(readString(record.name));
+    }
+    entry.meta.time = Time(std::chrono::seconds(record.time));
+    if (record.flags & HasSize) {
+        entry.meta.size = static_cast<size_t>(record.size);
+    }
+    entry.autoRemove = record.flags & AutoRemove;
+    return entry;
+}
+
+static std::optional<IndexHeader> readHeader(std::string_view data) {
+    auto header = IndexHeader();
+    if (data.size() < sizeof(header)) {
+        return std::nullopt;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 || header.version != BackupIndex::VERSION) {
+        return std::nullopt;
+    }
+    return header;
+}
+// Reads the header of an index that's up to date with the directory
+static std::optional<IndexHeader> readFreshHeader(Storage const& storage, std::filesystem::path const& dir) {
+    auto data = storage.read(getIndexPath(dir));
+    auto header = data ? readHeader(*data) : std::nullopt;
+    if (!header || getStamp(storage, dir) != header->stamp || getEntryCount(storage, dir) != header->entries) {
+        return std::nullopt;
+    }
+    return header;
+}
+
+// If a stamp is given, the index is only read if it matches, otherwise it 
+// has to match the directory's current write time and entry count
+static std::optional<std::vector<IndexRecord>> readRecords(
+    Storage const& storage, std::filesystem::path const& dir, BackupIndex::Stamp const& stamp, IndexHeader& header
+) {
+    auto data = storage.read(getIndexPath(dir));
+    if (!data) {
+        return std::nullopt;
+    }
+    auto read = readHeader(*data);
+    if (!read) {
+        return std::nullopt;
+    }
+    bool fresh = stamp ?
+        read->stamp == stamp :
+        (read->stamp == getStamp(storage, dir) && read->entries == getEntryCount(storage, dir));
+    if (!fresh) {
+        return std::nullopt;
+    }
+    header = *read;
+    std::vector<IndexRecord> records(header.count);
+    auto size = records.size() * sizeof(IndexRecord);
+    if (data->size() < sizeof(IndexHeader) + size) {
+        return std::nullopt;
+    }
+    std::memcpy(records.data(), data->data() + sizeof(IndexHeader), size);
+    return records;
+}
+static Result<> writeRecords(
+    Storage& storage, std::filesystem::path const& dir, std::vector<IndexRecord> const& records, uint32_t layout
+) {
+    auto path = getIndexPath(dir);
+
+    auto header = IndexHeader();
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = BackupIndex::VERSION;
+    header.count = static_cast<uint32_t>(records.size());
+    header.layout = layout;
+    std::string data;
+    data.append(reinterpret_cast<char const*>(&header), sizeof(header));
+    data.append(reinterpret_cast<char const*>(records.data()), records.size() * sizeof(IndexRecord));
+    auto res = storage.write(path, data);
+    if (!res) {
+        return Err("Unable to replace backup index: {}", res.unwrapErr());
+    }
+
+    // Replacing the index changes the directory's write time too (and its 
+    // entry count if there was no index yet), so the stamp can only be 
+    // filled in afterwards. Writing in place doesn't touch the directory
+    auto stamp = getStamp(storage, dir);
+    auto entries = getEntryCount(storage, dir);
+    if (!stamp || !entries) {
+        return Err("Unable to read backup directory write time");
+    }
+    auto patched = storage.patch(
+        path, offsetof(IndexHeader, stamp),
+        std::string_view(reinterpret_cast<char const*>(&*stamp), sizeof(*stamp))
+    );
+    if (patched) {
+        patched = storage.patch(
+            path, offsetof(IndexHeader, entries),
+            std::string_view(reinterpret_cast<char const*>(&*entries), sizeof(*entries))
+        );
+    }
+    if (!patched) {
+        return Err("Unable to write backup index: {}", patched.unwrapErr());
+    }
+    return Ok();
+}
+
+static void modifyRecords(
+    Storage& storage, std::filesystem::path const& dir, BackupIndex::Stamp const& stamp, auto&& modify
+) {
+    std::lock_guard lock(INDEX_MUTEX);
+    // The change being recorded has already touched the directory, so the 
+    // index is checked against the stamp from before it instead
+    auto header = IndexHeader();
+    auto records = stamp ? readRecords(storage, dir, stamp, header) : std::nullopt;
+    if (!records) {
+        // Something else changed the directory, so we can't know what the 
+        // index should look like anymore
+        (void)storage.remove(getIndexPath(dir));
+        return;
+    }
+    modify(*records);
+    auto res = writeRecords(storage, dir, *records, header.layout);
+    if (!res) {
+        log::warn("{}", res.unwrapErr());
+        // A half-updated index is worse than none
+        (void)storage.remove(getIndexPath(dir));
+    }
+}
+
+std::optional<std::vector<BackupEntry>> BackupIndex::read(Storage& storage, std::filesystem::path const& dir) {
+    std::lock_guard lock(INDEX_MUTEX);
+    auto header = IndexHeader();
+    auto records = readRecords(storage, dir, std::nullopt, header);
+    if (!records) {
+        return std::nullopt;
+    }
+    std::vector<BackupEntry> entries;
+    entries.reserve(records->size());
+    for (auto& record : *records) {
+        entries.push_back(fromRecord(storage, dir, record));
+    }
+    return entries;
+}
+Result<> BackupIndex::write(
+    Storage& storage, std::filesystem::path const& dir, std::vector<BackupEntry> const& entries, uint32_t layout
+) {
+    std::lock_guard lock(INDEX_MUTEX);
+    std::vector<IndexRecord> records;
+    records.reserve(entries.size());
+    for (auto& entry : entries) {
+        records.push_back(toRecord(entry));
+    }
+    return writeRecords(storage, dir, records, layout);
+}
+bool BackupIndex::hasCurrentLayout(Storage const& storage, std::filesystem::path const& dir) {
+    std::lock_guard lock(INDEX_MUTEX);
+    auto header = readFreshHeader(storage, dir);
+    return header && header->layout >= LAYOUT_VERSION;
+}
+
+BackupIndex::Stamp BackupIndex::begin(Storage const& storage, std::filesystem::path const& dir) {
+    std::lock_guard lock(INDEX_MUTEX);
+    if (auto header = readFreshHeader(storage, dir)) {
+        return header->stamp;
+    }
+    return std::nullopt;
+}
+void BackupIndex::add(Storage& storage, std::filesystem::path const& dir, Stamp const& stamp, BackupEntry const& entry) {
+    modifyRecords(storage, dir, stamp, [&](std::vector<IndexRecord>& records) {
+        auto folder = entry.path.filename().string();
+        std::erase_if(records, [&](IndexRecord const& record) {
+            return readString(record.folder) == folder;
+        });
+        // Kept sorted from newest to oldest like the listing
+        auto record = toRecord(entry);
+        auto it = std::find_if(records.begin(), records.end(), [&](IndexRecord const& other) {
+            return !core::isNewer(
+                Time(std::chrono::seconds(other.time)), readString(other.folder),
+                Time(std::chrono::seconds(record.time)), folder
+            );
+        });
+        records.insert(it, record);
+    });
+}
+void BackupIndex::remove(Storage& storage, std::filesystem::path const& dir, Stamp const& stamp, std::filesystem::path const& path) {
+    auto folder = path.filename().string();
+    modifyRecords(storage, dir, stamp, [&](std::vector<IndexRecord>& records) {
+        std::erase_if(records, [&](IndexRecord const& record) {
+            return readString(record.folder) == folder;
+        });
+    });
+}
+void BackupIndex::update(Storage& storage, std::filesystem::path const& dir, Stamp const& stamp, BackupEntry const& entry) {
+    auto folder = entry.path.filename().string();
+    modifyRecords(storage, dir, stamp, [&](std::vector<IndexRecord>& records) {
+        for (auto& record : records) {
+            if (readString(record.folder) == folder) {
+                record = toRecord(entry);
+            }
+        }
+    });
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "BackupCore.hpp"
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+// Compact listing of every backup in a backups directory, so showing the 
+// list only needs to read one file instead of every backup's metadata. The 
+// index is stamped with the directory's write time and how many entries it 
+// has, so backups added or removed by something other than the mod make it 
+// stale, in which case the directory is scanned and the index rewritten. The 
+// count catches what write times miss on drives where they're coarse or 
+// unreliable
+class BackupIndex final {
+public:
+	static constexpr std::string_view FILE_NAME = ".backups-index";
+	// 2 = backups made in the same hour are in a consistent order
+	// 3 = the directory's entry count is part of the stamp
+	static constexpr uint32_t VERSION = 3;
+	// Bumped whenever old versions of the mod are found to have left backups 
+	// somewhere they shouldn't be, so the directory gets checked for them 
+	// again. 1 = no backups nested inside other backups
+	static constexpr uint32_t LAYOUT_VERSION = 1;
+
+	// Stamp of an up-to-date index, taken before changing the directory so 
+	// the change can be recorded without hiding other changes made meanwhile
+	using Stamp = std::optional<int64_t>;
+
+	// Returns nothing if the index is missing, unreadable or stale
+	static std::optional<std::vector<BackupEntry>> read(Storage& storage, std::filesystem::path const& dir);
+	// Layout should only be given if the directory has been checked for it
+	static Result<> write(
+		Storage& storage, std::filesystem::path const& dir, std::vector<BackupEntry> const& entries,
+		uint32_t layout = 0
+	);
+	// Whether the index is up to date and the directory has been checked to 
+	// have the current layout
+	static bool hasCurrentLayout(Storage const& storage, std::filesystem::path const& dir);
+
+	static Stamp begin(Storage const& storage, std::filesystem::path const& dir);
+	// These keep an up-to-date index up to date. If the index was stale or 
+	// changed since the stamp was taken it's removed instead, and the next 
+	// listing rebuilds it
+	static void add(Storage& storage, std::filesystem::path const& dir, Stamp const& stamp, BackupEntry const& entry);
+	static void remove(Storage& storage, std::filesystem::path const& dir, Stamp const& stamp, std::filesystem::path const& path);
+	static void update(Storage& storage, std::filesystem::path const& dir, Stamp const& stamp, BackupEntry const& entry);
+};
@@ -1,33 +1,24 @@
 #include "BackupsPopup.hpp"
 #include <Geode/loader/Mod.hpp>
 #include <Geode/utils/file.hpp>
+#include <Geode/binding/GameManager.hpp>
 #include <Geode/binding/SimplePlayer.hpp>
 #include <Geode/binding/ButtonSprite.hpp>
 #include <Geode/utils/ranges.hpp>
 #include <Geode/ui/BasedButtonSprite.hpp>
-
-constexpr size_t BACKUPS_PER_PAGE = 10;
-
-static size_t getFolderSize(std::filesystem::path const& path) {
-    std::error_code ec;
-    size_t size = 0;
-    for (auto file : std::filesystem::recursive_directory_iterator(path, ec)) {
-        if (std::filesystem::is_regular_file(file, ec)) {
-            size += std::filesystem::file_size(file, ec);
-        }
-    }
-    return size;
-}
-
-static void enableButton(CCMenuItemSpriteExtra* btn, bool enabled, bool visualOnly = false) {
-    btn->setEnabled(enabled || visualOnly);
-    if (auto spr = typeinfo_cast<CCRGBAProtocol*>(btn->getNormalImage())) {
-        spr->setCascadeColorEnabled(true);
-        spr->setCascadeOpacityEnabled(true);
-        spr->setColor(enabled ? ccWHITE : ccc3(100, 100, 100));
-        // spr->setOpacity(enabled ? 255 : 200);
-    }
-}
+#include <algorithm>
+#include <cmath>
+
+constexpr size_t MAX_LEVEL_RESULTS = 50;
+constexpr size_t MAX_CLEANUP_PREVIEW = 8;
+constexpr float ROW_HEIGHT = 40;
+constexpr float ROW_GAP = 5;
+// Rows kept above and below the ones in view, so scrolling doesn't show 
+// rows whose info hasn't loaded yet
+constexpr size_t ROW_MARGIN = 2;
+// Backups past those whose info is loaded ahead of time, about a screen's 
+// worth in either direction
+constexpr size_t PREFETCH_ROWS = 8;
 
 static std::string toAgoString(Time const& time) {
     auto const fmtPlural = [](auto count, auto unit) {
@@ -52,37 +43,77 @@ static std::string toAgoString(Time const& time) {
     return fmt::format("{:%b %d %Y}", time);
 }
 
-bool BackupNode::init(BackupsPopup* popup, Ref<Backup> backup, float width) {
+bool BackupNode::init(BackupsPopup* popup, float width) {
     if (!CCNode::init())
         return false;
 
     m_popup = popup;
-    m_backup = backup;
-    this->setContentSize(ccp(width, 40));
+    this->setContentSize(ccp(width, ROW_HEIGHT));
 
-    auto bg = CCScale9Sprite::create("square02b_001.png");
-    bg->setScale(.3f);
-    bg->setContentSize(this->getContentSize() / bg->getScale());
-    bg->setColor(ccBLACK);
-    bg->setOpacity(140);
-    this->addChildAtPosition(bg, Anchor::Center);
+    m_bg = CCScale9Sprite::create("square02b_001.png");
+    m_bg->setScale(.3f);
+    m_bg->setContentSize(this->getContentSize() / m_bg->getScale());
+    m_bg->setColor(ccBLACK);
+    m_bg->setOpacity(140);
+    this->addChildAtPosition(m_bg, Anchor::Center);
 
-    if (backup->isAutoRemove()) {
-        bg->setColor(ccc3(24, 69, 114));
-    }
+    m_userLabel = CCLabelBMFont::create("", "bigFont.fnt");
+    this->addChildAtPosition(m_userLabel, Anchor::Left, ccp(20, -12));
 
-    auto name = CCLabelBMFont::create(backup->getUser().c_str(), "bigFont.fnt");
-    name->limitLabelWidth(35, .3f, .05f);
-    this->addChildAtPosition(name, Anchor::Left, ccp(20, -12));
-
-    auto title = CCLabelBMFont::create(toAgoString(backup->getTime()).c_str(), "goldFont.fnt");
-    title->setScale(.45f);
-    title->setAnchorPoint({ .0f, .4f });
-    this->addChildAtPosition(title, Anchor::Left, ccp(60, 10));
+    m_timeLabel = CCLabelBMFont::create("", "goldFont.fnt");
+    m_timeLabel->setScale(.45f);
+    m_timeLabel->setAnchorPoint({ .0f, .4f });
+    this->addChildAtPosition(m_timeLabel, Anchor::Left, ccp(60, 10));
 
     m_loadingCircle = LoadingSpinner::create(20);
     this->addChildAtPosition(m_loadingCircle, Anchor::Left, ccp(20, 5));
 
+    m_infoNode = CCNode::create();
+    m_infoNode->setContentSize(this->getContentSize());
+    m_infoNode->setVisible(false);
+    this->addChild(m_infoNode);
+
+    m_icon = SimplePlayer::create(1);
+    m_icon->setScale(.65f);
+    m_infoNode->addChildAtPosition(m_icon, Anchor::Left, ccp(20, 5));
+
+    auto agoSpr = CCSprite::createWithSpriteFrameName("GJ_timeIcon_001.png");
+    agoSpr->setScale(.5f);
+    agoSpr->setAnchorPoint({ .0f, .5f });
+    m_infoNode->addChildAtPosition(agoSpr, Anchor::Left, ccp(45, 10));
+
+    auto starSpr = CCSprite::createWithSpriteFrameName("GJ_starsIcon_001.png");
+    starSpr->setScale(.5f);
+    starSpr->setAnchorPoint({ .0f, .5f });
+    m_infoNode->addChildAtPosition(starSpr, Anchor::Left, ccp(45, -10));
+
+    m_starLabel = CCLabelBMFont::create("", "bigFont.fnt");
+    m_starLabel->setScale(.4f);
+    m_starLabel->setAnchorPoint({ .0f, .5f });
+    m_infoNode->addChildAtPosition(m_starLabel, Anchor::Left, ccp(60, -10));
+
+    auto levelSpr = CCSprite::createWithSpriteFrameName("GJ_hammerIcon_001.png");
+    levelSpr->setScale(.5f);
+    levelSpr->setAnchorPoint({ .0f, .5f });
+    m_infoNode->addChildAtPosition(levelSpr, Anchor::Left, ccp(105, -10));
+
+    m_levelLabel = CCLabelBMFont::create("", "bigFont.fnt");
+    m_levelLabel->setScale(.4f);
+    m_levelLabel->setAnchorPoint({ .0f, .5f });
+    m_infoNode->addChildAtPosition(m_levelLabel, Anchor::Left, ccp(120, -10));
+
+    m_levelInfoMenu = CCMenu::create();
+    m_levelInfoMenu->ignoreAnchorPointForPosition(false);
+    m_levelInfoMenu->setContentSize(ccp(25, 25));
+    
+    auto levelInfoSpr = CCSprite::createWithSpriteFrameName("GJ_infoIcon_001.png");
+    levelInfoSpr->setScale(.5f);
+    auto levelInfoBtn = CCMenuItemSpriteExtra::create(
+        levelInfoSpr, this, menu_selector(BackupNode::onLevels)
+    );
+    m_levelInfoMenu->addChildAtPosition(levelInfoBtn, Anchor::Center);
+    m_infoNode->addChild(m_levelInfoMenu);
+
     auto menu = CCMenu::create();
     menu->setContentWidth(100);
     menu->setAnchorPoint({ 1, .5f });
@@ -110,67 +141,75 @@ bool BackupNode::init(BackupsPopup* popup, Ref<Backup> backup, float width) {
     menu->setLayout(RowLayout::create()->setAxisAlignment(AxisAlignment::End)->setAxisReverse(true));
     this->addChildAtPosition(menu, Anchor::Right, ccp(-10, 0));
 
+    this->schedule(schedule_selector(BackupNode::onPollInfo));
+
     return true;
 }
 
-void BackupNode::onLoadInfo(BackupInfo info) {
-    if (m_loadingCircle) {
-        m_loadingCircle->removeFromParent();
-        m_loadingCircle = nullptr;
+Backup* BackupNode::getBackup() const {
+    return m_backup;
+}
+void BackupNode::setBackup(Ref<Backup> backup, InfoPriority priority) {
+    if (m_backup != backup) {
+        m_backup = backup;
+        m_loadedLevelNames.clear();
+        this->updateLabels();
+
+        m_infoNode->setVisible(false);
+        m_loadingCircle->setVisible(true);
+        // Cancels loading the previous backup's info if nobody else wants it
+        m_infoRequest = nullptr;
     }
+    if (!m_infoNode->isVisible()) {
+        m_infoRequest = m_backup->requestInfo(priority);
+    }
+}
 
+void BackupNode::updateLabels() {
+    m_bg->setColor(m_backup->isAutoRemove() ? ccc3(24, 69, 114) : ccBLACK);
+    m_userLabel->setString(m_backup->getUser().c_str());
+    m_userLabel->limitLabelWidth(35, .3f, .05f);
+    m_timeLabel->setString(toAgoString(m_backup->getTime()).c_str());
+}
+
+void BackupNode::onPollInfo(float) {
+    if (m_infoRequest && m_infoRequest->isFinished()) {
+        auto request = std::exchange(m_infoRequest, nullptr);
+        auto info = request->getInfo();
+        if (!info) {
+            // Still shown, just without anything from the save files
+            log::error("Unable to load info for backup {}: {}", m_backup->getPath(), info.unwrapErr());
+            this->onLoadInfo(BackupInfo());
+            return;
+        }
+        this->onLoadInfo(*info);
+    }
+}
+void BackupNode::onLoadInfo(BackupInfo const& info) {
+    m_loadingCircle->setVisible(false);
     m_loadedLevelNames = info.levels;
 
-    auto icon = SimplePlayer::create(info.playerIcon);
-    icon->setColor(GameManager::get()->colorForIdx(info.playerColor1));
-    icon->setSecondColor(GameManager::get()->colorForIdx(info.playerColor2));
+    m_icon->updatePlayerFrame(info.playerIcon, IconType::Cube);
+    m_icon->setColor(GameManager::get()->colorForIdx(info.playerColor1));
+    m_icon->setSecondColor(GameManager::get()->colorForIdx(info.playerColor2));
     if (info.playerGlow) {
-        icon->setGlowOutline(GameManager::get()->colorForIdx(*info.playerGlow));
+        m_icon->setGlowOutline(GameManager::get()->colorForIdx(*info.playerGlow));
+    }
+    else {
+        m_icon->disableGlowOutline();
     }
-    icon->setScale(.65f);
-    this->addChildAtPosition(icon, Anchor::Left, ccp(20, 5));
-
-    auto agoSpr = CCSprite::createWithSpriteFrameName("GJ_timeIcon_001.png");
-    agoSpr->setScale(.5f);
-    agoSpr->setAnchorPoint({ .0f, .5f });
-    this->addChildAtPosition(agoSpr, Anchor::Left, ccp(45, 10));
-
-    auto starSpr = CCSprite::createWithSpriteFrameName("GJ_starsIcon_001.png");
-    starSpr->setScale(.5f);
-    starSpr->setAnchorPoint({ .0f, .5f });
-    this->addChildAtPosition(starSpr, Anchor::Left, ccp(45, -10));
-
-    auto starCount = m_backup->hasGameManager() ? std::to_string(info.starCount) : "N/A";
-    auto starLabel = CCLabelBMFont::create(starCount.c_str(), "bigFont.fnt");
-    starLabel->setScale(.4f);
-    starLabel->setAnchorPoint({ .0f, .5f });
-    this->addChildAtPosition(starLabel, Anchor::Left, ccp(60, -10));
 
-    auto levelSpr = CCSprite::createWithSpriteFrameName("GJ_hammerIcon_001.png");
-    levelSpr->setScale(.5f);
-    levelSpr->setAnchorPoint({ .0f, .5f });
-    this->addChildAtPosition(levelSpr, Anchor::Left, ccp(105, -10));
+    auto starCount = info.hasGameManager ? std::to_string(info.starCount) : "N/A";
+    m_starLabel->setString(starCount.c_str());
 
-    auto levelCount = m_backup->hasLocalLevels() ? std::to_string(m_loadedLevelNames.size()) + " levels" : "N/A";
-    auto levelLabel = CCLabelBMFont::create(levelCount.c_str(), "bigFont.fnt");
-    levelLabel->setScale(.4f);
-    levelLabel->setAnchorPoint({ .0f, .5f });
-    this->addChildAtPosition(levelLabel, Anchor::Left, ccp(120, -10));
+    auto levelCount = info.hasLocalLevels ? std::to_string(info.levelCount) + " levels" : "N/A";
+    m_levelLabel->setString(levelCount.c_str());
+    // Right after the level count, same as Anchor::Left would put it
+    m_levelInfoMenu->setPosition(ccp(
+        120 + m_levelLabel->getScaledContentWidth() + 8, m_infoNode->getContentHeight() / 2 - 10
+    ));
 
-    auto levelInfoMenu = CCMenu::create();
-    levelInfoMenu->ignoreAnchorPointForPosition(false);
-    levelInfoMenu->setContentSize(ccp(25, 25));
-    
-    auto levelInfoSpr = CCSprite::createWithSpriteFrameName("GJ_infoIcon_001.png");
-    levelInfoSpr->setScale(.5f);
-    auto levelInfoBtn = CCMenuItemSpriteExtra::create(
-        levelInfoSpr, this, menu_selector(BackupNode::onLevels)
-    );
-    levelInfoMenu->addChildAtPosition(levelInfoBtn, Anchor::Center);
-    this->addChildAtPosition(
-        levelInfoMenu, Anchor::Left,
-        ccp(120 + levelLabel->getScaledContentWidth() + 8, -10)
-    );
+    m_infoNode->setVisible(true);
 }
 void BackupNode::onInfo(CCObject*) {
     auto content = fmt::format(
@@ -179,20 +218,23 @@ void BackupNode::onInfo(CCObject*) {
         m_backup->getPath().filename().string()
     );
     if (m_backup->isAutoRemove()) {
+        auto plan = Backups::get()->planCleanup();
+        auto removed = std::any_of(plan.removed.begin(), plan.removed.end(), [&](auto const& entry) {
+            return entry.path == m_backup->getPath();
+        });
         createQuickPopup(
             "Backup Info",
-            content + fmt::format(
-                "\n<co>This backup will be automatically cleaned up after {} more "
-                "backups have been made. If you'd like to preserve it, press</c> "
-                "<cg>Preserve</c><co>.</c>",
-                Mod::get()->getSettingValue<int64_t>("auto-backup-cleanup-limit") - 
-                    static_cast<int64_t>(m_backup->getAutoRemoveOrder().value_or(0))
-            ),
+            content + (removed ?
+                "\n<cr>Your auto backup settings no longer keep this backup, so it "
+                "will be removed the next time backups are cleaned up.</c>" :
+                "\n<co>This backup will be automatically cleaned up once your auto "
+                "backup settings no longer keep it.</c>"
+            ) + "<co> If you'd like to preserve it, press</c> <cg>Preserve</c><co>.</c>",
             "OK", "Preserve",
             [this](auto, bool btn2) {
                 if (btn2) {
                     m_backup->preserve();
-				    m_popup->reloadAll();
+                    m_popup->updateBackups();
                 }
             }
         );
@@ -216,27 +258,9 @@ void BackupNode::onLevels(CCObject*) {
     FLAlertLayer::create("Levels in Backup", text, "OK")->show();
 }
 
-void BackupNode::setVisible(bool visible) {
-    CCNode::setVisible(visible);
-    if (m_becameVisible != visible) {
-        m_becameVisible = visible;
-        if (m_becameVisible) {
-            m_infoListener.spawn(
-                m_backup->loadInfo(),
-                [this](BackupInfo info) {
-                    this->onLoadInfo(std::move(info));
-                }
-            );
-        }
-        else {
-            m_infoListener.cancel();
-        }
-    }
-}
-
-BackupNode* BackupNode::create(BackupsPopup* popup, Ref<Backup> backup, float width) {
+BackupNode* BackupNode::create(BackupsPopup* popup, float width) {
     auto ret = new BackupNode();
-    if (ret && ret->init(popup, backup, width)) {
+    if (ret && ret->init(popup, width)) {
         ret->autorelease();
         return ret;
     }
@@ -257,17 +281,24 @@ void BackupNode::onRestore(CCObject*) {
 		"Cancel", "Restore",
 		[self = Ref(this), toggle](auto, bool btn2) {
 			if (btn2) {
-				if (TOGGLED) {
-					auto newRes = Backups::get()->createBackup(false);
-					if (!newRes) {
-						return FLAlertLayer::create("Unable to Backup", newRes.unwrapErr(), "OK")->show();
+				// The node may be showing a different backup by the time the 
+				// new one has been created
+				auto restore = [backup = self->m_backup] {
+					auto res = backup->restoreBackup();
+					if (!res) {
+						return FLAlertLayer::create("Unable to Restore", res.unwrapErr(), "OK")->show();
 					}
+					game::restart(false);
+				};
+				if (TOGGLED) {
+					return self->m_popup->createBackup([restore](Result<> res) {
+						if (!res) {
+							return FLAlertLayer::create("Unable to Backup", res.unwrapErr(), "OK")->show();
+						}
+						restore();
+					});
 				}
-				auto res = self->m_backup->restoreBackup();
-				if (!res) {
-					return FLAlertLayer::create("Unable to Restore", res.unwrapErr(), "OK")->show();
-				}
-				game::restart(false);
+				restore();
 			}
 		}
 	);
@@ -293,11 +324,7 @@ void BackupNode::onDelete(CCObject*) {
 		"Cancel", "Delete",
 		[self = Ref(this)](auto, bool btn2) {
 			if (btn2) {
-				auto res = self->m_backup->deleteBackup();
-				if (!res) {
-					FLAlertLayer::create("Unable to Delete", res.unwrapErr(), "OK")->show();
-				}
-				self->m_popup->reloadAll();
+				self->m_popup->deleteBackups({ self->m_backup });
 			}
 		}
 	);
@@ -311,13 +338,8 @@ bool BackupsPopup::init() {
 
     this->setTitle(fmt::format("Local Backups for {}", GameManager::get()->m_playerName));
 
+    // Rows are placed by hand, since only the ones in view exist
     m_list = ScrollLayer::create({ 310, 180 });
-    m_list->m_contentLayer->setLayout(
-        ColumnLayout::create()
-            ->setAxisReverse(true)
-            ->setAxisAlignment(AxisAlignment::End)
-            ->setAutoGrowAxis(m_list->getContentHeight())
-    );
     m_mainLayer->addChildAtPosition(m_list, Anchor::Center, -m_list->getScaledContentSize() / 2);
 
     auto bottomMenu = CCMenu::create();
@@ -329,6 +351,12 @@ bool BackupsPopup::init() {
     );
     bottomMenu->addChild(importBtn);
 
+    auto cleanupSpr = ButtonSprite::create("Clean Up", "goldFont.fnt", "GJ_button_06.png", .8f);
+    auto cleanupBtn = CCMenuItemSpriteExtra::create(
+        cleanupSpr, this, menu_selector(BackupsPopup::onCleanup)
+    );
+    bottomMenu->addChild(cleanupBtn);
+
     auto createSpr = ButtonSprite::create("New Backup", "goldFont.fnt", "GJ_button_01.png", .8f);
     auto createBtn = CCMenuItemSpriteExtra::create(
         createSpr, this, menu_selector(BackupsPopup::onNew)
@@ -347,27 +375,40 @@ bool BackupsPopup::init() {
     );
     m_buttonMenu->addChildAtPosition(openDirBtn, Anchor::BottomRight);
 
-    auto prevPageSpr = CCSprite::createWithSpriteFrameName("GJ_arrow_03_001.png");
-    m_prevPageBtn = CCMenuItemSpriteExtra::create(
-        prevPageSpr, this, menu_selector(BackupsPopup::onPage)
+    auto searchSpr = CircleButtonSprite::create(
+        CCSprite::createWithSpriteFrameName("gj_findBtn_001.png")
     );
-    m_prevPageBtn->setTag(-1);
-    m_buttonMenu->addChildAtPosition(m_prevPageBtn, Anchor::Left);
-
-    auto nextPageSpr = CCSprite::createWithSpriteFrameName("GJ_arrow_03_001.png");
-    nextPageSpr->setFlipX(true);
-    m_nextPageBtn = CCMenuItemSpriteExtra::create(
-        nextPageSpr, this, menu_selector(BackupsPopup::onPage)
+    searchSpr->setScale(.8f);
+    auto searchBtn = CCMenuItemSpriteExtra::create(
+        searchSpr, this, menu_selector(BackupsPopup::onSearch)
     );
-    m_nextPageBtn->setTag(1);
-    m_buttonMenu->addChildAtPosition(m_nextPageBtn, Anchor::Right);
+    m_buttonMenu->addChildAtPosition(searchBtn, Anchor::BottomLeft);
 
-    m_pageLabel = CCLabelBMFont::create("", "bigFont.fnt");
-    m_pageLabel->setAnchorPoint(ccp(1, 1));
-    m_pageLabel->setScale(.3f);
-    m_mainLayer->addChildAtPosition(m_pageLabel, Anchor::TopRight, ccp(-10, -5));
+    m_statusLabel = CCLabelBMFont::create("", "bigFont.fnt");
+    m_statusLabel->setAnchorPoint(ccp(1, 1));
+    m_statusLabel->setScale(.3f);
+    m_mainLayer->addChildAtPosition(m_statusLabel, Anchor::TopRight, ccp(-10, -5));
+
+    m_busySpinner = LoadingSpinner::create(40);
+    m_busySpinner->setVisible(false);
+    m_busySpinner->setZOrder(10);
+    m_mainLayer->addChildAtPosition(m_busySpinner, Anchor::Center);
 
     this->reloadAll();
+    this->schedule(schedule_selector(BackupsPopup::onPollChanges), .5f);
+    this->schedule(schedule_selector(BackupsPopup::onScroll));
+
+    // The tracked size is shown right away and corrected once the backups 
+    // directory has been measured in the background
+    if (Backups::get()->needsSizeReconcile()) {
+        m_sizeListener.spawn(
+            Backups::get()->measureSizes(),
+            [this](BackupSizes sizes) {
+                Backups::get()->applySizes(sizes);
+                this->updateStatusLabel();
+            }
+        );
+    }
 
     return true;
 }
@@ -376,24 +417,49 @@ void BackupsPopup::onImportPicked(file::PickResult result) {
     if (result.isOk()) {
         auto path = std::move(result).unwrap();
         if (!path) return;
-        auto [imported, failed] = Backups::get()->migrateAllFrom(*path);
-        FLAlertLayer::create(
-            "Imported backups",
-            failed == 0 ?
-                fmt::format("Imported <cy>{}</c> backups", imported) :
-                fmt::format(
-                    "Imported <cy>{}</c> backups (<cr>{}</c> failed to import)",
-                    imported, failed
-                ),
-            "OK"
-        )->show();
-        this->reloadAll();
+        auto import = Backups::get()->startImport(*path, [popup = Ref(this)](ImportSummary summary) {
+            popup->onImportFinished(summary);
+        });
+        if (!import) {
+            FLAlertLayer::create("Error importing backups", "Another import is still running", "OK")->show();
+            return;
+        }
+        m_import = import;
+        m_importFailures.clear();
+        this->updateStatusLabel();
     }
     else {
         FLAlertLayer::create("Error importing backups", result.unwrapErr(), "OK")->show();
     }
 }
 
+void BackupsPopup::collectImportFailures() {
+    if (m_import) {
+        for (auto& failure : m_import->takeFailures()) {
+            m_importFailures.push_back(std::move(failure));
+        }
+    }
+}
+void BackupsPopup::onImportFinished(ImportSummary summary) {
+    this->collectImportFailures();
+    m_import = nullptr;
+
+    auto message = fmt::format("Imported <cy>{}</c> backups", summary.imported);
+    if (summary.failed) {
+        message += fmt::format(" (<cr>{}</c> failed to import)", summary.failed);
+        // Show the first few, the rest are in the logs
+        for (size_t i = 0; i < m_importFailures.size() && i < 3; i += 1) {
+            message += fmt::format(
+                "\n<cr>{}</c>: {}",
+                m_importFailures[i].path.filename().string(), m_importFailures[i].error
+            );
+        }
+    }
+    m_importFailures.clear();
+    FLAlertLayer::create("Imported backups", message, "OK")->show();
+    this->reloadAll();
+}
+
 void BackupsPopup::onImport(CCObject*) {
     createQuickPopup(
         "Import Backups",
@@ -413,22 +479,119 @@ void BackupsPopup::onImport(CCObject*) {
     );
 }
 void BackupsPopup::onNew(CCObject*) {
-    // Create new backup
-    auto res = Backups::get()->createBackup(false);
-    if (res) {
-        FLAlertLayer::create("Backed Up", "Backup has been created.", "OK")->show();
+    this->createBackup([](Result<> res) {
+        if (res) {
+            FLAlertLayer::create("Backed Up", "Backup has been created.", "OK")->show();
+        }
+        else {
+            FLAlertLayer::create("Backup Failed", res.unwrapErr(), "OK")->show();
+        }
+    });
+}
+void BackupsPopup::createBackup(std::function<void(Result<>)> onCreated) {
+    auto started = Backups::get()->createBackup(false, [self = Ref(this), onCreated = std::move(onCreated)](Result<> res) {
+        self->setBusy(false);
+        self->showBackups(true);
+        onCreated(std::move(res));
+    });
+    if (!started) {
+        FLAlertLayer::create("Backup Failed", "A backup is already being created.", "OK")->show();
+        return;
     }
-    else {
-        FLAlertLayer::create("Backup Failed", res.unwrapErr(), "OK")->show();
+    this->setBusy(true);
+}
+void BackupsPopup::deleteBackups(std::vector<Ref<Backup>> backups) {
+    auto started = Backups::get()->deleteBackups(std::move(backups), [self = Ref(this)](Result<> res) {
+        self->setBusy(false);
+        if (!res) {
+            FLAlertLayer::create("Unable to Delete", res.unwrapErr(), "OK")->show();
+        }
+        self->updateBackups();
+    });
+    if (!started) {
+        FLAlertLayer::create("Unable to Delete", "Backups are already being deleted.", "OK")->show();
+        return;
     }
-    this->reloadAll();
+    this->setBusy(true);
+}
+void BackupsPopup::setBusy(bool busy) {
+    // Creating and deleting can overlap, so the spinner stays until both are done
+    m_busyCount = busy ? m_busyCount + 1 : m_busyCount - 1;
+    m_busySpinner->setVisible(m_busyCount > 0);
 }
-void BackupsPopup::onPage(CCObject* sender) {
-    this->gotoPage(m_page + sender->getTag());
+void BackupsPopup::onCleanup(CCObject*) {
+    // Planning only looks at the backups' metadata, so this is a preview of 
+    // exactly what pressing Clean Up removes
+    auto plan = Backups::get()->planCleanup();
+    if (plan.removed.empty()) {
+        FLAlertLayer::create(
+            "Clean Up",
+            "Your auto backup settings keep every automated backup, so there's nothing to clean up.",
+            "OK"
+        )->show();
+        return;
+    }
+    std::string list;
+    for (size_t i = 0; i < plan.removed.size() && i < MAX_CLEANUP_PREVIEW; i += 1) {
+        auto& entry = plan.removed[i];
+        list += fmt::format(
+            "\n{:%Y/%m/%d %H:00} ({:.1f} MB)", entry.meta.time, entry.meta.size.value_or(0) / 1'000'000.f
+        );
+    }
+    if (plan.removed.size() > MAX_CLEANUP_PREVIEW) {
+        list += fmt::format("\n...and {} more", plan.removed.size() - MAX_CLEANUP_PREVIEW);
+    }
+    createQuickPopup(
+        "Clean Up",
+        fmt::format(
+            "<cr>{} automated backups</c> are no longer kept by your auto backup settings. "
+            "Removing them frees about <cy>{:.2f} GB</c>:{}",
+            plan.removed.size(), plan.removedBytes / 1'000'000'000.f, list
+        ),
+        "Cancel", "Clean Up",
+        [self = Ref(this)](auto, bool btn2) {
+            if (!btn2) {
+                return;
+            }
+            auto started = Backups::get()->cleanupAutomated([self](Result<> res) {
+                self->setBusy(false);
+                if (!res) {
+                    FLAlertLayer::create("Unable to Clean Up", res.unwrapErr(), "OK")->show();
+                }
+                self->updateBackups();
+            });
+            if (!started) {
+                FLAlertLayer::create("Unable to Clean Up", "Backups are already being deleted.", "OK")->show();
+                return;
+            }
+            self->setBusy(true);
+        }
+    );
 }
 void BackupsPopup::onDirectory(CCObject*) {
     file::openFolder(Backups::get()->getDirectory());
 }
+void BackupsPopup::onSearch(CCObject*) {
+    LevelSearchPopup::create()->show();
+}
+void BackupsPopup::onPollChanges(float) {
+    // Picks up backups added or removed through the opened folder (and by 
+    // a running import)
+    if (Backups::get()->pollChanges()) {
+        this->updateBackups();
+    }
+    else if (m_import) {
+        this->updateStatusLabel();
+    }
+    this->collectImportFailures();
+}
+void BackupsPopup::onScroll(float) {
+    // Scrolling only moves the content layer, so that's all that needs 
+    // checking every frame
+    if (m_list->m_contentLayer->getPositionY() != m_lastScroll) {
+        this->updateRows();
+    }
+}
 
 BackupsPopup* BackupsPopup::create() {
     auto ret = new BackupsPopup();
@@ -440,65 +603,368 @@ BackupsPopup* BackupsPopup::create() {
     return nullptr;
 }
 
-void BackupsPopup::gotoPage(size_t page) {
-    m_list->m_contentLayer->removeAllChildren();
+void BackupsPopup::showBackups(bool scrollToTop) {
+    auto content = m_list->m_contentLayer;
+    auto viewHeight = m_list->getContentHeight();
+    // How far from the top the list is scrolled, so it can stay there
+    auto scrolled = content->getContentHeight() - viewHeight + content->getPositionY();
 
-    auto backups = Backups::get()->getAllBackups();
-    if (backups.empty()) {
-        m_page = 0;
-        m_lastPage = 0;
-        auto node = CCNode::create();
-        node->setContentSize({ m_list->getContentWidth(), 30 });
+    m_backups = Backups::get()->getAllBackups();
+    auto height = std::max(viewHeight, m_backups.size() * (ROW_HEIGHT + ROW_GAP) - ROW_GAP);
+    content->setContentHeight(height);
+
+    if (m_emptyNode) {
+        m_emptyNode->removeFromParent();
+        m_emptyNode = nullptr;
+    }
+    if (m_backups.empty()) {
+        m_emptyNode = CCNode::create();
+        m_emptyNode->setContentSize({ m_list->getContentWidth(), 30 });
 
         auto bg = CCScale9Sprite::create("square02b_001.png");
         bg->setScale(.3f);
-        bg->setContentSize(node->getContentSize() / bg->getScale());
+        bg->setContentSize(m_emptyNode->getContentSize() / bg->getScale());
         bg->setColor(ccBLACK);
         bg->setOpacity(140);
-        node->addChildAtPosition(bg, Anchor::Center);
+        m_emptyNode->addChildAtPosition(bg, Anchor::Center);
 
         auto info = CCLabelBMFont::create("No Backups Found!", "bigFont.fnt");
         info->setScale(.45f);
-        node->addChildAtPosition(info, Anchor::Center);
+        m_emptyNode->addChildAtPosition(info, Anchor::Center);
 
-        m_list->m_contentLayer->addChild(node);
+        m_emptyNode->setPosition(ccp(0, height - 30));
+        content->addChild(m_emptyNode);
+    }
+
+    // Backups that stay in view may have been preserved since
+    for (auto& row : m_rows) {
+        row->updateLabels();
+    }
+    if (scrollToTop) {
+        m_list->scrollToTop();
     }
     else {
-        m_page = page;
-        m_lastPage = (backups.size() - 1) / BACKUPS_PER_PAGE;
-        if (m_page > m_lastPage) {
-            m_page = m_lastPage;
+        content->setPositionY(std::clamp(viewHeight - height + scrolled, viewHeight - height, 0.f));
+    }
+    this->updateRows();
+    this->updateStatusLabel();
+}
+void BackupsPopup::updateRows() {
+    auto content = m_list->m_contentLayer;
+    m_lastScroll = content->getPositionY();
+
+    // Which rows are in view, measured from the top of the list
+    auto height = content->getContentHeight();
+    auto stride = ROW_HEIGHT + ROW_GAP;
+    auto viewTop = height + m_lastScroll - m_list->getContentHeight();
+    auto viewBottom = height + m_lastScroll;
+    size_t viewFirst = static_cast<size_t>(std::max(0.f, std::floor(viewTop / stride)));
+    size_t viewLast = std::min(m_backups.size(), static_cast<size_t>(std::max(0.f, std::ceil(viewBottom / stride))));
+    size_t first = viewFirst > ROW_MARGIN ? viewFirst - ROW_MARGIN : 0;
+    size_t last = std::min(m_backups.size(), viewLast + ROW_MARGIN);
+    auto getPriority = [&](size_t i) {
+        return i >= viewFirst && i < viewLast ? InfoPriority::Visible : InfoPriority::Prefetch;
+    };
+
+    // Rows that are still in view keep their node, so their info isn't 
+    // loaded again
+    std::unordered_map<Backup*, Ref<BackupNode>> shown;
+    for (auto& row : m_rows) {
+        shown.emplace(row->getBackup(), row);
+    }
+    m_rows.clear();
+    std::vector<size_t> unshown;
+    for (size_t i = first; i < last; i += 1) {
+        auto row = shown.find(m_backups[i]);
+        if (row != shown.end()) {
+            row->second->setBackup(m_backups[i], getPriority(i));
+            row->second->setPosition(ccp(0, height - i * stride - ROW_HEIGHT));
+            m_rows.push_back(row->second);
+            shown.erase(row);
         }
+        else {
+            unshown.push_back(i);
+        }
+    }
+    for (auto& [_, row] : shown) {
+        row->removeFromParent();
+        m_pool.push_back(row);
+    }
+    for (auto i : unshown) {
+        Ref<BackupNode> row;
+        if (m_pool.empty()) {
+            row = BackupNode::create(this, m_list->getContentWidth());
+        }
+        else {
+            row = m_pool.back();
+            m_pool.pop_back();
+        }
+        row->setBackup(m_backups[i], getPriority(i));
+        row->setPosition(ccp(0, height - i * stride - ROW_HEIGHT));
+        content->addChild(row);
+        m_rows.push_back(row);
+    }
 
-        for (
-            size_t i = m_page * BACKUPS_PER_PAGE;
-            i < (m_page + 1) * BACKUPS_PER_PAGE && i < backups.size();
-            i += 1
-        ) {
-            auto backup = backups.at(i);
-            auto node = BackupNode::create(this, backup, m_list->getContentWidth());
-            m_list->m_contentLayer->addChild(node);
+    // Replaced only after the rows have asked for theirs, so rows scrolled 
+    // onto prefetched backups share the same requests. Ones no longer close 
+    // to the view are cancelled
+    std::vector<std::shared_ptr<InfoRequest>> prefetched;
+    auto prefetchLast = std::min(m_backups.size(), last + PREFETCH_ROWS);
+    for (size_t i = first > PREFETCH_ROWS ? first - PREFETCH_ROWS : 0; i < prefetchLast; i += 1) {
+        if (i < first || i >= last) {
+            prefetched.push_back(m_backups[i]->requestInfo(InfoPriority::Prefetch));
+        }
+    }
+    m_prefetched = std::move(prefetched);
+}
+void BackupsPopup::updateStatusLabel() {
+    auto text = fmt::format(
+        "{} backups, {:.1f} GB",
+        Backups::get()->getAllBackups().size(), Backups::get()->getTotalSize() / 1'000'000'000.f
+    );
+    if (m_import) {
+        text += fmt::format(
+            " - Importing {}/{}", m_import->getImported() + m_import->getFailed(), m_import->getFound()
+        );
+        if (m_import->getFailed()) {
+            text += fmt::format(" ({} failed)", m_import->getFailed());
         }
     }
+    m_statusLabel->setString(text.c_str());
+}
+void BackupsPopup::reloadAll() {
+    Backups::get()->invalidateCache();
+    this->showBackups(true);
+}
+void BackupsPopup::updateBackups() {
+    this->showBackups(false);
+}
 
-    m_list->m_contentLayer->updateLayout();
-    m_list->scrollToTop();
+bool LevelSearchPopup::init() {
+    if (!Popup::init(350, 260, "GJ_square05.png"))
+        return false;
+
+    m_noElasticity = true;
+
+    this->setTitle("Find Levels in Backups");
+
+    m_input = TextInput::create(250, "Level name, ID or #hash");
+    m_input->setCallback([this](std::string const&) {
+        this->updateResults();
+    });
+    m_mainLayer->addChildAtPosition(m_input, Anchor::Top, ccp(0, -45));
+
+    m_list = ScrollLayer::create({ 310, 150 });
+    m_list->m_contentLayer->setLayout(
+        ColumnLayout::create()
+            ->setAxisReverse(true)
+            ->setAxisAlignment(AxisAlignment::End)
+            ->setAutoGrowAxis(m_list->getContentHeight())
+    );
+    m_mainLayer->addChildAtPosition(m_list, Anchor::Center, -m_list->getScaledContentSize() / 2 - ccp(0, 20));
 
-    if (m_backupsDirSizeCache == 0) {
-        m_backupsDirSizeCache = getFolderSize(Backups::get()->getDirectory());
+    m_statusLabel = CCLabelBMFont::create("", "bigFont.fnt");
+    m_statusLabel->setScale(.3f);
+    m_mainLayer->addChildAtPosition(m_statusLabel, Anchor::Bottom, ccp(0, 15));
+
+    m_loadListener.spawn(
+        Backups::get()->loadLevelIndex(),
+        [this](LevelIndex index) {
+            this->onIndexLoaded(std::move(index));
+        }
+    );
+    this->updateStatusLabel();
+
+    return true;
+}
+LevelSearchPopup::~LevelSearchPopup() {
+    // Whatever got indexed so far is kept for next time
+    m_syncCancelled->store(true);
+}
+
+void LevelSearchPopup::onIndexLoaded(LevelIndex index) {
+    m_index = std::move(index);
+    for (auto& backup : Backups::get()->getAllBackups()) {
+        if (!m_index->has(backup->getPath())) {
+            m_indexing += 1;
+        }
+    }
+    // Whatever's already indexed can be searched while the rest is indexed
+    if (m_indexing) {
+        m_syncListener.spawn(
+            Backups::get()->syncLevelIndex(m_syncCancelled),
+            [this](LevelIndex index) {
+                this->onIndexSynced(std::move(index));
+            }
+        );
     }
+    this->updateResults();
+}
+void LevelSearchPopup::onIndexSynced(LevelIndex index) {
+    m_index = std::move(index);
+    m_indexing = 0;
+    this->updateResults();
+}
 
-    m_pageLabel->setString(fmt::format(
-        "Page {}/{} ({} backups, {:.1f} GB)",
-        m_page + 1, m_lastPage + 1, backups.size(),
-        m_backupsDirSizeCache / 1'000'000'000.f
-    ).c_str());
+void LevelSearchPopup::onResult(CCObject* sender) {
+    auto& result = m_results.at(sender->getTag());
 
-    enableButton(m_prevPageBtn, m_page > 0);
-    enableButton(m_nextPageBtn, m_page < m_lastPage);
+    std::vector<Ref<Backup>> backups;
+    for (auto& backup : Backups::get()->getAllBackups()) {
+        auto folder = backup->getPath().filename().string();
+        if (std::find(result.backups.begin(), result.backups.end(), folder) != result.backups.end()) {
+            backups.push_back(backup);
+        }
+    }
+
+    auto text = fmt::format("Version <cy>{}</c> is in <cy>{}</c> backups:", result.level.version, backups.size());
+    // Backups are sorted newest first
+    for (size_t i = 0; i < backups.size(); i += 1) {
+        if (i >= 6) {
+            text += fmt::format("\n<cj>...and {} more</c>", backups.size() - i);
+            break;
+        }
+        text += fmt::format(
+            "\n<cg>{}</c> ({})",
+            toAgoString(backups[i]->getTime()), backups[i]->getPath().filename().string()
+        );
+    }
+    text += fmt::format("\nSearch for <co>#{:016x}</c> to find copies of it with other names", result.level.hash);
+    if (backups.empty()) {
+        FLAlertLayer::create(result.level.name.c_str(), text, "OK")->show();
+        return;
+    }
+    text += "\nPress <cg>Restore</c> to add this version back to your created levels.";
+    createQuickPopup(
+        result.level.name.c_str(), text, "OK", "Restore",
+        [self = Ref(this), backup = backups.front(), hash = result.level.hash, name = result.level.name](auto, bool btn2) {
+            if (btn2) {
+                self->onRestore(backup, hash, name);
+            }
+        }
+    );
 }
-void BackupsPopup::reloadAll() {
-    Backups::get()->invalidateCache();
-    m_backupsDirSizeCache = 0;
-    this->gotoPage(0);
+void LevelSearchPopup::onRestore(Ref<Backup> backup, uint64_t hash, std::string name) {
+    m_restoreListener.spawn(
+        backup->extractLevels({ hash }),
+        [name](Result<std::vector<std::string>> levels) {
+            if (!levels) {
+                return FLAlertLayer::create("Unable to Restore", levels.unwrapErr(), "OK")->show();
+            }
+            // Only one level was asked for, but the same level can be in a save twice
+            auto extracted = std::move(levels).unwrap();
+            extracted.resize(1);
+            auto res = Backups::get()->addLocalLevels(extracted);
+            if (!res) {
+                return FLAlertLayer::create("Unable to Restore", res.unwrapErr(), "OK")->show();
+            }
+            FLAlertLayer::create(
+                "Level Restored",
+                fmt::format("<cy>{}</c> has been added to your created levels.", name),
+                "OK"
+            )->show();
+        }
+    );
+}
+
+void LevelSearchPopup::updateResults() {
+    m_list->m_contentLayer->removeAllChildren();
+    m_results.clear();
+
+    std::unordered_map<std::string, Ref<Backup>> backups;
+    for (auto& backup : Backups::get()->getAllBackups()) {
+        backups.emplace(backup->getPath().filename().string(), backup);
+    }
+    if (m_index) {
+        for (auto entry : m_index->search(m_input->getString())) {
+            // Backups removed since the index was loaded don't count
+            auto result = *entry;
+            std::erase_if(result.backups, [&](std::string const& folder) {
+                return !backups.contains(folder);
+            });
+            if (!result.backups.empty()) {
+                m_results.push_back(std::move(result));
+            }
+        }
+    }
+
+    for (size_t i = 0; i < m_results.size() && i < MAX_LEVEL_RESULTS; i += 1) {
+        auto& result = m_results.at(i);
+
+        auto node = CCNode::create();
+        node->setContentSize({ m_list->getContentWidth(), 30 });
+
+        auto bg = CCScale9Sprite::create("square02b_001.png");
+        bg->setScale(.3f);
+        bg->setContentSize(node->getContentSize() / bg->getScale());
+        bg->setColor(ccBLACK);
+        bg->setOpacity(140);
+        node->addChildAtPosition(bg, Anchor::Center);
+
+        auto name = CCLabelBMFont::create(result.level.name.c_str(), "bigFont.fnt");
+        name->limitLabelWidth(200, .4f, .1f);
+        name->setAnchorPoint({ .0f, .5f });
+        node->addChildAtPosition(name, Anchor::Left, ccp(10, 5));
+
+        auto newest = Time();
+        for (auto& folder : result.backups) {
+            newest = std::max(newest, backups.at(folder)->getTime());
+        }
+        auto details = fmt::format("Version {} in {} backups, newest {}", result.level.version, result.backups.size(), toAgoString(newest));
+        if (result.level.id) {
+            details = fmt::format("ID {} - {}", result.level.id, details);
+        }
+        auto detailsLabel = CCLabelBMFont::create(details.c_str(), "goldFont.fnt");
+        detailsLabel->limitLabelWidth(250, .35f, .1f);
+        detailsLabel->setAnchorPoint({ .0f, .5f });
+        node->addChildAtPosition(detailsLabel, Anchor::Left, ccp(10, -7));
+
+        auto menu = CCMenu::create();
+        menu->ignoreAnchorPointForPosition(false);
+        menu->setContentSize(ccp(25, 25));
+        auto infoSpr = CCSprite::createWithSpriteFrameName("GJ_infoIcon_001.png");
+        infoSpr->setScale(.6f);
+        auto infoBtn = CCMenuItemSpriteExtra::create(
+            infoSpr, this, menu_selector(LevelSearchPopup::onResult)
+        );
+        infoBtn->setTag(static_cast<int>(i));
+        menu->addChildAtPosition(infoBtn, Anchor::Center);
+        node->addChildAtPosition(menu, Anchor::Right, ccp(-20, 0));
+
+        m_list->m_contentLayer->addChild(node);
+    }
+
+    m_list->m_contentLayer->updateLayout();
+    m_list->scrollToTop();
+
+    this->updateStatusLabel();
+}
+void LevelSearchPopup::updateStatusLabel() {
+    std::string text;
+    if (!m_index) {
+        text = "Loading level index...";
+    }
+    else if (m_indexing) {
+        text = fmt::format("Indexing levels in {} backups...", m_indexing);
+    }
+    else if (m_input->getString().empty()) {
+        text = fmt::format("Levels in {} backups indexed", m_index->getBackupCount());
+    }
+    else if (m_results.size() > MAX_LEVEL_RESULTS) {
+        text = fmt::format("Showing {} of {} results", MAX_LEVEL_RESULTS, m_results.size());
+    }
+    else {
+        text = fmt::format("{} results", m_results.size());
+    }
+    m_statusLabel->setString(text.c_str());
+}
+
+LevelSearchPopup* LevelSearchPopup::create() {
+    auto ret = new LevelSearchPopup();
+    if (ret && ret->init()) {
+        ret->autorelease();
+        return ret;
+    }
+    CC_SAFE_DELETE(ret);
+    return nullptr;
 }
@@ -3,6 +3,7 @@
 #include <Geode/ui/Popup.hpp>
 #include <Geode/ui/LoadingSpinner.hpp>
 #include <Geode/ui/ScrollLayer.hpp>
+#include <Geode/ui/TextInput.hpp>
 #include <Geode/utils/file.hpp>
 #include "Backup.hpp"
 
@@ -10,18 +11,29 @@ using namespace geode::prelude;
 
 class BackupsPopup;
 
+// Nodes are reused for different backups as the list is scrolled, so 
+// everything in them is created once and only updated afterwards
 class BackupNode : public CCNode {
 protected:
 	BackupsPopup* m_popup;
 	Ref<Backup> m_backup;
+	CCScale9Sprite* m_bg;
+	CCLabelBMFont* m_userLabel;
+	CCLabelBMFont* m_timeLabel;
 	LoadingSpinner* m_loadingCircle;
-	async::TaskHolder<BackupInfo> m_infoListener;
+	// Everything that's only shown once the backup's info has loaded
+	CCNode* m_infoNode;
+	SimplePlayer* m_icon;
+	CCLabelBMFont* m_starLabel;
+	CCLabelBMFont* m_levelLabel;
+	CCMenu* m_levelInfoMenu;
+	std::shared_ptr<InfoRequest> m_infoRequest;
     std::vector<std::string> m_loadedLevelNames;
-	bool m_becameVisible = false;
 
-	bool init(BackupsPopup* popup, Ref<Backup> backup, float width);
+	bool init(BackupsPopup* popup, float width);
 
-	void onLoadInfo(BackupInfo event);
+	void onPollInfo(float);
+	void onLoadInfo(BackupInfo const& info);
     void onInfo(CCObject*);
     void onLevels(CCObject*);
 
@@ -29,35 +41,99 @@ protected:
 	void onDelete(CCObject*);
 
 public:
-	static BackupNode* create(BackupsPopup* popup, Ref<Backup> backup, float width);
-
-	void setVisible(bool visible) override;
+	static BackupNode* create(BackupsPopup* popup, float width);
+
+	Backup* getBackup() const;
+	// Show a different backup, loading its info. Setting the same backup 
+	// again with a higher priority moves its info up the queue
+	void setBackup(Ref<Backup> backup, InfoPriority priority);
+	// For when the backup has changed, e.g. by being preserved
+	void updateLabels();
 };
 
 class BackupsPopup : public Popup {
 protected:
 	ScrollLayer* m_list;
-	size_t m_page = 0;
-	size_t m_lastPage = 0;
+	// Every backup, though only the ones scrolled into view have a node
+	std::vector<Ref<Backup>> m_backups;
+	std::vector<Ref<BackupNode>> m_rows;
+	// Nodes scrolled out of view, waiting to be reused
+	std::vector<Ref<BackupNode>> m_pool;
+	// Info for backups a bit past the rows, so it's ready once they're 
+	// scrolled to
+	std::vector<std::shared_ptr<InfoRequest>> m_prefetched;
+	CCNode* m_emptyNode = nullptr;
+	float m_lastScroll = 0;
 	async::TaskHolder<file::PickResult> m_importPick;
-	CCLabelBMFont* m_pageLabel;
-	CCMenuItemSpriteExtra* m_prevPageBtn;
-	CCMenuItemSpriteExtra* m_nextPageBtn;
-	size_t m_backupsDirSizeCache = 0;
+	CCLabelBMFont* m_statusLabel;
+	// Shown while backups are being created or deleted in the background
+	LoadingSpinner* m_busySpinner;
+	size_t m_busyCount = 0;
+	async::TaskHolder<BackupSizes> m_sizeListener;
+	std::shared_ptr<ImportProgress> m_import;
+	std::vector<ImportFailure> m_importFailures;
 
 	bool init();
 
 	void onImportPicked(file::PickResult result);
+	void onImportFinished(ImportSummary summary);
+	void collectImportFailures();
 
 	void onImport(CCObject*);
 	void onNew(CCObject*);
-	void onPage(CCObject* sender);
+	void onCleanup(CCObject*);
+	void onSearch(CCObject*);
 	void onDirectory(CCObject*);
+	void onPollChanges(float);
+	void onScroll(float);
+
+	// Give a node to every backup in view, taking them from the ones that 
+	// scrolled out of view
+	void updateRows();
+	void showBackups(bool scrollToTop);
+	void setBusy(bool busy);
 
 public:
 	static BackupsPopup* create();
 
-	void gotoPage(size_t page);
+	void updateStatusLabel();
+	// Creates a backup in the background, showing a spinner until it's done
+	void createBackup(std::function<void(Result<>)> onCreated);
+	// Deletes backups in the background, with the same spinner
+	void deleteBackups(std::vector<Ref<Backup>> backups);
 	void reloadAll();
+	// Refresh the list from the cached backups without reloading them, 
+	// staying where it's scrolled to
+	void updateBackups();
+};
+
+// Finds which backups have a level through the level index, so nothing has 
+// to be decompressed unless some backups haven't been indexed yet
+class LevelSearchPopup : public Popup {
+protected:
+	TextInput* m_input;
+	ScrollLayer* m_list;
+	CCLabelBMFont* m_statusLabel;
+	std::optional<LevelIndex> m_index;
+	std::vector<LevelIndex::Entry> m_results;
+	async::TaskHolder<LevelIndex> m_loadListener;
+	async::TaskHolder<LevelIndex> m_syncListener;
+	std::shared_ptr<std::atomic_bool> m_syncCancelled = std::make_shared<std::atomic_bool>(false);
+	size_t m_indexing = 0;
+	async::TaskHolder<Result<std::vector<std::string>>> m_restoreListener;
+
+	bool init();
+	~LevelSearchPopup() override;
+
+	void onIndexLoaded(LevelIndex index);
+	void onIndexSynced(LevelIndex index);
+	void onResult(CCObject* sender);
+	void onRestore(Ref<Backup> backup, uint64_t hash, std::string name);
+
+	void updateResults();
+	void updateStatusLabel();
+
+public:
+	static LevelSearchPopup* create();
 };
 
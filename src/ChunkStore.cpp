@@ -0,0 +1,269 @@
+#include "ChunkStore.hpp"
+#include "Hash.hpp"
+#include "ParseCC.hpp"
+#include <array>
+#include <sstream>
+#include <unordered_set>
+
+// Chunk sizes are tuned for save files that range from a few hundred KB to a
+// few hundred MB; 64 KB on average keeps manifests small while still making a
+// single edited level only cost a couple of chunks
+static constexpr size_t MIN_CHUNK_SIZE = 16 * 1024;
+static constexpr size_t AVG_CHUNK_SIZE = 64 * 1024;
+static constexpr size_t MAX_CHUNK_SIZE = 256 * 1024;
+
+// FastCDC-style normalized chunking: a harder mask before the average size
+// and an easier one after it keeps chunk sizes close to the average. The gear
+// hash shifts left, so the high bits depend on the most bytes
+static constexpr uint64_t MASK_HARD = ~0ull << (64 - 18);
+static constexpr uint64_t MASK_EASY = ~0ull << (64 - 14);
+
+static constexpr std::string_view MANIFEST_HEADER = "backups-chunks 1";
+
+static constexpr auto GEAR = [] {
+    std::array<uint64_t, 256> table {};
+    // splitmix64 so the table is fixed across builds and platforms
+    uint64_t state = 0x6A09E667F3BCC908ull;
+    for (auto& value : table) {
+        state += 0x9E3779B97F4A7C15ull;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        value = z ^ (z >> 31);
+    }
+    return table;
+}();
+
+static size_t findChunkEnd(uint8_t const* data, size_t size) {
+    if (size <= MIN_CHUNK_SIZE) {
+        return size;
+    }
+    auto const normal = std::min(size, AVG_CHUNK_SIZE);
+    auto const end = std::min(size, MAX_CHUNK_SIZE);
+    uint64_t hash = 0;
+    size_t i = MIN_CHUNK_SIZE;
+    for (; i < normal; i += 1) {
+        hash = (hash << 1) + GEAR[data[i]];
+        if (!(hash & MASK_HARD)) {
+            return i + 1;
+        }
+    }
+    for (; i < end; i += 1) {
+        hash = (hash << 1) + GEAR[data[i]];
+        if (!(hash & MASK_EASY)) {
+            return i + 1;
+        }
+    }
+    return end;
+}
+
+ChunkStore::ChunkStore(Storage& storage, std::filesystem::path const& backupsDir)
+  : m_storage(storage), m_dir(backupsDir / DIR_NAME) {}
+
+std::filesystem::path ChunkStore::getDirectory() const {
+    return m_dir;
+}
+std::filesystem::path ChunkStore::getChunkPath(std::string const& id) const {
+    // Fan out by the first byte so no single directory gets huge
+    return m_dir / id.substr(0, 2) / id;
+}
+
+Result<ChunkWriteStats> ChunkStore::write(std::string_view data, std::filesystem::path const& manifest) {
+    auto stats = ChunkWriteStats();
+    std::unordered_set<std::string> seen;
+    std::string manifestData = std::string(MANIFEST_HEADER) + "\n";
+
+    auto bytes = reinterpret_cast<uint8_t const*>(data.data());
+    size_t offset = 0;
+    while (offset < data.size()) {
+        auto len = findChunkEnd(bytes + offset, data.size() - offset);
+        auto chunk = data.substr(offset, len);
+        offset += len;
+
+        auto id = xxh::contentID(chunk);
+        manifestData += fmt::format("{} {}\n", id, len);
+        stats.chunkCount += 1;
+
+        if (!seen.insert(id).second) {
+            continue;
+        }
+        auto path = this->getChunkPath(id);
+        if (m_storage.exists(path)) {
+            continue;
+        }
+
+        // Chunks are stored with the same zlib + base64 encoding the game
+        // uses for its own save files
+        std::string encoded = cc::compressString(chunk, 0);
+        GEODE_UNWRAP(m_storage.createDirectories(path.parent_path()));
+
+        // Storage writes are all-or-nothing, so a crash can never leave a 
+        // truncated chunk that later backups would happily reuse
+        auto res = m_storage.write(path, encoded);
+        if (!res) {
+            return Err("Unable to store chunk: {}", res.unwrapErr());
+        }
+        stats.newChunkCount += 1;
+        stats.newChunkBytes += encoded.size();
+        stats.bytesWritten += encoded.size();
+    }
+
+    GEODE_UNWRAP(m_storage.write(manifest, manifestData));
+    stats.bytesWritten += manifestData.size();
+    return Ok(stats);
+}
+
+Result<std::string> ChunkStore::read(std::filesystem::path const& manifest) const {
+    GEODE_UNWRAP_INTO(auto chunks, this->readManifest(manifest));
+
+    size_t total = 0;
+    for (auto& chunk : chunks) {
+        total += chunk.size;
+    }
+    std::string data;
+    data.reserve(total);
+
+    for (auto& chunk : chunks) {
+        auto encoded = m_storage.read(this->getChunkPath(chunk.id));
+        if (!encoded) {
+            return Err("Missing chunk {}: {}", chunk.id, encoded.unwrapErr());
+        }
+        std::string decoded = cc::decompressString(*encoded, 0);
+        // Chunks are named after their contents, so anything that got 
+        // damaged on disk is caught here instead of ending up in a restore
+        if (decoded.size() != chunk.size || xxh::contentID(decoded) != chunk.id) {
+            return Err("Chunk {} is corrupted", chunk.id);
+        }
+        data += decoded;
+    }
+    return Ok(std::move(data));
+}
+
+Result<std::vector<ChunkRef>> ChunkStore::readManifest(std::filesystem::path const& manifest) const {
+    GEODE_UNWRAP_INTO(auto text, m_storage.read(manifest));
+
+    std::istringstream stream(text);
+    std::string line;
+    if (!std::getline(stream, line) || line != MANIFEST_HEADER) {
+        return Err("Unsupported chunk manifest {}", manifest.filename());
+    }
+    std::vector<ChunkRef> chunks;
+    while (std::getline(stream, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        auto space = line.find(' ');
+        if (space == std::string::npos) {
+            return Err("Malformed chunk manifest {}", manifest.filename());
+        }
+        auto ref = ChunkRef();
+        ref.id = line.substr(0, space);
+        ref.size = std::strtoull(line.c_str() + space + 1, nullptr, 10);
+        chunks.push_back(std::move(ref));
+    }
+    return Ok(std::move(chunks));
+}
+
+// Chunks are always exactly one folder deep
+Result<std::vector<std::filesystem::path>> ChunkStore::listChunks() const {
+    std::vector<std::filesystem::path> chunks;
+    if (!m_storage.exists(m_dir)) {
+        return Ok(chunks);
+    }
+    GEODE_UNWRAP_INTO(auto folders, m_storage.list(m_dir));
+    for (auto& folder : folders) {
+        if (!m_storage.isDirectory(folder)) {
+            continue;
+        }
+        GEODE_UNWRAP_INTO(auto files, m_storage.list(folder));
+        chunks.insert(chunks.end(), files.begin(), files.end());
+    }
+    return Ok(std::move(chunks));
+}
+
+Result<> ChunkStore::importFrom(ChunkStore const& other) {
+    if (m_dir.lexically_normal() == other.m_dir.lexically_normal()) {
+        return Ok();
+    }
+    // Moving the whole store is a single rename if we don't have one yet
+    if (!m_storage.exists(m_dir)) {
+        (void)m_storage.createDirectories(m_dir.parent_path());
+        if (!m_storage.rename(other.m_dir, m_dir)) {
+            return Ok();
+        }
+    }
+    auto chunks = other.listChunks();
+    if (!chunks) {
+        return Err("Unable to read chunks: {}", chunks.unwrapErr());
+    }
+    for (auto& chunk : *chunks) {
+        auto id = chunk.filename().string();
+        auto target = this->getChunkPath(id);
+        // Chunks are named after their contents, so one that already exists 
+        // is the same chunk
+        if (!m_storage.exists(target)) {
+            GEODE_UNWRAP(m_storage.createDirectories(target.parent_path()));
+            // Rename fails across drives
+            if (!m_storage.rename(chunk, target)) {
+                continue;
+            }
+            auto res = m_storage.copy(chunk, target);
+            if (!res) {
+                return Err("Unable to import chunk {}: {}", id, res.unwrapErr());
+            }
+            auto original = m_storage.read(chunk);
+            auto copied = m_storage.read(target);
+            if (!original || !copied || *original != *copied) {
+                (void)m_storage.remove(target);
+                return Err("Chunk {} wasn't copied correctly", id);
+            }
+        }
+        auto res = m_storage.remove(chunk);
+        if (!res) {
+            return Err("Unable to remove imported chunk {}: {}", id, res.unwrapErr());
+        }
+    }
+    return m_storage.remove(other.m_dir);
+}
+
+Result<> ChunkStore::copyFrom(ChunkStore const& other, std::vector<std::filesystem::path> const& manifests) {
+    for (auto& manifest : manifests) {
+        GEODE_UNWRAP_INTO(auto chunks, other.readManifest(manifest));
+        for (auto& chunk : chunks) {
+            auto target = this->getChunkPath(chunk.id);
+            if (m_storage.exists(target)) {
+                continue;
+            }
+            GEODE_UNWRAP(m_storage.createDirectories(target.parent_path()));
+            auto res = m_storage.copy(other.getChunkPath(chunk.id), target);
+            if (!res) {
+                return Err("Unable to copy chunk {}: {}", chunk.id, res.unwrapErr());
+            }
+        }
+    }
+    return Ok();
+}
+
+Result<size_t> ChunkStore::collectGarbage(std::vector<std::filesystem::path> const& manifests) {
+    std::unordered_set<std::string> referenced;
+    for (auto& manifest : manifests) {
+        // If a manifest can't be read, deleting anything could lose data
+        GEODE_UNWRAP_INTO(auto chunks, this->readManifest(manifest));
+        for (auto& chunk : chunks) {
+            referenced.insert(std::move(chunk.id));
+        }
+    }
+
+    GEODE_UNWRAP_INTO(auto chunks, this->listChunks());
+    size_t freed = 0;
+    for (auto& path : chunks) {
+        if (referenced.contains(path.filename().string())) {
+            continue;
+        }
+        auto size = m_storage.size(path);
+        if (m_storage.remove(path)) {
+            freed += size;
+        }
+    }
+    return Ok(freed);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Platform.hpp"
+#include "Storage.hpp"
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+using namespace geode::prelude;
+
+struct ChunkRef final {
+	std::string id;
+	size_t size = 0;
+};
+
+struct ChunkWriteStats final {
+	size_t chunkCount = 0;
+	size_t newChunkCount = 0;
+	size_t newChunkBytes = 0;
+	size_t bytesWritten = 0;
+};
+
+// Content-addressed store for deduplicated backups. Decompressed save data is
+// split at content-defined boundaries, so an edit only changes the chunks
+// around it, and every unique chunk is stored once and shared by all backups
+// in the same directory. Each backup then only keeps a small manifest listing
+// its chunks
+class ChunkStore final {
+private:
+	Storage& m_storage;
+	std::filesystem::path m_dir;
+
+	std::filesystem::path getChunkPath(std::string const& id) const;
+	Result<std::vector<std::filesystem::path>> listChunks() const;
+
+public:
+	static constexpr std::string_view DIR_NAME = ".chunks";
+	static constexpr std::string_view MANIFEST_EXT = ".chunks";
+
+	ChunkStore(Storage& storage, std::filesystem::path const& backupsDir);
+
+	std::filesystem::path getDirectory() const;
+
+	Result<ChunkWriteStats> write(std::string_view data, std::filesystem::path const& manifest);
+	Result<std::string> read(std::filesystem::path const& manifest) const;
+
+	Result<std::vector<ChunkRef>> readManifest(std::filesystem::path const& manifest) const;
+	// Move over every chunk this store doesn't have yet, leaving the other 
+	// store empty. Chunks copied across drives are checked before the 
+	// original is removed. Both stores have to be in the same storage
+	Result<> importFrom(ChunkStore const& other);
+	// Copy over the chunks the given manifests from the other store need, 
+	// leaving the other store as it is for the backups still using it
+	Result<> copyFrom(ChunkStore const& other, std::vector<std::filesystem::path> const& manifests);
+	// Remove every chunk not referenced by any of the given manifests, 
+	// returning the amount of bytes freed
+	Result<size_t> collectGarbage(std::vector<std::filesystem::path> const& manifests);
+};
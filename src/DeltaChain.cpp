@@ -0,0 +1,395 @@
+#include "DeltaChain.hpp"
+#include "BackupCore.hpp"
+#include "Hash.hpp"
+#include "ParseCC.hpp"
+#include <charconv>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+
+// Matches shorter than this aren't worth a copy instruction
+static constexpr size_t WINDOW_SIZE = 32;
+static constexpr uint64_t HASH_MULTIPLIER = 0x100000001b3ull;
+static constexpr std::string_view DELTA_MAGIC = "BKD1";
+
+enum class DeltaOp : uint8_t {
+    Add = 0,
+    Copy = 1,
+};
+
+static void writeVarInt(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+static std::optional<uint64_t> readVarInt(std::string_view data, size_t& pos) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64 && pos < data.size(); shift += 7) {
+        auto byte = static_cast<uint8_t>(data[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    return std::nullopt;
+}
+
+static uint64_t hashWindow(std::string_view data, size_t pos) {
+    uint64_t hash = 0;
+    for (size_t i = 0; i < WINDOW_SIZE; i += 1) {
+        hash = hash * HASH_MULTIPLIER + static_cast<uint8_t>(data[pos + i]);
+    }
+    return hash;
+}
+
+std::string delta::encode(std::string_view base, std::string_view target) {
+    // Removing the byte leaving the window needs its weight, which is the 
+    // multiplier to the power of the window size minus one
+    uint64_t outWeight = 1;
+    for (size_t i = 1; i < WINDOW_SIZE; i += 1) {
+        outWeight *= HASH_MULTIPLIER;
+    }
+
+    // Index non-overlapping blocks of the base; the target is then checked 
+    // at every position with a rolling hash like rsync does
+    std::unordered_map<uint64_t, uint32_t> blocks;
+    blocks.reserve(base.size() / WINDOW_SIZE + 1);
+    for (size_t p = 0; p + WINDOW_SIZE <= base.size(); p += WINDOW_SIZE) {
+        blocks.emplace(hashWindow(base, p), static_cast<uint32_t>(p));
+    }
+
+    std::string out;
+    out += DELTA_MAGIC;
+    writeVarInt(out, base.size());
+    writeVarInt(out, target.size());
+
+    auto emitAdd = [&](size_t from, size_t to) {
+        if (to > from) {
+            out.push_back(static_cast<char>(DeltaOp::Add));
+            writeVarInt(out, to - from);
+            out.append(target.substr(from, to - from));
+        }
+    };
+    auto emitCopy = [&](size_t offset, size_t size) {
+        out.push_back(static_cast<char>(DeltaOp::Copy));
+        writeVarInt(out, offset);
+        writeVarInt(out, size);
+    };
+
+    size_t i = 0;
+    size_t literal = 0;
+    uint64_t hash = target.size() >= WINDOW_SIZE ? hashWindow(target, 0) : 0;
+    while (i + WINDOW_SIZE <= target.size()) {
+        auto block = blocks.find(hash);
+        if (block != blocks.end() && std::memcmp(base.data() + block->second, target.data() + i, WINDOW_SIZE) == 0) {
+            // Matches usually continue past the block in both directions
+            size_t start = i;
+            size_t baseStart = block->second;
+            while (start > literal && baseStart > 0 && base[baseStart - 1] == target[start - 1]) {
+                start -= 1;
+                baseStart -= 1;
+            }
+            size_t end = i + WINDOW_SIZE;
+            size_t baseEnd = block->second + WINDOW_SIZE;
+            while (end < target.size() && baseEnd < base.size() && base[baseEnd] == target[end]) {
+                end += 1;
+                baseEnd += 1;
+            }
+            emitAdd(literal, start);
+            emitCopy(baseStart, end - start);
+            i = end;
+            literal = end;
+            if (i + WINDOW_SIZE <= target.size()) {
+                hash = hashWindow(target, i);
+            }
+            continue;
+        }
+        if (i + WINDOW_SIZE < target.size()) {
+            hash = 
+                (hash - static_cast<uint8_t>(target[i]) * outWeight) * HASH_MULTIPLIER +
+                static_cast<uint8_t>(target[i + WINDOW_SIZE]);
+        }
+        i += 1;
+    }
+    emitAdd(literal, target.size());
+    return out;
+}
+
+Result<std::string> delta::apply(std::string_view base, std::string_view delta) {
+    if (!delta.starts_with(DELTA_MAGIC)) {
+        return Err("Not a delta");
+    }
+    size_t pos = DELTA_MAGIC.size();
+    auto baseSize = readVarInt(delta, pos);
+    auto targetSize = readVarInt(delta, pos);
+    if (!baseSize || !targetSize) {
+        return Err("Delta is truncated");
+    }
+    if (*baseSize != base.size()) {
+        return Err("Delta was made against a different base");
+    }
+
+    std::string out;
+    out.reserve(*targetSize);
+    while (pos < delta.size()) {
+        auto op = static_cast<DeltaOp>(delta[pos++]);
+        if (op == DeltaOp::Add) {
+            auto size = readVarInt(delta, pos);
+            if (!size || *size > delta.size() - pos) {
+                return Err("Delta is truncated");
+            }
+            out.append(delta.substr(pos, *size));
+            pos += *size;
+        }
+        else if (op == DeltaOp::Copy) {
+            auto offset = readVarInt(delta, pos);
+            auto size = readVarInt(delta, pos);
+            if (!offset || !size || *offset > base.size() || *size > base.size() - *offset) {
+                return Err("Delta is corrupted");
+            }
+            out.append(base.substr(*offset, *size));
+        }
+        else {
+            return Err("Delta is corrupted");
+        }
+    }
+    if (out.size() != *targetSize) {
+        return Err("Delta is corrupted");
+    }
+    return Ok(std::move(out));
+}
+
+DeltaChain::DeltaChain(Storage& storage, std::filesystem::path const& backupsDir)
+  : m_storage(storage), m_dir(backupsDir) {}
+
+std::filesystem::path DeltaChain::getLinkPath(std::filesystem::path const& dir, std::string_view name) {
+    auto path = dir / name;
+    path += LINK_EXT;
+    return path;
+}
+std::filesystem::path DeltaChain::getDeltaPath(std::filesystem::path const& dir, std::string_view name) {
+    auto path = dir / name;
+    path += DELTA_EXT;
+    return path;
+}
+
+// Links are small text files in the same spirit as chunk manifests:
+// backups-link 1
+// id <content id>
+// base <content id>
+// depth <n>
+std::optional<ChainLink> DeltaChain::readLink(std::filesystem::path const& dir, std::string_view name) const {
+    auto str = m_storage.read(getLinkPath(dir, name));
+    if (!str) {
+        return std::nullopt;
+    }
+    auto link = ChainLink();
+    bool header = false;
+    std::istringstream stream(*str);
+    std::string line;
+    while (std::getline(stream, line)) {
+        auto space = line.find(' ');
+        if (space == std::string::npos) {
+            continue;
+        }
+        auto key = std::string_view(line).substr(0, space);
+        auto value = std::string_view(line).substr(space + 1);
+        if (key == "backups-link") {
+            header = value == "1";
+        }
+        else if (key == "id") {
+            link.id = value;
+        }
+        else if (key == "base") {
+            link.base = std::string(value);
+        }
+        else if (key == "depth") {
+            std::from_chars(value.data(), value.data() + value.size(), link.depth);
+        }
+    }
+    if (!header || link.id.empty()) {
+        return std::nullopt;
+    }
+    return link;
+}
+static Result<> writeLink(Storage& storage, std::filesystem::path const& dir, std::string_view name, ChainLink const& link) {
+    auto str = fmt::format("backups-link 1\nid {}\n", link.id);
+    if (link.base) {
+        str += fmt::format("base {}\n", *link.base);
+    }
+    str += fmt::format("depth {}\n", link.depth);
+    return storage.write(DeltaChain::getLinkPath(dir, name), str);
+}
+
+static Result<> writeKeyframe(Storage& storage, std::filesystem::path const& dir, std::string_view name, std::string_view data) {
+    // Encoded the same way the game saves its files so keyframes can be 
+    // restored by just copying them
+    auto res = storage.write(dir / name, cc::compressString(data, 11));
+    if (!res) {
+        return Err("Unable to write keyframe: {}", res.unwrapErr());
+    }
+    return Ok();
+}
+
+std::vector<std::filesystem::path> DeltaChain::getBackups() const {
+    std::vector<std::filesystem::path> paths;
+    // Called while a backup is being written, which the index is updated 
+    // for once it's done
+    for (auto& entry : core::listBackups(m_storage, m_dir)) {
+        paths.push_back(entry.path);
+    }
+    return paths;
+}
+std::vector<std::pair<std::filesystem::path, ChainLink>> DeltaChain::readLinks(
+    std::vector<std::filesystem::path> const& backups, std::string_view name
+) const {
+    std::vector<std::pair<std::filesystem::path, ChainLink>> links;
+    for (auto& backup : backups) {
+        if (auto link = this->readLink(backup, name)) {
+            links.emplace_back(backup, std::move(*link));
+        }
+    }
+    return links;
+}
+DeltaChain::LinkMap DeltaChain::mapLinks(std::vector<std::pair<std::filesystem::path, ChainLink>> const& links) {
+    LinkMap map;
+    for (auto& [backup, link] : links) {
+        auto [found, added] = map.try_emplace(link.id, backup, link.depth);
+        if (!added && link.depth < found->second.second) {
+            found->second = { backup, link.depth };
+        }
+    }
+    return map;
+}
+
+Result<ChainWriteStats> DeltaChain::write(
+    std::filesystem::path const& dir, std::string_view name, std::string_view data,
+    size_t keyframeInterval
+) const {
+    auto stats = ChainWriteStats();
+    auto link = ChainLink();
+    link.id = xxh::contentID(data);
+
+    // Continue from the newest backup that's part of a chain
+    std::optional<std::filesystem::path> previous;
+    std::optional<ChainLink> previousLink;
+    auto backups = this->getBackups();
+    for (auto& backup : backups) {
+        if (backup == dir) {
+            continue;
+        }
+        if (auto other = this->readLink(backup, name)) {
+            previous = backup;
+            previousLink = other;
+            break;
+        }
+    }
+
+    if (previous && previousLink->depth + 1 < keyframeInterval) {
+        auto base = this->read(mapLinks(this->readLinks(backups, name)), *previous, name, 0);
+        if (base) {
+            auto encoded = cc::compressString(delta::encode(*base, data), 0);
+            // A delta bigger than a fraction of the data means too much 
+            // changed for it to be worth making restoring slower
+            if (encoded.size() < data.size() / 8) {
+                GEODE_UNWRAP(m_storage.write(getDeltaPath(dir, name), encoded));
+                link.base = previousLink->id;
+                link.depth = previousLink->depth + 1;
+                GEODE_UNWRAP(writeLink(m_storage, dir, name, link));
+                stats.bytesWritten = encoded.size();
+                return Ok(stats);
+            }
+        }
+        else {
+            log::warn("Unable to read previous backup {}, starting a new chain: {}", *previous, base.unwrapErr());
+        }
+    }
+
+    GEODE_UNWRAP(writeKeyframe(m_storage, dir, name, data));
+    GEODE_UNWRAP(writeLink(m_storage, dir, name, link));
+    stats.keyframe = true;
+    stats.bytesWritten = m_storage.size(dir / name);
+    return Ok(stats);
+}
+
+Result<std::string> DeltaChain::read(
+    LinkMap const& links, std::filesystem::path const& dir, std::string_view name, size_t depth
+) const {
+    if (!m_storage.exists(getDeltaPath(dir, name))) {
+        return cc::parseCompressedCCFile(m_storage, dir / name);
+    }
+    auto link = this->readLink(dir, name);
+    if (!link || !link->base) {
+        return Err("Backup {} is missing its chain link", dir.filename());
+    }
+    // Bases always have a lower depth so links can't form a cycle unless 
+    // the files were tampered with, but don't recurse forever if they were
+    if (depth > links.size()) {
+        return Err("Backup chain of {} loops", dir.filename());
+    }
+    // Only backups earlier in the chain can be the base, to rule out cycles
+    auto baseDir = links.find(*link->base);
+    if (baseDir == links.end() || baseDir->second.second >= link->depth) {
+        return Err("The backup that {} was based on is missing", dir.filename());
+    }
+    GEODE_UNWRAP_INTO(auto base, this->read(links, baseDir->second.first, name, depth + 1));
+    GEODE_UNWRAP_INTO(auto encoded, m_storage.read(getDeltaPath(dir, name)));
+    GEODE_UNWRAP_INTO(auto data, delta::apply(base, cc::decompressString(encoded, 0)));
+    if (xxh::contentID(data) != link->id) {
+        return Err("Backup {} is corrupted", dir.filename());
+    }
+    return Ok(std::move(data));
+}
+Result<std::string> DeltaChain::read(std::filesystem::path const& dir, std::string_view name) const {
+    // Keyframes don't need the rest of the chain
+    if (!m_storage.exists(getDeltaPath(dir, name))) {
+        return cc::parseCompressedCCFile(m_storage, dir / name);
+    }
+    // Every link is read once up front rather than at every step of the chain
+    return this->read(mapLinks(this->readLinks(this->getBackups(), name)), dir, name, 0);
+}
+
+Result<std::vector<std::filesystem::path>> DeltaChain::detach(std::filesystem::path const& dir) const {
+    std::vector<std::filesystem::path> changed;
+    // Most backups aren't part of a chain, so don't list anything for them
+    if (
+        !this->readLink(dir, "CCGameManager.dat") &&
+        !this->readLink(dir, "CCLocalLevels.dat")
+    ) {
+        return Ok(changed);
+    }
+    auto backups = this->getBackups();
+    for (auto name : { "CCGameManager.dat", "CCLocalLevels.dat" }) {
+        auto link = this->readLink(dir, name);
+        if (!link) {
+            continue;
+        }
+        auto links = this->readLinks(backups, name);
+        auto map = mapLinks(links);
+        for (auto& [backup, other] : links) {
+            if (backup == dir || other.base != link->id) {
+                continue;
+            }
+            // Another backup with the same contents can take this one's 
+            // place in the chain, as long as it comes before both in it
+            auto replacement = std::find_if(links.begin(), links.end(), [&](auto const& candidate) {
+                return candidate.first != dir && candidate.first != backup &&
+                    candidate.second.id == link->id &&
+                    candidate.second.depth <= link->depth && candidate.second.depth < other.depth;
+            });
+            if (replacement != links.end()) {
+                continue;
+            }
+            GEODE_UNWRAP_INTO(auto data, this->read(map, backup, name, 0));
+            GEODE_UNWRAP(writeKeyframe(m_storage, backup, name, data));
+            other.base = std::nullopt;
+            other.depth = 0;
+            GEODE_UNWRAP(writeLink(m_storage, backup, name, other));
+            (void)m_storage.remove(getDeltaPath(backup, name));
+            changed.push_back(backup);
+        }
+    }
+    return Ok(changed);
+}
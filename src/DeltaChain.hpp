@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Platform.hpp"
+#include "Storage.hpp"
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace geode::prelude;
+
+namespace delta {
+    // Binary delta of target against base, as a list of copies from base 
+    // and literal insertions. Works best when most of target appears in 
+    // base, like consecutive versions of the same save file
+    std::string encode(std::string_view base, std::string_view target);
+    Result<std::string> apply(std::string_view base, std::string_view delta);
+}
+
+// Where a save file in a delta-encoded backup sits in its chain. Links refer 
+// to each other by content id rather than by folder, so chains survive 
+// backups being renamed or moved together
+struct ChainLink final {
+	std::string id;
+	// Missing for keyframes
+	std::optional<std::string> base;
+	// Amount of deltas between this and the nearest keyframe
+	size_t depth = 0;
+};
+
+struct ChainWriteStats final {
+	bool keyframe = false;
+	size_t bytesWritten = 0;
+};
+
+// Delta-encoded backups: every few backups a full "keyframe" copy of a save 
+// file is stored, and the ones in between only store what changed compared 
+// to the previous backup's decompressed save data
+class DeltaChain final {
+private:
+	Storage& m_storage;
+	std::filesystem::path m_dir;
+
+	// Content id to the backup that has it and its depth. Identical saves 
+	// share a content id, in which case the one closest to a keyframe is kept
+	using LinkMap = std::unordered_map<std::string, std::pair<std::filesystem::path, size_t>>;
+
+	// Backups in the directory, newest first
+	std::vector<std::filesystem::path> getBackups() const;
+	// The backups that are part of a chain for the save file, in the same 
+	// order as given
+	std::vector<std::pair<std::filesystem::path, ChainLink>> readLinks(
+		std::vector<std::filesystem::path> const& backups, std::string_view name
+	) const;
+	static LinkMap mapLinks(std::vector<std::pair<std::filesystem::path, ChainLink>> const& links);
+	Result<std::string> read(
+		LinkMap const& links, std::filesystem::path const& dir, std::string_view name, size_t depth
+	) const;
+
+public:
+	static constexpr std::string_view LINK_EXT = ".link";
+	static constexpr std::string_view DELTA_EXT = ".delta";
+
+	DeltaChain(Storage& storage, std::filesystem::path const& backupsDir);
+
+	static std::filesystem::path getLinkPath(std::filesystem::path const& dir, std::string_view name);
+	static std::filesystem::path getDeltaPath(std::filesystem::path const& dir, std::string_view name);
+	std::optional<ChainLink> readLink(std::filesystem::path const& dir, std::string_view name) const;
+
+	// Store decompressed save data in a new backup, as a delta against the 
+	// newest backup in the chain unless it's time for a keyframe
+	Result<ChainWriteStats> write(
+		std::filesystem::path const& dir, std::string_view name, std::string_view data,
+		size_t keyframeInterval
+	) const;
+	// Rebuild the decompressed save data of a backup
+	Result<std::string> read(std::filesystem::path const& dir, std::string_view name) const;
+	// Turn every backup whose chain goes through this one into a keyframe, 
+	// so this one can be deleted. Returns the backups that were changed
+	Result<std::vector<std::filesystem::path>> detach(std::filesystem::path const& dir) const;
+};
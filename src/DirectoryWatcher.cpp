@@ -0,0 +1,127 @@
+#include "DirectoryWatcher.hpp"
+#include <algorithm>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+#if defined(__linux__)
+
+static constexpr uint32_t ROOT_EVENTS = 
+    IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+static constexpr uint32_t FOLDER_EVENTS = 
+    IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+
+// Summaries and temporary files are written all the time and don't change 
+// anything about how a backup is listed
+static bool isRelevantFile(std::string_view name) {
+    return name == "metadata.json" || name == "auto-remove.txt" || name.starts_with("CC");
+}
+
+DirectoryWatcher::DirectoryWatcher(std::filesystem::path const& dir) : m_dir(dir) {
+    m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        log::warn("Unable to watch backups directory: inotify unavailable (code {})", errno);
+        return;
+    }
+    m_rootWatch = ::inotify_add_watch(m_fd, dir.c_str(), ROOT_EVENTS);
+    if (m_rootWatch < 0) {
+        log::warn("Unable to watch backups directory (code {})", errno);
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+DirectoryWatcher::~DirectoryWatcher() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+bool DirectoryWatcher::isWatching() const {
+    return m_fd >= 0;
+}
+void DirectoryWatcher::watch(std::filesystem::path const& folder) {
+    if (m_fd < 0) {
+        return;
+    }
+    // Watching the same folder twice just returns the existing watch
+    auto wd = ::inotify_add_watch(m_fd, folder.c_str(), FOLDER_EVENTS | IN_ONLYDIR);
+    if (wd >= 0) {
+        m_watches[wd] = folder;
+    }
+}
+
+std::optional<std::vector<std::filesystem::path>> DirectoryWatcher::poll() {
+    std::vector<std::filesystem::path> changed;
+    if (m_fd < 0) {
+        return changed;
+    }
+
+    alignas(inotify_event) char buffer[16 * 1024];
+    while (true) {
+        auto n = ::read(m_fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        // EAGAIN means there's nothing more to read
+        if (n <= 0) {
+            break;
+        }
+        for (char* p = buffer; p < buffer + n;) {
+            auto event = reinterpret_cast<inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+
+            auto name = event->len ? std::string_view(event->name) : std::string_view();
+            if (event->mask & IN_Q_OVERFLOW) {
+                return std::nullopt;
+            }
+            if (event->wd == m_rootWatch) {
+                // The whole directory was moved or deleted
+                if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                    return std::nullopt;
+                }
+                if (!(event->mask & IN_ISDIR)) {
+                    continue;
+                }
+                auto folder = m_dir / name;
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    // New backups are empty when created, so they're watched 
+                    // to find out once they've been written
+                    this->watch(folder);
+                }
+                changed.push_back(folder);
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                m_watches.erase(event->wd);
+                continue;
+            }
+            auto folder = m_watches.find(event->wd);
+            if (folder != m_watches.end() && isRelevantFile(name)) {
+                changed.push_back(folder->second);
+            }
+        }
+    }
+
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    return changed;
+}
+
+#else
+
+DirectoryWatcher::DirectoryWatcher(std::filesystem::path const& dir) : m_dir(dir) {}
+DirectoryWatcher::~DirectoryWatcher() {}
+
+bool DirectoryWatcher::isWatching() const {
+    return false;
+}
+void DirectoryWatcher::watch(std::filesystem::path const&) {}
+
+std::optional<std::vector<std::filesystem::path>> DirectoryWatcher::poll() {
+    return std::vector<std::filesystem::path>();
+}
+
+#endif
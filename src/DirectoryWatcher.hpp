@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Geode/DefaultInclude.hpp>
+#include <filesystem>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+using namespace geode::prelude;
+
+// Watches a backups directory and the backups directly inside it for 
+// changes, so the list of backups can be patched instead of rebuilt. Only 
+// implemented with inotify on Linux and Android; everywhere else 
+// isWatching() is false and nothing is ever reported
+class DirectoryWatcher final {
+private:
+	std::filesystem::path m_dir;
+	int m_fd = -1;
+	int m_rootWatch = -1;
+	std::unordered_map<int, std::filesystem::path> m_watches;
+
+public:
+	DirectoryWatcher(std::filesystem::path const& dir);
+	DirectoryWatcher(DirectoryWatcher const&) = delete;
+	~DirectoryWatcher();
+
+	bool isWatching() const;
+	void watch(std::filesystem::path const& folder);
+
+	// Folders directly inside the watched directory that have been added, 
+	// removed or changed since the last poll. Returns nothing if changes 
+	// were missed and everything needs to be reloaded. Never blocks
+	std::optional<std::vector<std::filesystem::path>> poll();
+};
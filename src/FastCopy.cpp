@@ -0,0 +1,196 @@
+#include "FastCopy.hpp"
+#include "Storage.hpp"
+#include <vector>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+#elif defined(__APPLE__)
+#include <sys/clonefile.h>
+#endif
+
+std::string_view fastcopy::getStrategyName(Strategy strategy) {
+    switch (strategy) {
+        case Strategy::Reflink: return "reflink";
+        case Strategy::CopyFileRange: return "copy_file_range";
+        case Strategy::Sendfile: return "sendfile";
+        case Strategy::Platform: return "platform copy";
+        case Strategy::Buffered: default: return "buffered copy";
+    }
+}
+
+#if defined(__linux__)
+
+static std::string getErrnoMessage() {
+    auto ec = std::error_code(errno, std::generic_category());
+    return fmt::format("{} (code {})", ec.message(), ec.value());
+}
+
+class FileDescriptor final {
+private:
+    int m_fd;
+
+public:
+    FileDescriptor(int fd) : m_fd(fd) {}
+    FileDescriptor(FileDescriptor const&) = delete;
+    ~FileDescriptor() {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+    }
+    int get() const {
+        return m_fd;
+    }
+};
+
+static Result<fastcopy::Stats> copyFileContents(int in, int out, size_t size) {
+    auto stats = fastcopy::Stats();
+    size_t copied = 0;
+
+#ifdef FICLONE
+    // Only works within the same btrfs / XFS filesystem, but then it's just
+    // a metadata update
+    if (::ioctl(out, FICLONE, in) == 0) {
+        stats.strategy = fastcopy::Strategy::Reflink;
+        stats.bytes = size;
+        return Ok(stats);
+    }
+#endif
+
+    // Each of these fails on filesystems or kernels that don't support it,
+    // in which case the next one continues from wherever the previous one
+    // got to since they all advance the file offsets
+
+#ifdef __NR_copy_file_range
+    // Called through syscall since older Android libcs don't have a wrapper
+    stats.strategy = fastcopy::Strategy::CopyFileRange;
+    while (copied < size) {
+        auto n = ::syscall(__NR_copy_file_range, in, nullptr, out, nullptr, size - copied, 0u);
+        if (n <= 0) {
+            break;
+        }
+        copied += static_cast<size_t>(n);
+    }
+#endif
+
+    if (copied < size) {
+        stats.strategy = fastcopy::Strategy::Sendfile;
+        while (copied < size) {
+            auto n = ::sendfile(out, in, nullptr, size - copied);
+            if (n <= 0) {
+                break;
+            }
+            copied += static_cast<size_t>(n);
+        }
+    }
+
+    // The buffered copy also picks up anything appended while copying
+    if (copied < size) {
+        stats.strategy = fastcopy::Strategy::Buffered;
+    }
+    std::vector<char> buffer(1024 * 1024);
+    while (true) {
+        auto n = ::read(in, buffer.data(), buffer.size());
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return Err("Unable to read file: {}", getErrnoMessage());
+        }
+        if (n == 0) {
+            break;
+        }
+        size_t written = 0;
+        while (written < static_cast<size_t>(n)) {
+            auto w = ::write(out, buffer.data() + written, n - written);
+            if (w < 0 && errno == EINTR) {
+                continue;
+            }
+            if (w < 0) {
+                return Err("Unable to write file: {}", getErrnoMessage());
+            }
+            written += static_cast<size_t>(w);
+        }
+        copied += written;
+    }
+
+    stats.bytes = copied;
+    return Ok(stats);
+}
+
+// Copies to a path that must not exist yet
+static Result<fastcopy::Stats> copyToNewFile(std::filesystem::path const& from, std::filesystem::path const& to) {
+    auto in = FileDescriptor(::open(from.c_str(), O_RDONLY | O_CLOEXEC));
+    if (in.get() < 0) {
+        return Err("Unable to open {}: {}", from.filename(), getErrnoMessage());
+    }
+    struct stat st;
+    if (::fstat(in.get(), &st) != 0) {
+        return Err("Unable to read {}: {}", from.filename(), getErrnoMessage());
+    }
+    auto out = FileDescriptor(::open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 0777));
+    if (out.get() < 0) {
+        return Err("Unable to create {}: {}", to.filename(), getErrnoMessage());
+    }
+    auto res = copyFileContents(in.get(), out.get(), static_cast<size_t>(st.st_size));
+    if (!res) {
+        ::unlink(to.c_str());
+    }
+    return res;
+}
+
+#else
+
+static Result<fastcopy::Stats> copyToNewFile(std::filesystem::path const& from, std::filesystem::path const& to) {
+    auto stats = fastcopy::Stats();
+    std::error_code ec;
+
+#if defined(__APPLE__)
+    // Copy-on-write clone on APFS
+    if (::clonefile(from.c_str(), to.c_str(), 0) == 0) {
+        stats.strategy = fastcopy::Strategy::Reflink;
+        stats.bytes = std::filesystem::file_size(to, ec);
+        return Ok(stats);
+    }
+#endif
+
+    // The standard library already uses the OS copy function here
+    // (CopyFile2 on Windows, fcopyfile on Apple platforms)
+    std::filesystem::copy_file(from, to, ec);
+    if (ec) {
+        return Err("{} (code {})", ec.message(), ec.value());
+    }
+    stats.strategy = fastcopy::Strategy::Platform;
+    stats.bytes = std::filesystem::file_size(to, ec);
+    return Ok(stats);
+}
+
+#endif
+
+Result<fastcopy::Stats> fastcopy::copyFile(
+    std::filesystem::path const& from, std::filesystem::path const& to,
+    bool overwrite
+) {
+    if (!overwrite) {
+        return copyToNewFile(from, to);
+    }
+
+    // Restoring writes into the live save folder, which another restore could 
+    // be writing to at the same time
+    auto tmp = LocalStorage::getTmpPath(to);
+    std::error_code ec;
+    GEODE_UNWRAP_INTO(auto stats, copyToNewFile(from, tmp));
+    std::filesystem::rename(tmp, to, ec);
+    if (ec) {
+        std::error_code rec;
+        std::filesystem::remove(tmp, rec);
+        return Err("Unable to replace {}: {} (code {})", to.filename(), ec.message(), ec.value());
+    }
+    return Ok(stats);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Platform.hpp"
+#include <filesystem>
+#include <string_view>
+
+using namespace geode::prelude;
+
+namespace fastcopy {
+    enum class Strategy {
+        // Copy-on-write clone (FICLONE on btrfs/XFS, clonefile on APFS); no
+        // data is actually copied and the files share storage
+        Reflink,
+        // In-kernel copies that never bring the data into userspace
+        CopyFileRange,
+        Sendfile,
+        // Whatever the OS copy function does (CopyFile2 on Windows)
+        Platform,
+        Buffered,
+    };
+
+    struct Stats final {
+        Strategy strategy = Strategy::Buffered;
+        size_t bytes = 0;
+    };
+
+    std::string_view getStrategyName(Strategy strategy);
+
+    // Copy a file using the cheapest mechanism the platform and filesystem
+    // support. When overwriting, the target is replaced atomically so a
+    // failed copy never leaves a truncated file behind
+    Result<Stats> copyFile(
+        std::filesystem::path const& from, std::filesystem::path const& to,
+        bool overwrite = false
+    );
+}
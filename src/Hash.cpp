@@ -0,0 +1,136 @@
+#include "Hash.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fmt/format.h>
+
+static constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ull;
+static constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+static constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ull;
+static constexpr uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ull;
+static constexpr uint64_t PRIME64_5 = 0x27D4EB2F165667C5ull;
+
+static inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+static inline uint64_t read64(uint8_t const* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+static inline uint32_t read32(uint8_t const* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+static inline uint64_t round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME64_2;
+    acc = rotl(acc, 31);
+    return acc * PRIME64_1;
+}
+static inline uint64_t mergeRound(uint64_t acc, uint64_t val) {
+    acc ^= round(0, val);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+static inline uint64_t mergeAccumulators(uint64_t const (&v)[4]) {
+    auto h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+    h = mergeRound(h, v[0]);
+    h = mergeRound(h, v[1]);
+    h = mergeRound(h, v[2]);
+    h = mergeRound(h, v[3]);
+    return h;
+}
+
+// Mixes in whatever didn't fill a whole 32-byte stripe
+static uint64_t finalize(uint64_t h, uint8_t const* p, uint8_t const* end) {
+    while (p + 8 <= end) {
+        h ^= round(0, read64(p));
+        h = rotl(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<uint64_t>(read32(p)) * PRIME64_1;
+        h = rotl(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * PRIME64_5;
+        h = rotl(h, 11) * PRIME64_1;
+        p += 1;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t xxh::xxh64(void const* data, size_t size, uint64_t seed) {
+    auto p = static_cast<uint8_t const*>(data);
+    auto const end = p + size;
+    uint64_t h;
+
+    if (size >= 32) {
+        auto const limit = end - 32;
+        uint64_t v[4] = { seed + PRIME64_1 + PRIME64_2, seed + PRIME64_2, seed, seed - PRIME64_1 };
+        do {
+            v[0] = round(v[0], read64(p));
+            v[1] = round(v[1], read64(p + 8));
+            v[2] = round(v[2], read64(p + 16));
+            v[3] = round(v[3], read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = mergeAccumulators(v);
+    }
+    else {
+        h = seed + PRIME64_5;
+    }
+
+    return finalize(h + static_cast<uint64_t>(size), p, end);
+}
+
+xxh::Hasher::Hasher(uint64_t seed)
+  : m_seed(seed), m_acc { seed + PRIME64_1 + PRIME64_2, seed + PRIME64_2, seed, seed - PRIME64_1 } {}
+
+void xxh::Hasher::update(std::string_view data) {
+    auto p = reinterpret_cast<uint8_t const*>(data.data());
+    auto const end = p + data.size();
+    m_total += data.size();
+
+    // Top up a partial stripe left over from last time first
+    if (m_buffered) {
+        auto take = std::min<size_t>(sizeof(m_buffer) - m_buffered, data.size());
+        std::memcpy(m_buffer + m_buffered, p, take);
+        m_buffered += take;
+        p += take;
+        if (m_buffered < sizeof(m_buffer)) {
+            return;
+        }
+        for (size_t i = 0; i < 4; i += 1) {
+            m_acc[i] = round(m_acc[i], read64(m_buffer + i * 8));
+        }
+        m_buffered = 0;
+    }
+    while (p + 32 <= end) {
+        for (size_t i = 0; i < 4; i += 1) {
+            m_acc[i] = round(m_acc[i], read64(p + i * 8));
+        }
+        p += 32;
+    }
+    std::memcpy(m_buffer, p, end - p);
+    m_buffered = end - p;
+}
+uint64_t xxh::Hasher::digest() const {
+    auto h = m_total >= 32 ? mergeAccumulators(m_acc) : m_seed + PRIME64_5;
+    return finalize(h + m_total, m_buffer, m_buffer + m_buffered);
+}
+
+std::string xxh::contentID(std::string_view data) {
+    return fmt::format(
+        "{:016x}{:016x}",
+        xxh64(data.data(), data.size(), 0),
+        xxh64(data.data(), data.size(), PRIME64_1)
+    );
+}
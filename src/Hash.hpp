@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace xxh {
+    // Plain XXH64, used for content-addressing save data
+    uint64_t xxh64(void const* data, size_t size, uint64_t seed = 0);
+
+    // XXH64 of data that arrives a piece at a time. Gives the same hash as 
+    // calling xxh64 on all of it at once
+    class Hasher final {
+    private:
+        uint64_t m_seed;
+        uint64_t m_acc[4];
+        uint8_t m_buffer[32];
+        size_t m_buffered = 0;
+        uint64_t m_total = 0;
+
+    public:
+        Hasher(uint64_t seed = 0);
+
+        void update(std::string_view data);
+        uint64_t digest() const;
+    };
+
+    // 128-bit content id as 32 hex characters (two XXH64 lanes with
+    // different seeds)
+    std::string contentID(std::string_view data);
+}
@@ -0,0 +1,300 @@
+#include "Import.hpp"
+#include "BackupCore.hpp"
+#include "BackupIndex.hpp"
+#include "ChunkStore.hpp"
+#include "DeltaChain.hpp"
+#include "LevelIndex.hpp"
+#include "Mover.hpp"
+#include "Zstd.hpp"
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+size_t ImportProgress::getFound() const {
+    return m_found;
+}
+size_t ImportProgress::getImported() const {
+    return m_imported;
+}
+size_t ImportProgress::getFailed() const {
+    return m_failed;
+}
+size_t ImportProgress::getBytesCopied() const {
+    return m_bytesCopied;
+}
+double ImportProgress::getCopySpeed() const {
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_startTime).count();
+    return elapsed > 0 ? m_bytesCopied / elapsed : 0;
+}
+bool ImportProgress::isFinished() const {
+    return m_finished;
+}
+bool ImportProgress::isCancelled() const {
+    return m_cancelled;
+}
+std::vector<ImportFailure> ImportProgress::takeFailures() {
+    std::lock_guard lock(m_failuresLock);
+    return std::exchange(m_failures, {});
+}
+void ImportProgress::cancel() {
+    m_cancelled = true;
+}
+void ImportProgress::onFound() {
+    m_found += 1;
+}
+void ImportProgress::onImported() {
+    m_imported += 1;
+}
+void ImportProgress::onBytesCopied(size_t bytes) {
+    m_bytesCopied += bytes;
+}
+void ImportProgress::onFailed(ImportFailure failure) {
+    m_failed += 1;
+    std::lock_guard lock(m_failuresLock);
+    m_failures.push_back(std::move(failure));
+}
+void ImportProgress::onFinished() {
+    m_finished = true;
+}
+
+namespace {
+    struct ImportTask final {
+        std::filesystem::path path;
+        // Otherwise the folder is scanned for more backups
+        bool isBackup;
+    };
+
+    // Each worker pushes and pops its own work from the back (so scanning 
+    // goes depth-first and the queues stay small) and steals from the front 
+    // of others' queues when it runs out
+    struct WorkerQueue final {
+        std::mutex lock;
+        std::deque<ImportTask> tasks;
+    };
+
+    class ImportRun final {
+    private:
+        Storage& m_storage;
+        std::filesystem::path m_backupsDir;
+        std::string m_user;
+        ImportProgress& m_progress;
+        std::vector<WorkerQueue> m_queues;
+        // Queued and running tasks; workers stop once this hits zero
+        std::atomic_size_t m_pending = 0;
+        // Only queued tasks, so idle workers know when there's one to take
+        std::atomic_size_t m_queued = 0;
+        std::mutex m_idleLock;
+        std::condition_variable m_idle;
+        std::mutex m_chunksLock;
+
+        void push(size_t worker, ImportTask task) {
+            m_pending += 1;
+            {
+                std::lock_guard lock(m_queues[worker].lock);
+                m_queues[worker].tasks.push_back(std::move(task));
+            }
+            {
+                std::lock_guard lock(m_idleLock);
+                m_queued += 1;
+            }
+            m_idle.notify_one();
+        }
+        void finish() {
+            if (--m_pending == 0) {
+                std::lock_guard lock(m_idleLock);
+                m_idle.notify_all();
+            }
+        }
+        std::optional<ImportTask> pop(size_t worker) {
+            {
+                std::lock_guard lock(m_queues[worker].lock);
+                auto& tasks = m_queues[worker].tasks;
+                if (!tasks.empty()) {
+                    auto task = std::move(tasks.back());
+                    tasks.pop_back();
+                    m_queued -= 1;
+                    return task;
+                }
+            }
+            for (size_t i = 1; i < m_queues.size(); i += 1) {
+                auto& victim = m_queues[(worker + i) % m_queues.size()];
+                std::lock_guard lock(victim.lock);
+                if (!victim.tasks.empty()) {
+                    auto task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    m_queued -= 1;
+                    return task;
+                }
+            }
+            return std::nullopt;
+        }
+
+        void fail(std::filesystem::path const& path, std::string error) {
+            log::error("Unable to import {}: {}", path, error);
+            m_progress.onFailed(ImportFailure {
+                .path = path,
+                .error = std::move(error),
+            });
+        }
+
+        void scan(size_t worker, std::filesystem::path const& path) {
+            // Deduplicated backups need their chunks to come along with them. 
+            // Failing to bring them counts as a failure so a directory move 
+            // isn't considered done without them
+            if (m_storage.isDirectory(path / ChunkStore::DIR_NAME)) {
+                // Importing merges into the one shared store
+                std::lock_guard lock(m_chunksLock);
+                auto res = ChunkStore(m_storage, m_backupsDir).importFrom(ChunkStore(m_storage, path));
+                if (!res) {
+                    this->fail(path / ChunkStore::DIR_NAME, fmt::format("Unable to import chunks: {}", res.unwrapErr()));
+                }
+            }
+            // Same for the dictionaries of zstd backups
+            if (m_storage.isDirectory(path / zstd::DICTS_DIR)) {
+                std::lock_guard lock(m_chunksLock);
+                auto res = zstd::importDictionaries(m_storage, path, m_backupsDir);
+                if (!res) {
+                    this->fail(path / zstd::DICTS_DIR, fmt::format("Unable to import zstd dictionaries: {}", res.unwrapErr()));
+                }
+            }
+            for (auto folder : m_storage.list(path).unwrapOrDefault()) {
+                // Importing a folder that contains the backups directory 
+                // shouldn't try to import it into itself
+                if (
+                    folder.filename() == ChunkStore::DIR_NAME || folder.filename() == mover::STAGING_DIR ||
+                    folder.filename() == zstd::DICTS_DIR ||
+                    folder == m_backupsDir ||
+                    !m_storage.isDirectory(folder)
+                ) {
+                    continue;
+                }
+                if (core::isBackup(m_storage, folder)) {
+                    m_progress.onFound();
+                    this->push(worker, ImportTask { .path = folder, .isBackup = true });
+                }
+                else {
+                    this->push(worker, ImportTask { .path = folder, .isBackup = false });
+                }
+            }
+        }
+
+        // A backup imported on its own leaves the backups next to it behind, 
+        // so whatever it shares with them is copied rather than moved
+        Result<> importSharedWith(std::filesystem::path const& backup) {
+            auto parent = backup.parent_path();
+            std::vector<std::filesystem::path> manifests;
+            for (auto name : { "CCGameManager.dat", "CCLocalLevels.dat" }) {
+                // Backups in a chain need each other, whichever way round
+                if (DeltaChain(m_storage, parent).readLink(backup, name)) {
+                    return Err("It's part of a delta chain with the backups next to it, so import the folder it's in instead");
+                }
+                auto manifest = backup / name;
+                manifest += ChunkStore::MANIFEST_EXT;
+                if (m_storage.exists(manifest)) {
+                    manifests.push_back(std::move(manifest));
+                }
+            }
+            if (!manifests.empty()) {
+                auto res = ChunkStore(m_storage, m_backupsDir).copyFrom(ChunkStore(m_storage, parent), manifests);
+                if (!res) {
+                    return Err("Unable to import chunks: {}", res.unwrapErr());
+                }
+            }
+            auto res = zstd::importDictionaries(m_storage, parent, m_backupsDir);
+            if (!res) {
+                return Err("Unable to import zstd dictionaries: {}", res.unwrapErr());
+            }
+            return Ok();
+        }
+
+        void work(size_t worker) {
+            while (m_pending > 0) {
+                auto task = this->pop(worker);
+                if (!task) {
+                    // Someone else is still scanning and may find more work
+                    std::unique_lock lock(m_idleLock);
+                    m_idle.wait(lock, [this] { return m_pending == 0 || m_queued > 0; });
+                    continue;
+                }
+                if (!m_progress.isCancelled()) {
+                    if (!task->isBackup) {
+                        this->scan(worker, task->path);
+                    }
+                    else if (auto res = core::migrateBackup(m_storage, m_backupsDir, task->path, m_user, [this](size_t bytes) {
+                        m_progress.onBytesCopied(bytes);
+                    })) {
+                        m_progress.onImported();
+                    }
+                    else {
+                        this->fail(task->path, res.unwrapErr());
+                    }
+                }
+                this->finish();
+            }
+        }
+
+    public:
+        ImportRun(
+            Storage& storage, std::filesystem::path const& backupsDir, std::string const& user,
+            ImportProgress& progress, size_t workers
+        ) : m_storage(storage), m_backupsDir(backupsDir), m_user(user), m_progress(progress), m_queues(workers) {}
+
+        void run(std::filesystem::path const& from) {
+            if (core::isBackup(m_storage, from)) {
+                m_progress.onFound();
+                auto res = this->importSharedWith(from);
+                if (!res) {
+                    return this->fail(from, res.unwrapErr());
+                }
+                this->push(0, ImportTask { .path = from, .isBackup = true });
+            }
+            else {
+                this->push(0, ImportTask { .path = from, .isBackup = false });
+            }
+            std::vector<std::thread> threads;
+            for (size_t i = 1; i < m_queues.size(); i += 1) {
+                threads.emplace_back([this, i] { this->work(i); });
+            }
+            this->work(0);
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+    };
+}
+
+ImportSummary BackupImporter::run(
+    Storage& storage, std::filesystem::path const& from, std::filesystem::path const& backupsDir,
+    std::string const& user, ImportProgress& progress
+) {
+    auto workers = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, MAX_WORKERS);
+    {
+        auto lock = core::lockForAdding();
+        ImportRun(storage, backupsDir, user, progress, workers).run(from);
+    }
+    progress.onFinished();
+
+    auto summary = ImportSummary();
+    summary.imported = progress.getImported();
+    summary.failed = progress.getFailed();
+    summary.cancelled = progress.isCancelled();
+    return summary;
+}
+
+Result<> BackupImporter::removeMovedFrom(Storage& storage, std::filesystem::path const& dir) {
+    for (auto& folder : storage.list(dir).unwrapOrDefault()) {
+        if (core::isBackup(storage, folder)) {
+            return Err("{} still has backups in it", dir);
+        }
+    }
+    for (auto name : { ChunkStore::DIR_NAME, zstd::DICTS_DIR, LevelIndex::DIR_NAME, BackupIndex::FILE_NAME }) {
+        if (storage.exists(dir / name)) {
+            GEODE_UNWRAP(storage.remove(dir / name));
+        }
+    }
+    // Anything else in there was put there by someone else
+    if (storage.list(dir).unwrapOrDefault().empty()) {
+        GEODE_UNWRAP(storage.remove(dir));
+    }
+    return Ok();
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Platform.hpp"
+#include "Storage.hpp"
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace geode::prelude;
+
+struct ImportFailure final {
+	std::filesystem::path path;
+	std::string error;
+};
+
+struct ImportSummary final {
+	size_t imported = 0;
+	size_t failed = 0;
+	bool cancelled = false;
+};
+
+// Shared between the import workers and whoever is showing the progress. 
+// Everything here can be read from any thread while the import is running
+class ImportProgress final {
+private:
+	std::atomic_size_t m_found = 0;
+	std::atomic_size_t m_imported = 0;
+	std::atomic_size_t m_failed = 0;
+	std::atomic_size_t m_bytesCopied = 0;
+	std::chrono::steady_clock::time_point m_startTime = std::chrono::steady_clock::now();
+	std::atomic_bool m_cancelled = false;
+	std::atomic_bool m_finished = false;
+	std::mutex m_failuresLock;
+	std::vector<ImportFailure> m_failures;
+
+public:
+	size_t getFound() const;
+	size_t getImported() const;
+	size_t getFailed() const;
+	// Only backups coming from another drive are copied
+	size_t getBytesCopied() const;
+	// In bytes per second
+	double getCopySpeed() const;
+	bool isFinished() const;
+	bool isCancelled() const;
+
+	// Failures since the last call, so they can be shown as they happen
+	std::vector<ImportFailure> takeFailures();
+	// Backups already imported stay imported
+	void cancel();
+
+	// Reported by the import workers
+	void onFound();
+	void onImported();
+	void onBytesCopied(size_t bytes);
+	void onFailed(ImportFailure failure);
+	void onFinished();
+};
+
+// Imports every backup found anywhere inside a folder into a backups 
+// directory. The folder tree is scanned and backups moved by a few workers 
+// that steal work from each other, so deep trees and slow drives don't 
+// serialize on a single directory listing. Imported backups are listed as 
+// being made by the given user. Blocks until done
+class BackupImporter final {
+public:
+	// Also the maximum amount of filesystem operations in flight at once
+	static constexpr size_t MAX_WORKERS = 4;
+
+	static ImportSummary run(
+		Storage& storage, std::filesystem::path const& from, std::filesystem::path const& backupsDir,
+		std::string const& user, ImportProgress& progress
+	);
+	// Once every backup has been moved out of a backups directory, removes 
+	// what its backups shared (chunks, dictionaries and indexes) and the 
+	// directory itself if that leaves it empty
+	static Result<> removeMovedFrom(Storage& storage, std::filesystem::path const& dir);
+};
@@ -0,0 +1,93 @@
+#include "InfoLoader.hpp"
+
+InfoRequest::InfoRequest(std::filesystem::path const& path) : m_path(path) {}
+
+std::filesystem::path InfoRequest::getPath() const {
+    return m_path;
+}
+bool InfoRequest::isFinished() const {
+    return m_finished;
+}
+Result<BackupInfo> InfoRequest::getInfo() const {
+    return *m_info;
+}
+
+InfoLoader::InfoLoader(std::shared_ptr<Storage> storage) : m_storage(std::move(storage)) {}
+
+InfoLoader::~InfoLoader() {
+    {
+        std::lock_guard lock(m_lock);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+std::shared_ptr<InfoRequest> InfoLoader::request(std::filesystem::path const& path, InfoPriority priority) {
+    std::unique_lock lock(m_lock);
+    // Workers are only started once something is first asked for
+    while (m_workers.size() < MAX_WORKERS) {
+        m_workers.emplace_back([this] { this->work(); });
+    }
+
+    auto& existing = m_requests[path];
+    auto request = existing.lock();
+    if (request && (request->m_started || priority == InfoPriority::Prefetch)) {
+        return request;
+    }
+    if (!request) {
+        request = std::make_shared<InfoRequest>(path);
+        existing = request;
+    }
+    m_queues[static_cast<size_t>(priority)].push_back(request);
+    lock.unlock();
+    m_wake.notify_one();
+    return request;
+}
+
+std::shared_ptr<InfoRequest> InfoLoader::pop() {
+    std::unique_lock lock(m_lock);
+    while (!m_stopping) {
+        for (auto& queue : m_queues) {
+            while (!queue.empty()) {
+                auto request = queue.front().lock();
+                queue.pop_front();
+                // Skip requests nobody wants anymore, and ones that were
+                // moved up and have already been started from there
+                if (request && !request->m_started) {
+                    request->m_started = true;
+                    return request;
+                }
+            }
+        }
+        m_wake.wait(lock);
+    }
+    return nullptr;
+}
+
+void InfoLoader::work() {
+    while (auto request = this->pop()) {
+        auto path = request->m_path;
+        // Only the requesters keep it alive while it's loading, so it can be
+        // cancelled by letting go of it
+        std::weak_ptr<InfoRequest> weak = request;
+        request = nullptr;
+
+        auto info = core::loadInfo(*m_storage, path, [&] {
+            return m_stopping || weak.expired();
+        });
+
+        std::lock_guard lock(m_lock);
+        if (auto finished = weak.lock()) {
+            finished->m_info = std::move(info);
+            finished->m_finished = true;
+        }
+        // The request can be forgotten if it was let go of
+        auto it = m_requests.find(path);
+        if (it != m_requests.end() && it->second.expired()) {
+            m_requests.erase(it);
+        }
+    }
+}
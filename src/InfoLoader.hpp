@@ -0,0 +1,82 @@
+#pragma once
+
+#include "BackupCore.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Backups on screen are loaded before ones that are only close to it
+enum class InfoPriority {
+	Visible,
+	Prefetch,
+};
+
+// A backup's info, loading in the background. Everyone who asks for the same
+// backup's info while it's being loaded gets the same request, and it's
+// cancelled once none of them hold on to it anymore, even if it's partway
+// through decompressing the backup
+class InfoRequest final {
+private:
+	std::filesystem::path m_path;
+	// Guarded by the loader's lock
+	bool m_started = false;
+	std::atomic_bool m_finished = false;
+	// Only written before m_finished is set
+	std::optional<Result<BackupInfo>> m_info;
+
+	friend class InfoLoader;
+
+public:
+	InfoRequest(std::filesystem::path const& path);
+
+	std::filesystem::path getPath() const;
+	// Can be polled from any thread
+	bool isFinished() const;
+	// Only valid once finished. Fails if the backup's save files couldn't 
+	// be read
+	Result<BackupInfo> getInfo() const;
+};
+
+// Loads backups' info on a few threads of its own, so that scrolling past
+// many backups queues up requests instead of decompressions
+class InfoLoader final {
+public:
+	// Each load decodes both save files at the same time, so this uses up to
+	// twice as many threads
+	static constexpr size_t MAX_WORKERS = 2;
+
+private:
+	std::shared_ptr<Storage> m_storage;
+	std::mutex m_lock;
+	std::condition_variable m_wake;
+	// One queue per priority. Requests that were moved up to a higher
+	// priority are in both, and skipped in the lower one once started
+	std::deque<std::weak_ptr<InfoRequest>> m_queues[2];
+	// So requests can be shared. Ones nobody holds anymore are replaced the 
+	// next time their backup is asked for
+	std::map<std::filesystem::path, std::weak_ptr<InfoRequest>> m_requests;
+	std::vector<std::thread> m_workers;
+	std::atomic_bool m_stopping = false;
+
+	// Blocks until there's a request to load, or returns null when stopping
+	std::shared_ptr<InfoRequest> pop();
+	void work();
+
+public:
+	InfoLoader(std::shared_ptr<Storage> storage);
+	InfoLoader(InfoLoader const&) = delete;
+	InfoLoader& operator=(InfoLoader const&) = delete;
+	// Cancels whatever is being loaded and waits for the workers to stop
+	~InfoLoader();
+
+	// Asking again for a backup that's already requested returns the same
+	// request, moving it up if the new priority is higher
+	std::shared_ptr<InfoRequest> request(std::filesystem::path const& path, InfoPriority priority);
+};
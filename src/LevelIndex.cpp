@@ -0,0 +1,388 @@
+#include "LevelIndex.hpp"
+#include <matjson/std.hpp>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <mutex>
+
+// Backups are made and removed from both the main thread and the automatic
+// backup job, while syncing runs on its own
+static std::mutex LEVEL_INDEX_MUTEX;
+// How many backups sync indexes before saving, so a big sync doesn't
+// rewrite the whole index after every backup
+static constexpr size_t SYNC_BATCH_SIZE = 8;
+
+static std::filesystem::path getIndexPath(std::filesystem::path const& dir) {
+    return dir / LevelIndex::DIR_NAME / "index.json";
+}
+
+static std::string toLower(std::string_view str) {
+    std::string result(str);
+    for (auto& c : result) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return result;
+}
+
+static bool isSameLevel(BackupLevel const& a, BackupLevel const& b) {
+    return a.hash == b.hash && a.id == b.id && a.version == b.version && a.name == b.name;
+}
+
+void LevelIndex::addLookups(size_t index) {
+    auto& level = m_entries[index].level;
+    m_byName[toLower(level.name)].push_back(index);
+    if (level.id) {
+        m_byID[level.id].push_back(index);
+    }
+    m_byHash[level.hash].push_back(index);
+}
+void LevelIndex::rebuildLookups() {
+    m_byName.clear();
+    m_byID.clear();
+    m_byHash.clear();
+    for (size_t i = 0; i < m_entries.size(); i += 1) {
+        this->addLookups(i);
+    }
+}
+
+bool LevelIndex::isNewer(std::string const& folder, std::string const& other) const {
+    auto getTime = [this](std::string const& folder) -> int64_t {
+        auto it = m_backups.find(folder);
+        return it != m_backups.end() ? it->second : 0;
+    };
+    auto time = getTime(folder);
+    auto otherTime = getTime(other);
+    return core::isNewer(Time(std::chrono::seconds(time)), folder, Time(std::chrono::seconds(otherTime)), other);
+}
+void LevelIndex::sortBackups(Entry& entry) const {
+    std::sort(entry.backups.begin(), entry.backups.end(), [this](auto const& a, auto const& b) {
+        return this->isNewer(a, b);
+    });
+}
+
+void LevelIndex::addBackup(std::string const& folder, Time time, std::vector<BackupLevel> const& levels) {
+    this->removeBackup(folder);
+    m_backups.emplace(folder, std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count());
+    for (auto& level : levels) {
+        Entry* existing = nullptr;
+        if (auto candidates = m_byHash.find(level.hash); candidates != m_byHash.end()) {
+            for (auto i : candidates->second) {
+                if (isSameLevel(m_entries[i].level, level)) {
+                    existing = &m_entries[i];
+                    break;
+                }
+            }
+        }
+        if (existing) {
+            // The same level can be in a save twice
+            if (std::find(existing->backups.begin(), existing->backups.end(), folder) == existing->backups.end()) {
+                auto pos = std::find_if(existing->backups.begin(), existing->backups.end(), [&](auto const& other) {
+                    return !this->isNewer(other, folder);
+                });
+                existing->backups.insert(pos, folder);
+            }
+        }
+        else {
+            m_entries.push_back(Entry { level, { folder } });
+            this->addLookups(m_entries.size() - 1);
+        }
+    }
+}
+void LevelIndex::removeBackup(std::string const& folder) {
+    if (!m_backups.erase(folder)) {
+        return;
+    }
+    for (auto& entry : m_entries) {
+        std::erase(entry.backups, folder);
+    }
+    // Versions of levels no backup has anymore
+    if (std::erase_if(m_entries, [](Entry const& entry) { return entry.backups.empty(); })) {
+        this->rebuildLookups();
+    }
+}
+
+Result<> LevelIndex::save(Storage& storage, std::filesystem::path const& dir) const {
+    // Most levels are in most backups, so backups are only written out once
+    // and referred to by their position
+    std::vector<std::string> backups;
+    for (auto& [folder, time] : m_backups) {
+        backups.push_back(folder);
+    }
+    std::sort(backups.begin(), backups.end());
+    std::vector<int64_t> times;
+    std::unordered_map<std::string_view, size_t> positions;
+    for (size_t i = 0; i < backups.size(); i += 1) {
+        times.push_back(m_backups.at(backups[i]));
+        positions.emplace(backups[i], i);
+    }
+
+    auto levels = matjson::Value::array();
+    for (auto& entry : m_entries) {
+        auto refs = matjson::Value::array();
+        for (auto& backup : entry.backups) {
+            refs.push(positions.at(backup));
+        }
+        levels.push(matjson::makeObject({
+            { "name", entry.level.name },
+            { "id", entry.level.id },
+            { "version", entry.level.version },
+            // Not every 64-bit number fits in a JSON number
+            { "hash", fmt::format("{:016x}", entry.level.hash) },
+            { "backups", refs },
+        }));
+    }
+    GEODE_UNWRAP(storage.createDirectories(dir / DIR_NAME));
+    return storage.write(getIndexPath(dir), matjson::makeObject({
+        { "version", VERSION },
+        { "backups", backups },
+        { "times", times },
+        { "levels", levels },
+    }).dump(matjson::NO_INDENTATION));
+}
+
+LevelIndex LevelIndex::load(Storage const& storage, std::filesystem::path const& dir) {
+    auto index = LevelIndex();
+    auto data = storage.read(getIndexPath(dir));
+    if (!data) {
+        return index;
+    }
+    auto parsed = matjson::parse(*data);
+    if (!parsed) {
+        log::warn("Level index is corrupted, it will be rebuilt");
+        return index;
+    }
+    auto const& json = *parsed;
+    // Outdated indexes are rebuilt from scratch by the next sync
+    if (json["version"].asInt().unwrapOr(0) != VERSION) {
+        return index;
+    }
+
+    std::vector<std::string> backups;
+    if (auto list = json["backups"].asArray()) {
+        for (auto& backup : *list) {
+            backups.push_back(backup.asString().unwrapOrDefault());
+        }
+    }
+    // Indexes from before times were saved get them from the next sync
+    std::vector<int64_t> times(backups.size());
+    if (auto list = json["times"].asArray()) {
+        for (size_t i = 0; i < list->size() && i < times.size(); i += 1) {
+            times[i] = (*list)[i].asInt().unwrapOr(0);
+        }
+    }
+    for (size_t i = 0; i < backups.size(); i += 1) {
+        index.m_backups.emplace(backups[i], times[i]);
+    }
+
+    if (auto levels = json["levels"].asArray()) {
+        for (auto& value : *levels) {
+            auto entry = Entry();
+            entry.level.name = value["name"].asString().unwrapOrDefault();
+            entry.level.id = static_cast<int>(value["id"].asInt().unwrapOr(0));
+            entry.level.version = static_cast<int>(value["version"].asInt().unwrapOr(0));
+            auto hash = value["hash"].asString().unwrapOrDefault();
+            std::from_chars(hash.data(), hash.data() + hash.size(), entry.level.hash, 16);
+            if (auto refs = value["backups"].asArray()) {
+                for (auto& ref : *refs) {
+                    auto i = ref.asInt().unwrapOr(-1);
+                    if (i >= 0 && static_cast<size_t>(i) < backups.size()) {
+                        entry.backups.push_back(backups[i]);
+                    }
+                }
+            }
+            if (!entry.backups.empty()) {
+                index.sortBackups(entry);
+                index.m_entries.push_back(std::move(entry));
+            }
+        }
+    }
+    index.rebuildLookups();
+    return index;
+}
+
+LevelIndex LevelIndex::sync(
+    Storage& storage, std::filesystem::path const& dir, std::vector<BackupEntry> const& backups,
+    std::function<bool()> const& isCancelled
+) {
+    std::vector<BackupEntry> missing;
+    {
+        std::lock_guard lock(LEVEL_INDEX_MUTEX);
+        auto index = load(storage, dir);
+        // Backups removed by something other than the mod. Checked on disk
+        // rather than against the given backups, since backups made after
+        // they were listed are already in the index
+        std::vector<std::string> gone;
+        for (auto& [folder, time] : index.m_backups) {
+            if (!core::isBackup(storage, dir / folder)) {
+                gone.push_back(folder);
+            }
+        }
+        for (auto& folder : gone) {
+            index.removeBackup(folder);
+        }
+        bool changed = !gone.empty();
+        for (auto& entry : backups) {
+            auto indexed = index.m_backups.find(entry.path.filename().string());
+            if (indexed == index.m_backups.end()) {
+                missing.push_back(entry);
+                continue;
+            }
+            auto time = std::chrono::duration_cast<std::chrono::seconds>(entry.meta.time.time_since_epoch()).count();
+            if (indexed->second != time) {
+                indexed->second = time;
+                changed = true;
+            }
+        }
+        if (changed) {
+            for (auto& entry : index.m_entries) {
+                index.sortBackups(entry);
+            }
+            auto res = index.save(storage, dir);
+            if (!res) {
+                log::warn("Unable to update level index: {}", res.unwrapErr());
+            }
+        }
+    }
+
+    if (!missing.empty()) {
+        log::info("Indexing levels in {} backups", missing.size());
+    }
+    // Levels are read without holding the lock so backups can still be
+    // made in the meantime
+    for (size_t i = 0; i < missing.size() && !(isCancelled && isCancelled()); i += SYNC_BATCH_SIZE) {
+        std::vector<std::pair<BackupEntry const*, std::vector<BackupLevel>>> batch;
+        for (size_t j = i; j < missing.size() && j < i + SYNC_BATCH_SIZE; j += 1) {
+            if (isCancelled && isCancelled()) {
+                break;
+            }
+            auto levels = core::computeLevels(storage, missing[j].path);
+            // Tried again on the next sync, since leaving it out of the 
+            // index is better than listing none of its levels
+            if (!levels) {
+                log::warn("Unable to index levels in {}: {}", missing[j].path.filename(), levels.unwrapErr());
+                continue;
+            }
+            batch.emplace_back(&missing[j], std::move(*levels));
+        }
+
+        std::lock_guard lock(LEVEL_INDEX_MUTEX);
+        auto index = load(storage, dir);
+        for (auto& [entry, levels] : batch) {
+            // Skip backups that were removed while their levels were read
+            if (core::isBackup(storage, entry->path)) {
+                index.addBackup(entry->path.filename().string(), entry->meta.time, levels);
+            }
+        }
+        auto res = index.save(storage, dir);
+        if (!res) {
+            log::warn("Unable to update level index: {}", res.unwrapErr());
+        }
+    }
+
+    std::lock_guard lock(LEVEL_INDEX_MUTEX);
+    return load(storage, dir);
+}
+
+void LevelIndex::add(
+    Storage& storage, std::filesystem::path const& dir, std::filesystem::path const& backup,
+    Time time, std::vector<BackupLevel> const& levels
+) {
+    std::lock_guard lock(LEVEL_INDEX_MUTEX);
+    // If there's no index yet, this starts one and sync fills in the rest
+    auto index = load(storage, dir);
+    index.addBackup(backup.filename().string(), time, levels);
+    auto res = index.save(storage, dir);
+    if (!res) {
+        log::warn("Unable to update level index: {}", res.unwrapErr());
+    }
+}
+void LevelIndex::remove(
+    Storage& storage, std::filesystem::path const& dir, std::vector<std::filesystem::path> const& backups
+) {
+    std::lock_guard lock(LEVEL_INDEX_MUTEX);
+    auto index = load(storage, dir);
+    bool changed = false;
+    for (auto& backup : backups) {
+        if (index.has(backup)) {
+            index.removeBackup(backup.filename().string());
+            changed = true;
+        }
+    }
+    if (!changed) {
+        return;
+    }
+    auto res = index.save(storage, dir);
+    if (!res) {
+        log::warn("Unable to update level index: {}", res.unwrapErr());
+    }
+}
+
+bool LevelIndex::has(std::filesystem::path const& backup) const {
+    return m_backups.contains(backup.filename().string());
+}
+size_t LevelIndex::getBackupCount() const {
+    return m_backups.size();
+}
+
+std::vector<LevelIndex::Entry const*> LevelIndex::search(std::string_view query) const {
+    while (!query.empty() && std::isspace(static_cast<unsigned char>(query.front()))) {
+        query.remove_prefix(1);
+    }
+    while (!query.empty() && std::isspace(static_cast<unsigned char>(query.back()))) {
+        query.remove_suffix(1);
+    }
+    if (query.empty()) {
+        return {};
+    }
+    if (query.starts_with('#')) {
+        uint64_t hash = 0;
+        auto [end, ec] = std::from_chars(query.data() + 1, query.data() + query.size(), hash, 16);
+        if (ec != std::errc() || end != query.data() + query.size()) {
+            return {};
+        }
+        return this->findByHash(hash);
+    }
+
+    std::vector<size_t> found;
+    int id = 0;
+    auto [end, ec] = std::from_chars(query.data(), query.data() + query.size(), id);
+    if (ec == std::errc() && end == query.data() + query.size()) {
+        if (auto byID = m_byID.find(id); byID != m_byID.end()) {
+            found.insert(found.end(), byID->second.begin(), byID->second.end());
+        }
+    }
+    auto lower = toLower(query);
+    for (auto& [name, indices] : m_byName) {
+        if (name.find(lower) != std::string::npos) {
+            found.insert(found.end(), indices.begin(), indices.end());
+        }
+    }
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+
+    std::vector<Entry const*> results;
+    results.reserve(found.size());
+    for (auto i : found) {
+        results.push_back(&m_entries[i]);
+    }
+    // Versions of the same level together, newest first
+    std::sort(results.begin(), results.end(), [this](Entry const* a, Entry const* b) {
+        if (a->level.name != b->level.name) {
+            return a->level.name < b->level.name;
+        }
+        return this->isNewer(a->backups.front(), b->backups.front());
+    });
+    return results;
+}
+std::vector<LevelIndex::Entry const*> LevelIndex::findByHash(uint64_t hash) const {
+    std::vector<Entry const*> results;
+    if (auto byHash = m_byHash.find(hash); byHash != m_byHash.end()) {
+        for (auto i : byHash->second) {
+            results.push_back(&m_entries[i]);
+        }
+    }
+    std::sort(results.begin(), results.end(), [this](Entry const* a, Entry const* b) {
+        return this->isNewer(a->backups.front(), b->backups.front());
+    });
+    return results;
+}
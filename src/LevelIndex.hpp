@@ -0,0 +1,77 @@
+#pragma once
+
+#include "BackupCore.hpp"
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Which backups have which levels, so finding an older version of a level
+// doesn't mean decompressing every backup. Levels are recorded as backups
+// are made and removed. Backups the index doesn't know about yet (imported
+// ones, or ones made by older versions of the mod) are added by sync, which
+// is the only part that ever decompresses anything. Kept in its own folder
+// so updating it doesn't make the backup index stale
+class LevelIndex final {
+public:
+	static constexpr std::string_view DIR_NAME = ".levels";
+	static constexpr int VERSION = 1;
+
+	// One version of a level along with every backup that has exactly it
+	struct Entry final {
+		BackupLevel level;
+		// Folder names, relative to the backups directory, newest first
+		std::vector<std::string> backups;
+	};
+
+private:
+	std::vector<Entry> m_entries;
+	// Every backup that's been indexed, including ones without any levels, 
+	// along with when it was made in seconds. 0 if that isn't known yet
+	std::unordered_map<std::string, int64_t> m_backups;
+	// Lowercase names, sorted so searches can go through every name quickly
+	std::map<std::string, std::vector<size_t>> m_byName;
+	std::unordered_map<int, std::vector<size_t>> m_byID;
+	std::unordered_map<uint64_t, std::vector<size_t>> m_byHash;
+
+	void addLookups(size_t index);
+	void rebuildLookups();
+	bool isNewer(std::string const& folder, std::string const& other) const;
+	void sortBackups(Entry& entry) const;
+	void addBackup(std::string const& folder, Time time, std::vector<BackupLevel> const& levels);
+	void removeBackup(std::string const& folder);
+	Result<> save(Storage& storage, std::filesystem::path const& dir) const;
+
+public:
+	// Empty if there's no index yet or it can't be read
+	static LevelIndex load(Storage const& storage, std::filesystem::path const& dir);
+	// Indexes every backup that's missing and forgets ones that are gone.
+	// Slow if many backups are missing. Stops early if `isCancelled` returns
+	// true, keeping what's been indexed so far
+	static LevelIndex sync(
+		Storage& storage, std::filesystem::path const& dir, std::vector<BackupEntry> const& backups,
+		std::function<bool()> const& isCancelled = nullptr
+	);
+
+	// These keep the index up to date as backups are made and removed. 
+	// Removing several backups at once only rewrites the index once
+	static void add(
+		Storage& storage, std::filesystem::path const& dir, std::filesystem::path const& backup,
+		Time time, std::vector<BackupLevel> const& levels
+	);
+	static void remove(
+		Storage& storage, std::filesystem::path const& dir, std::vector<std::filesystem::path> const& backups
+	);
+
+	bool has(std::filesystem::path const& backup) const;
+	size_t getBackupCount() const;
+	// Levels whose name contains the query, ignoring case, or whose online
+	// ID is the query. "#" followed by a hash finds the exact copies of a
+	// level no matter what they're called
+	std::vector<Entry const*> search(std::string_view query) const;
+	std::vector<Entry const*> findByHash(uint64_t hash) const;
+};
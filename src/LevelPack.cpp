@@ -0,0 +1,170 @@
+#include "LevelPack.hpp"
+#include "ParseCC.hpp"
+#include "Zstd.hpp"
+#include <matjson/std.hpp>
+#include <charconv>
+
+LevelPack::LevelPack(Storage& storage, std::filesystem::path const& dir, std::string_view name)
+  : m_storage(storage), m_dir(dir), m_name(name) {}
+
+std::filesystem::path LevelPack::getTablePath(std::filesystem::path const& dir, std::string_view name) {
+    auto path = dir / name;
+    path += TABLE_EXT;
+    return path;
+}
+std::filesystem::path LevelPack::getBlocksPath(std::filesystem::path const& dir, std::string_view name) {
+    auto path = dir / name;
+    path += BLOCKS_EXT;
+    return path;
+}
+
+Result<size_t> LevelPack::write(
+    Storage& storage, std::filesystem::path const& dir, std::string_view name, std::string_view data,
+    int level, std::string_view dict
+) {
+    std::vector<PackedLevel> levels;
+    std::vector<std::pair<size_t, size_t>> spans;
+    bool mismatch = false;
+    auto scanner = cc::LevelScanner([&](cc::ScannedLevel const& found) {
+        // The scanner puts the opening tag back together itself, so make sure 
+        // it's the same as what's actually in the save
+        if (data.substr(found.offset, found.data.size()) != found.data) {
+            mismatch = true;
+        }
+        spans.emplace_back(found.offset, found.data.size());
+        levels.push_back(PackedLevel { found.name, found.id, found.version, found.hash });
+    });
+    scanner.feed(data);
+    if (mismatch) {
+        return Err("levels couldn't be told apart from the rest of the save");
+    }
+
+    auto gaps = matjson::Value::array();
+    std::string gapData;
+    size_t pos = 0;
+    for (auto [offset, size] : spans) {
+        gaps.push(offset - pos);
+        gapData.append(data.substr(pos, offset - pos));
+        pos = offset + size;
+    }
+    gaps.push(data.size() - pos);
+    gapData.append(data.substr(pos));
+
+    GEODE_UNWRAP_INTO(auto blocks, zstd::compress(gapData, level, dict));
+    auto gapsSize = blocks.size();
+    auto table = matjson::Value::array();
+    for (size_t i = 0; i < levels.size(); i += 1) {
+        GEODE_UNWRAP_INTO(auto frame, zstd::compress(data.substr(spans[i].first, spans[i].second), level, dict));
+        table.push(matjson::makeObject({
+            { "name", levels[i].name },
+            { "id", levels[i].id },
+            { "version", levels[i].version },
+            // Not every 64-bit number fits in a JSON number
+            { "hash", fmt::format("{:016x}", levels[i].hash) },
+            { "offset", blocks.size() },
+            { "size", frame.size() },
+        }));
+        blocks += frame;
+    }
+    auto tableData = matjson::makeObject({
+        { "version", VERSION },
+        { "gaps", gaps },
+        { "gaps-size", gapsSize },
+        { "levels", table },
+    }).dump(matjson::NO_INDENTATION);
+
+    // The table is written last so a pack is never found without its blocks
+    GEODE_UNWRAP(storage.write(getBlocksPath(dir, name), blocks));
+    GEODE_UNWRAP(storage.write(getTablePath(dir, name), tableData));
+    return Ok(blocks.size() + tableData.size());
+}
+
+Result<LevelPack> LevelPack::open(Storage& storage, std::filesystem::path const& dir, std::string_view name) {
+    auto pack = LevelPack(storage, dir, name);
+    GEODE_UNWRAP_INTO(auto data, storage.read(getTablePath(dir, name)));
+    auto parsed = matjson::parse(data);
+    if (!parsed) {
+        return Err("Malformed level table for {}", name);
+    }
+    auto const& json = *parsed;
+    // Version 1 tables have everything but the IDs and versions
+    pack.m_version = static_cast<int>(json["version"].asInt().unwrapOr(0));
+    if (pack.m_version != 1 && pack.m_version != VERSION) {
+        return Err("Unsupported level table for {}", name);
+    }
+    pack.m_gapsSize = json["gaps-size"].asUInt().unwrapOr(0);
+    if (auto gaps = json["gaps"].asArray()) {
+        for (auto& gap : *gaps) {
+            pack.m_gaps.push_back(gap.asUInt().unwrapOr(0));
+        }
+    }
+    if (auto levels = json["levels"].asArray()) {
+        for (auto& value : *levels) {
+            auto level = PackedLevel();
+            level.name = value["name"].asString().unwrapOrDefault();
+            level.id = static_cast<int>(value["id"].asInt().unwrapOr(0));
+            level.version = static_cast<int>(value["version"].asInt().unwrapOr(0));
+            auto hash = value["hash"].asString().unwrapOrDefault();
+            std::from_chars(hash.data(), hash.data() + hash.size(), level.hash, 16);
+            level.offset = value["offset"].asUInt().unwrapOr(0);
+            level.size = value["size"].asUInt().unwrapOr(0);
+            pack.m_levels.push_back(std::move(level));
+        }
+    }
+    if (pack.m_gaps.size() != pack.m_levels.size() + 1) {
+        return Err("Malformed level table for {}", name);
+    }
+    return Ok(std::move(pack));
+}
+
+Result<std::string> LevelPack::decompress(std::string_view frame) const {
+    // Every block uses the same dictionary, so it's only loaded once
+    auto id = zstd::getDictID(frame);
+    if (id && id != m_dictID) {
+        GEODE_UNWRAP_INTO(m_dict, zstd::loadDictionary(m_storage, m_dir.parent_path(), id));
+        m_dictID = id;
+    }
+    return zstd::decompress(frame, id ? std::string_view(m_dict) : std::string_view());
+}
+
+std::vector<PackedLevel> const& LevelPack::getLevels() const {
+    return m_levels;
+}
+bool LevelPack::hasLevelInfo() const {
+    return m_version >= 2;
+}
+Result<std::string> LevelPack::readLevel(size_t index) const {
+    if (index >= m_levels.size()) {
+        return Err("No level {} in {}", index, m_name);
+    }
+    auto& level = m_levels[index];
+    GEODE_UNWRAP_INTO(auto frame, m_storage.readRange(getBlocksPath(m_dir, m_name), level.offset, level.size));
+    return this->decompress(frame);
+}
+
+Result<std::string> LevelPack::read() const {
+    // Everything is needed anyway, so read the whole file at once
+    GEODE_UNWRAP_INTO(auto blocks, m_storage.read(getBlocksPath(m_dir, m_name)));
+    auto block = [&](size_t offset, size_t size) -> Result<std::string> {
+        if (offset > blocks.size() || size > blocks.size() - offset) {
+            return Err("{} is truncated", getBlocksPath(m_dir, m_name).filename());
+        }
+        return this->decompress(std::string_view(blocks).substr(offset, size));
+    };
+
+    GEODE_UNWRAP_INTO(auto gapData, block(0, m_gapsSize));
+    std::string data;
+    size_t pos = 0;
+    for (size_t i = 0; i <= m_levels.size(); i += 1) {
+        if (pos + m_gaps[i] > gapData.size()) {
+            return Err("Level table for {} doesn't match its blocks", m_name);
+        }
+        data.append(gapData, pos, m_gaps[i]);
+        pos += m_gaps[i];
+        if (i < m_levels.size()) {
+            GEODE_UNWRAP_INTO(auto level, block(m_levels[i].offset, m_levels[i].size));
+            data += level;
+        }
+    }
+    return Ok(std::move(data));
+}
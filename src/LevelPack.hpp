@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Platform.hpp"
+#include "Storage.hpp"
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace geode::prelude;
+
+struct PackedLevel final {
+	std::string name;
+	// Online ID, 0 if the level was never uploaded
+	int id = 0;
+	// Version shown in the editor
+	int version = 0;
+	// Hash of the level string, the same one the level index uses
+	uint64_t hash = 0;
+	// Where the level's block is in the blocks file
+	size_t offset = 0;
+	size_t size = 0;
+};
+
+// CCLocalLevels.dat stored with every level as its own zstd frame, along 
+// with a table of where each one is. Reading a single level only reads and 
+// decompresses that level, while the whole save can still be put back 
+// together exactly as it was. Everything between the levels is stored 
+// together in one more frame at the start
+class LevelPack final {
+private:
+	Storage& m_storage;
+	std::filesystem::path m_dir;
+	std::string m_name;
+	// Sizes of the pieces of the save around the levels, one more than there 
+	// are levels
+	std::vector<size_t> m_gaps;
+	size_t m_gapsSize = 0;
+	std::vector<PackedLevel> m_levels;
+	int m_version = VERSION;
+	mutable uint32_t m_dictID = 0;
+	mutable std::string m_dict;
+
+	LevelPack(Storage& storage, std::filesystem::path const& dir, std::string_view name);
+
+	Result<std::string> decompress(std::string_view frame) const;
+
+public:
+	static constexpr std::string_view TABLE_EXT = ".levels";
+	static constexpr std::string_view BLOCKS_EXT = ".blocks";
+	// 2 = levels have their online ID and version
+	static constexpr int VERSION = 2;
+
+	static std::filesystem::path getTablePath(std::filesystem::path const& dir, std::string_view name);
+	static std::filesystem::path getBlocksPath(std::filesystem::path const& dir, std::string_view name);
+
+	// Store decompressed save data in a backup. Returns the amount of bytes 
+	// written
+	static Result<size_t> write(
+		Storage& storage, std::filesystem::path const& dir, std::string_view name, std::string_view data,
+		int level, std::string_view dict = {}
+	);
+	// Only reads the table
+	static Result<LevelPack> open(Storage& storage, std::filesystem::path const& dir, std::string_view name);
+
+	// In the same order as in the save
+	std::vector<PackedLevel> const& getLevels() const;
+	// Older tables don't have the levels' IDs and versions
+	bool hasLevelInfo() const;
+	// The level's <d> element, exactly as it was in the save
+	Result<std::string> readLevel(size_t index) const;
+	// Rebuild the whole decompressed save data
+	Result<std::string> read() const;
+};
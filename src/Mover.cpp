@@ -0,0 +1,140 @@
+#include "Mover.hpp"
+#include "Hash.hpp"
+#include <fstream>
+#include <future>
+#include <vector>
+
+// Large enough that a slow drive spends its time transferring rather than 
+// seeking, small enough that a few moves at once don't use much memory
+static constexpr size_t BLOCK_SIZE = 4 * 1024 * 1024;
+
+bool mover::isCrossDevice(std::error_code const& ec) {
+    return ec == std::errc::cross_device_link
+#ifdef GEODE_IS_WINDOWS
+        // MoveFileEx reports ERROR_NOT_SAME_DEVICE
+        || (ec.category() == std::system_category() && ec.value() == 17)
+#endif
+    ;
+}
+
+std::filesystem::path mover::getStagingPath(
+    std::filesystem::path const& backupsDir, std::filesystem::path const& from
+) {
+    auto source = from.string();
+    return backupsDir / STAGING_DIR / fmt::format("{:016x}", xxh::xxh64(source.data(), source.size()));
+}
+
+static size_t readBlock(std::ifstream& file, std::vector<char>& buffer) {
+    file.read(buffer.data(), buffer.size());
+    return static_cast<size_t>(file.gcount());
+}
+
+// Checksum of a file, hashed a block at a time with each block's hash as 
+// the next one's seed
+static Result<uint64_t> checksumFile(std::filesystem::path const& path, std::vector<char>& buffer) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return Err("Unable to open {}", path.filename());
+    }
+    uint64_t hash = 0;
+    while (auto n = readBlock(file, buffer)) {
+        hash = xxh::xxh64(buffer.data(), n, hash);
+    }
+    if (file.bad()) {
+        return Err("Unable to read {}", path.filename());
+    }
+    return Ok(hash);
+}
+
+// Returns the checksum of what was read from the source
+static Result<uint64_t> copyFile(
+    std::filesystem::path const& from, std::filesystem::path const& to,
+    std::vector<char>& current, std::vector<char>& next, mover::ProgressCallback const& onProgress
+) {
+    std::ifstream in(from, std::ios::binary);
+    if (!in) {
+        return Err("Unable to open {}", from.filename());
+    }
+    std::ofstream out(to, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return Err("Unable to create {}", to.filename());
+    }
+
+    // The next block is read while the current one is hashed and written, 
+    // so both drives are kept busy
+    uint64_t hash = 0;
+    auto n = readBlock(in, current);
+    while (n > 0) {
+        auto reading = std::async(std::launch::async, readBlock, std::ref(in), std::ref(next));
+        hash = xxh::xxh64(current.data(), n, hash);
+        out.write(current.data(), n);
+        if (onProgress) {
+            onProgress(n);
+        }
+        n = reading.get();
+        std::swap(current, next);
+    }
+    if (in.bad()) {
+        return Err("Unable to read {}", from.filename());
+    }
+    out.close();
+    if (!out) {
+        return Err("Unable to write {}", to.filename());
+    }
+    return Ok(hash);
+}
+
+Result<mover::Stats> mover::copyVerified(
+    std::filesystem::path const& from, std::filesystem::path const& to,
+    ProgressCallback const& onProgress
+) {
+    auto stats = Stats();
+    std::vector<char> current(BLOCK_SIZE);
+    std::vector<char> next(BLOCK_SIZE);
+
+    std::error_code ec;
+    std::filesystem::create_directories(to, ec);
+    if (ec) {
+        return Err("Unable to create {}: {} (code {})", to, ec.message(), ec.value());
+    }
+    std::error_code iterEc;
+    auto it = std::filesystem::recursive_directory_iterator(from, iterEc);
+    for (; !iterEc && it != std::filesystem::recursive_directory_iterator(); it.increment(iterEc)) {
+        auto& entry = *it;
+        auto target = to / std::filesystem::relative(entry.path(), from);
+        if (entry.is_directory(ec)) {
+            std::filesystem::create_directories(target, ec);
+            continue;
+        }
+        if (!entry.is_regular_file(ec)) {
+            continue;
+        }
+        auto size = entry.file_size(ec);
+        stats.files += 1;
+        stats.bytes += size;
+
+        // Left over from an interrupted move
+        if (std::filesystem::exists(target, ec) && std::filesystem::file_size(target, ec) == size) {
+            GEODE_UNWRAP_INTO(auto source, checksumFile(entry.path(), current));
+            GEODE_UNWRAP_INTO(auto copied, checksumFile(target, current));
+            if (source == copied) {
+                stats.resumed += 1;
+                if (onProgress) {
+                    onProgress(size);
+                }
+                continue;
+            }
+        }
+
+        GEODE_UNWRAP_INTO(auto source, copyFile(entry.path(), target, current, next, onProgress));
+        GEODE_UNWRAP_INTO(auto copied, checksumFile(target, current));
+        if (source != copied) {
+            std::filesystem::remove(target, ec);
+            return Err("{} was corrupted while copying", entry.path().filename());
+        }
+    }
+    if (iterEc) {
+        return Err("Unable to read {}: {} (code {})", from, iterEc.message(), iterEc.value());
+    }
+    return Ok(stats);
+}
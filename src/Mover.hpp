@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Platform.hpp"
+#include <filesystem>
+#include <functional>
+#include <string_view>
+
+using namespace geode::prelude;
+
+namespace mover {
+    // Backups being copied over from another drive are put here until 
+    // they've been fully copied, so a half-copied backup never shows up in 
+    // the list
+    constexpr std::string_view STAGING_DIR = ".moving";
+
+    struct Stats final {
+        size_t files = 0;
+        size_t bytes = 0;
+        // Files that were already copied by an earlier, interrupted move
+        size_t resumed = 0;
+    };
+
+    // Called with the amount of bytes copied since the last call
+    using ProgressCallback = std::function<void(size_t)>;
+
+    bool isCrossDevice(std::error_code const& ec);
+
+    // Where a move of the given folder into the given backups directory is 
+    // staged. Always the same for the same folder, so interrupted moves 
+    // pick up where they left off
+    std::filesystem::path getStagingPath(
+        std::filesystem::path const& backupsDir, std::filesystem::path const& from
+    );
+
+    // Copy a folder (to a different drive) and check every file was copied 
+    // correctly by reading it back and comparing checksums. Files already 
+    // present with the same contents are skipped. The source is left as-is
+    Result<Stats> copyVerified(
+        std::filesystem::path const& from, std::filesystem::path const& to,
+        ProgressCallback const& onProgress = nullptr
+    );
+}
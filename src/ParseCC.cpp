@@ -1,30 +1,573 @@
 #include "ParseCC.hpp"
-#include <Geode/utils/file.hpp>
-#include <Geode/utils/cocos.hpp>
-#include <cppcodec/base64_url.hpp>
-#include <arc/task/Yield.hpp>
+#include "SaveDecode.hpp"
+#include <cctype>
+#include <charconv>
+#include <zlib-ng.h>
 
 using namespace geode::prelude;
 
-Result<std::string> cc::parseCompressedCCFile(std::filesystem::path const& path) {
-    auto readRes = file::readBinary(path);
-    if (!readRes) {
-        return Err("Unable to read file: {}", readRes.unwrapErr());
-    }
-    auto data = *readRes;
-    return Ok(ZipUtils::decompressString2(data.data(), true, data.size(), 11));
-
-    // auto readRes = file::readBinary(path);
-    // if (!readRes) {
-    //     return Err("Unable to read file: {}", readRes.unwrapErr());
-    // }
-    // auto data = *readRes;
-
-    // // XOR with key 11
-    // for (auto& c : data) {
-    //     c ^= 11;
-    // }
-    // // URL-safe base64 decode
-    // data = cppcodec::base64_url::decode(reinterpret_cast<char*>(data.data()), data.size());
-    // // ZipUtils::ccDeflateMemory();
+// Multiple of 4 so base64 groups never get split between blocks
+static constexpr size_t READ_BLOCK_SIZE = 1024 * 1024;
+static constexpr size_t INFLATE_BLOCK_SIZE = 256 * 1024;
+
+class InflateStream final {
+private:
+    zng_stream m_stream {};
+    bool m_valid = false;
+
+public:
+    InflateStream() {
+        // Detects both gzip and zlib headers
+        m_valid = zng_inflateInit2(&m_stream, 15 + 32) == Z_OK;
+    }
+    InflateStream(InflateStream const&) = delete;
+    ~InflateStream() {
+        if (m_valid) {
+            zng_inflateEnd(&m_stream);
+        }
+    }
+    bool isValid() const {
+        return m_valid;
+    }
+    zng_stream* operator->() {
+        return &m_stream;
+    }
+    zng_stream* get() {
+        return &m_stream;
+    }
+};
+
+// Inflate a block of input, passing on the output as it's produced. Returns 
+// true once the end of the stream has been reached
+static Result<bool> inflateBlock(
+    InflateStream& stream, uint8_t const* data, size_t size, std::vector<uint8_t>& output,
+    cc::DataCallback const& onData, bool& delivered
+) {
+    stream->next_in = data;
+    stream->avail_in = static_cast<uint32_t>(size);
+    do {
+        stream->next_out = output.data();
+        stream->avail_out = static_cast<uint32_t>(output.size());
+        auto res = zng_inflate(stream.get(), Z_NO_FLUSH);
+        if (res != Z_OK && res != Z_STREAM_END && res != Z_BUF_ERROR) {
+            return Err("Unable to inflate: {}", stream->msg ? stream->msg : "unknown error");
+        }
+        auto produced = output.size() - stream->avail_out;
+        if (produced) {
+            delivered = true;
+            onData(std::string_view(reinterpret_cast<char*>(output.data()), produced));
+        }
+        if (res == Z_STREAM_END) {
+            return Ok(true);
+        }
+    } while (stream->avail_in > 0 || stream->avail_out == 0);
+    return Ok(false);
+}
+
+// XOR, base64 and inflate one block at a time. `delivered` is set once any 
+// data has been passed on, after which falling back to another way of 
+// decoding the file would pass on the same data twice
+static Result<> streamDecoded(
+    Storage const& storage, std::filesystem::path const& path, cc::DataCallback const& onData, bool& delivered,
+    std::function<bool()> const& isCancelled = nullptr
+) {
+    GEODE_UNWRAP_INTO(auto file, storage.open(path));
+    auto stream = InflateStream();
+    if (!stream.isValid()) {
+        return Err("Unable to start inflating");
+    }
+
+    std::vector<uint8_t> input(READ_BLOCK_SIZE);
+    std::vector<uint8_t> output(INFLATE_BLOCK_SIZE);
+    bool finished = false;
+    while (!finished) {
+        if (isCancelled && isCancelled()) {
+            return Err("Cancelled");
+        }
+        auto read = file->read(input.data(), input.size());
+        if (read == 0) {
+            break;
+        }
+        GEODE_UNWRAP_INTO(auto decoded, cc::decodeXorBase64(input.data(), read, input.data(), 11));
+        GEODE_UNWRAP_INTO(finished, inflateBlock(stream, input.data(), decoded, output, onData, delivered));
+    }
+    if (!finished) {
+        return Err("File is truncated");
+    }
+    return Ok();
+}
+
+// For files that aren't in the usual format
+static std::string decodeWithGame(Storage const& storage, std::filesystem::path const& path) {
+#ifdef BACKUPS_HEADLESS
+    // Only the game knows how to read these
+    return std::string();
+#else
+    auto data = storage.read(path).unwrapOrDefault();
+    return ZipUtils::decompressString2(reinterpret_cast<uint8_t*>(data.data()), true, data.size(), 11);
+#endif
+}
+
+Result<> cc::streamCompressedCCFile(
+    Storage const& storage, std::filesystem::path const& path, DataCallback const& onData,
+    std::function<bool()> const& isCancelled
+) {
+    bool delivered = false;
+    auto res = streamDecoded(storage, path, onData, delivered, isCancelled);
+    if (res) {
+        return Ok();
+    }
+    if (isCancelled && isCancelled()) {
+        return res;
+    }
+    if (delivered) {
+        return Err("Save file is corrupted: {}", res.unwrapErr());
+    }
+    if (!storage.exists(path)) {
+        return Err("Unable to read file: {}", res.unwrapErr());
+    }
+    // The game's decoder needs the whole file at once, but this is rare
+    auto data = decodeWithGame(storage, path);
+    if (data.empty()) {
+        return Err("Unable to decode save file: {}", res.unwrapErr());
+    }
+    onData(data);
+    return Ok();
+}
+
+Result<std::string> cc::parseCompressedCCFile(Storage const& storage, std::filesystem::path const& path) {
+    std::string result;
+    bool delivered = false;
+    auto res = streamDecoded(storage, path, [&](std::string_view data) {
+        result.append(data);
+    }, delivered);
+    if (res) {
+        return Ok(std::move(result));
+    }
+    if (delivered) {
+        return Err("Save file is corrupted: {}", res.unwrapErr());
+    }
+    if (!storage.exists(path)) {
+        return Err("Unable to read file: {}", res.unwrapErr());
+    }
+    return Ok(decodeWithGame(storage, path));
+}
+
+#ifdef BACKUPS_HEADLESS
+
+static constexpr std::string_view BASE64_URL = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+std::string cc::compressString(std::string_view data, uint8_t key) {
+    zng_stream stream {};
+    // Gzip header, same as the game
+    if (zng_deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return std::string();
+    }
+    std::vector<uint8_t> deflated(zng_deflateBound(&stream, data.size()));
+    stream.next_in = reinterpret_cast<uint8_t const*>(data.data());
+    stream.avail_in = static_cast<uint32_t>(data.size());
+    stream.next_out = deflated.data();
+    stream.avail_out = static_cast<uint32_t>(deflated.size());
+    auto res = zng_deflate(&stream, Z_FINISH);
+    auto size = static_cast<size_t>(stream.total_out);
+    zng_deflateEnd(&stream);
+    if (res != Z_STREAM_END) {
+        return std::string();
+    }
+
+    std::string encoded;
+    encoded.reserve((size + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 3 <= size; i += 3) {
+        uint32_t bits = deflated[i] << 16 | deflated[i + 1] << 8 | deflated[i + 2];
+        encoded += BASE64_URL[bits >> 18];
+        encoded += BASE64_URL[(bits >> 12) & 63];
+        encoded += BASE64_URL[(bits >> 6) & 63];
+        encoded += BASE64_URL[bits & 63];
+    }
+    if (i < size) {
+        uint32_t bits = deflated[i] << 16 | (i + 1 < size ? deflated[i + 1] << 8 : 0);
+        encoded += BASE64_URL[bits >> 18];
+        encoded += BASE64_URL[(bits >> 12) & 63];
+        encoded += i + 1 < size ? BASE64_URL[(bits >> 6) & 63] : '=';
+        encoded += '=';
+    }
+    if (key) {
+        for (auto& c : encoded) {
+            c ^= key;
+        }
+    }
+    return encoded;
+}
+
+std::string cc::decompressString(std::string_view data, uint8_t key) {
+    std::vector<uint8_t> input(data.begin(), data.end());
+    auto decoded = cc::decodeXorBase64(input.data(), input.size(), input.data(), key);
+    if (!decoded) {
+        return std::string();
+    }
+    auto stream = InflateStream();
+    if (!stream.isValid()) {
+        return std::string();
+    }
+    std::string result;
+    std::vector<uint8_t> output(INFLATE_BLOCK_SIZE);
+    bool delivered = false;
+    auto finished = inflateBlock(stream, input.data(), *decoded, output, [&](std::string_view data) {
+        result.append(data);
+    }, delivered);
+    if (!finished || !*finished) {
+        return std::string();
+    }
+    return result;
+}
+
+#else
+
+std::string cc::compressString(std::string_view data, uint8_t key) {
+    return ZipUtils::compressString(std::string(data), key != 0, key);
+}
+std::string cc::decompressString(std::string_view data, uint8_t key) {
+    return ZipUtils::decompressString(std::string(data), key != 0, key);
+}
+
+#endif
+
+// Longer keys and values aren't something the handlers ever care about, so
+// capping them keeps a corrupted file from making us buffer everything
+static constexpr size_t MAX_TEXT_SIZE = 4096;
+static constexpr size_t MAX_TAG_SIZE = 32;
+
+static std::string_view trim(std::string_view str) {
+    while (!str.empty() && std::isspace(static_cast<unsigned char>(str.front()))) {
+        str.remove_prefix(1);
+    }
+    while (!str.empty() && std::isspace(static_cast<unsigned char>(str.back()))) {
+        str.remove_suffix(1);
+    }
+    return str;
+}
+
+static void decodeEntities(std::string& text) {
+    if (text.find('&') == std::string::npos) {
+        return;
+    }
+    static constexpr std::pair<std::string_view, char> ENTITIES[] = {
+        { "&amp;", '&' }, { "&lt;", '<' }, { "&gt;", '>' }, { "&quot;", '"' }, { "&apos;", '\'' },
+    };
+    std::string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i += 1) {
+        bool replaced = false;
+        if (text[i] == '&') {
+            for (auto [entity, c] : ENTITIES) {
+                if (std::string_view(text).substr(i, entity.size()) == entity) {
+                    out += c;
+                    i += entity.size() - 1;
+                    replaced = true;
+                    break;
+                }
+            }
+        }
+        if (!replaced) {
+            out += text[i];
+        }
+    }
+    text = std::move(out);
+}
+
+cc::PlistReader::PlistReader(PlistHandler& handler) : m_handler(handler) {}
+
+size_t cc::PlistReader::getDepth() const {
+    return m_path.size();
+}
+
+void cc::PlistReader::feed(std::string_view data) {
+    while (!data.empty()) {
+        if (m_inTag) {
+            auto end = data.find('>');
+            auto part = data.substr(0, end);
+            if (m_tag.size() < MAX_TAG_SIZE) {
+                m_tag.append(part.substr(0, MAX_TAG_SIZE - m_tag.size()));
+            }
+            if (end == std::string_view::npos) {
+                return;
+            }
+            data.remove_prefix(end + 1);
+            m_inTag = false;
+            this->onTag();
+            m_tag.clear();
+        }
+        else {
+            auto end = data.find('<');
+            if (m_textMode == Text::Key || m_textMode == Text::Value) {
+                auto part = data.substr(0, end);
+                if (m_text.size() < MAX_TEXT_SIZE) {
+                    m_text.append(part.substr(0, MAX_TEXT_SIZE - m_text.size()));
+                }
+            }
+            else if (m_textMode == Text::StreamValue && end != 0) {
+                m_handler.onValueData(data.substr(0, end));
+            }
+            if (end == std::string_view::npos) {
+                return;
+            }
+            data.remove_prefix(end + 1);
+            m_inTag = true;
+        }
+    }
+}
+
+void cc::PlistReader::emitValue(char type, std::string_view value) {
+    if (m_wantValue) {
+        m_handler.onValue(m_path, m_key, type, value);
+    }
+    m_wantValue = false;
+}
+
+void cc::PlistReader::onTag() {
+    auto tag = trim(m_tag);
+    bool selfClosing = !tag.empty() && tag.back() == '/';
+    if (selfClosing) {
+        tag = trim(tag.substr(0, tag.size() - 1));
+    }
+    bool closing = !tag.empty() && tag.front() == '/';
+    if (closing) {
+        tag.remove_prefix(1);
+    }
+    auto name = tag.substr(0, tag.find_first_of(" \t\r\n"));
+
+    if (name == "d" || name == "dict") {
+        if (closing) {
+            if (!m_path.empty()) {
+                m_path.pop_back();
+            }
+        }
+        else if (!selfClosing) {
+            m_path.push_back(m_key);
+        }
+        m_key.clear();
+        m_wantValue = false;
+        m_streamValue = false;
+        return;
+    }
+    if (name == "k") {
+        if (closing) {
+            m_key = trim(m_text);
+            m_wantValue = m_handler.onKey(m_path, m_key);
+            m_streamValue = !m_wantValue && m_handler.onStreamKey(m_path, m_key);
+            m_textMode = Text::None;
+        }
+        else {
+            m_text.clear();
+            m_textMode = Text::Key;
+        }
+        return;
+    }
+    // Values: <s> string, <i> integer, <r> real, <t /> true
+    if (name == "s" || name == "i" || name == "r" || name == "t") {
+        if (selfClosing) {
+            this->emitValue(name.front(), "");
+            if (m_streamValue) {
+                m_handler.onValueEnd();
+            }
+            m_streamValue = false;
+        }
+        else if (closing) {
+            if (m_textMode == Text::Value) {
+                decodeEntities(m_text);
+                this->emitValue(name.front(), m_text);
+            }
+            else if (m_textMode == Text::StreamValue) {
+                m_handler.onValueEnd();
+            }
+            m_wantValue = false;
+            m_streamValue = false;
+            m_textMode = Text::None;
+        }
+        else {
+            m_text.clear();
+            m_textMode = 
+                m_wantValue ? Text::Value :
+                m_streamValue ? Text::StreamValue :
+                Text::SkipValue;
+        }
+    }
+}
+
+cc::LevelScanner::LevelScanner(std::function<void(ScannedLevel const&)> onLevel) : m_onLevel(std::move(onLevel)) {}
+
+void cc::LevelScanner::feed(std::string_view data) {
+    while (!data.empty()) {
+        if (m_inTag) {
+            auto end = data.find('>');
+            auto part = data.substr(0, end);
+            if (m_tag.size() < MAX_TAG_SIZE) {
+                m_tag.append(part.substr(0, MAX_TAG_SIZE - m_tag.size()));
+            }
+            if (m_inLevel) {
+                m_level.append(part);
+            }
+            if (end == std::string_view::npos) {
+                m_offset += data.size();
+                return;
+            }
+            if (m_inLevel) {
+                m_level += '>';
+            }
+            data.remove_prefix(end + 1);
+            m_offset += end + 1;
+            m_inTag = false;
+            this->onTag();
+            m_tag.clear();
+        }
+        else {
+            auto end = data.find('<');
+            auto part = data.substr(0, end);
+            if (m_inText && m_text.size() < MAX_TEXT_SIZE) {
+                m_text.append(part.substr(0, MAX_TEXT_SIZE - m_text.size()));
+            }
+            if (m_inLevelString) {
+                m_hasher.update(part);
+            }
+            if (m_inLevel) {
+                m_level.append(part);
+            }
+            if (end == std::string_view::npos) {
+                m_offset += data.size();
+                return;
+            }
+            if (m_inLevel) {
+                m_level += '<';
+            }
+            m_tagStart = m_offset + end;
+            data.remove_prefix(end + 1);
+            m_offset += end + 1;
+            m_inTag = true;
+        }
+    }
+}
+
+void cc::LevelScanner::onTag() {
+    auto tag = trim(m_tag);
+    bool selfClosing = !tag.empty() && tag.back() == '/';
+    if (selfClosing) {
+        tag = trim(tag.substr(0, tag.size() - 1));
+    }
+    bool closing = !tag.empty() && tag.front() == '/';
+    if (closing) {
+        tag.remove_prefix(1);
+    }
+    auto name = tag.substr(0, tag.find_first_of(" \t\r\n"));
+
+    if (name == "k") {
+        if (closing) {
+            m_inText = false;
+            auto key = trim(m_text);
+            m_next = Next::Other;
+            // Only the level's own keys, not ones in dictionaries inside it
+            if (m_inLevel && m_depth == m_listDepth + 1) {
+                if (key == "k2") {
+                    m_next = Next::Name;
+                }
+                else if (key == "k1") {
+                    m_next = Next::ID;
+                }
+                else if (key == "k16") {
+                    m_next = Next::Version;
+                }
+                else if (key == "k4") {
+                    m_next = Next::LevelString;
+                }
+            }
+            if (!m_listDepth && key == "LLM_01") {
+                m_listDepth = m_depth + 1;
+            }
+        }
+        else if (!selfClosing) {
+            m_text.clear();
+            m_inText = true;
+        }
+        return;
+    }
+    if (name == "d" || name == "dict") {
+        m_next = Next::Other;
+        if (selfClosing) {
+            return;
+        }
+        if (closing) {
+            if (m_inLevel && m_depth == m_listDepth + 1) {
+                m_inLevel = false;
+                m_current.data = m_level;
+                m_onLevel(m_current);
+                m_level.clear();
+            }
+            else if (m_depth == m_listDepth) {
+                m_listDepth = 0;
+            }
+            if (m_depth) {
+                m_depth -= 1;
+            }
+            return;
+        }
+        m_depth += 1;
+        if (m_listDepth && !m_inLevel && m_depth == m_listDepth + 1) {
+            m_inLevel = true;
+            // Levels without a level string hash to 0 in the level index too
+            m_current = ScannedLevel();
+            m_current.offset = m_tagStart;
+            m_level = fmt::format("<{}>", m_tag);
+        }
+        return;
+    }
+    if (name == "s" && m_next == Next::Name) {
+        if (selfClosing || closing) {
+            m_inText = false;
+            m_current.name = selfClosing ? "" : m_text;
+            decodeEntities(m_current.name);
+            m_next = Next::Other;
+        }
+        else {
+            m_text.clear();
+            m_inText = true;
+        }
+        return;
+    }
+    if (name == "i" && (m_next == Next::ID || m_next == Next::Version)) {
+        if (selfClosing || closing) {
+            m_inText = false;
+            int value = 0;
+            if (!selfClosing) {
+                auto text = trim(m_text);
+                std::from_chars(text.data(), text.data() + text.size(), value);
+            }
+            (m_next == Next::ID ? m_current.id : m_current.version) = value;
+            m_next = Next::Other;
+        }
+        else {
+            m_text.clear();
+            m_inText = true;
+        }
+        return;
+    }
+    if (name == "s" && m_next == Next::LevelString) {
+        if (selfClosing) {
+            m_current.hash = xxh::Hasher().digest();
+            m_next = Next::Other;
+        }
+        else if (closing) {
+            m_current.hash = m_hasher.digest();
+            m_inLevelString = false;
+            m_next = Next::Other;
+        }
+        else {
+            m_hasher = xxh::Hasher();
+            m_inLevelString = true;
+        }
+        return;
+    }
+    // Any other value means the key wasn't one we care about after all
+    if (!closing) {
+        m_next = Next::Other;
+    }
 }
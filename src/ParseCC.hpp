@@ -2,11 +2,146 @@
 
 #include <string>
 #include <filesystem>
-#include <Geode/utils/cocos.hpp>
-#include <Geode/utils/async.hpp>
+#include <functional>
+#include <span>
+#include "Hash.hpp"
+#include "Platform.hpp"
+#include "Storage.hpp"
 
 using namespace geode::prelude;
 
 namespace cc {
-    Result<std::string> parseCompressedCCFile(std::filesystem::path const& path);
+    Result<std::string> parseCompressedCCFile(Storage const& storage, std::filesystem::path const& path);
+
+    // Called with consecutive pieces of decompressed save data
+    using DataCallback = std::function<void(std::string_view)>;
+    // Decompresses a save file block by block, so memory use stays the same 
+    // no matter how big the save is. Stops between blocks if `isCancelled` 
+    // returns true
+    Result<> streamCompressedCCFile(
+        Storage const& storage, std::filesystem::path const& path, DataCallback const& onData,
+        std::function<bool()> const& isCancelled = nullptr
+    );
+
+    // Gzip and URL-safe base64, then XOR with the key unless it's 0. With a 
+    // key of 11 this is how the game saves its files
+    std::string compressString(std::string_view data, uint8_t key);
+    // Empty if the data can't be decoded
+    std::string decompressString(std::string_view data, uint8_t key);
+
+    // Path of dictionary keys leading to the current dictionary
+    using PlistPath = std::span<std::string const>;
+
+    class PlistHandler {
+    public:
+        virtual ~PlistHandler() = default;
+
+        // Return true to have the value of this key passed to onValue. Values
+        // that aren't asked for are skipped without being copied
+        virtual bool onKey(PlistPath path, std::string_view key) = 0;
+        // Type is the tag name of the value, i.e. 's', 'i', 'r' or 't'
+        virtual void onValue(PlistPath path, std::string_view key, char type, std::string_view value) = 0;
+
+        // For values too big to be buffered, like level strings. Asked about 
+        // keys onKey didn't want; return true to have the value's raw text 
+        // (entities and all) passed to onValueData a piece at a time
+        virtual bool onStreamKey(PlistPath path, std::string_view key) {
+            return false;
+        }
+        virtual void onValueData(std::string_view data) {}
+        // Called once a streamed value is over, even if it was empty
+        virtual void onValueEnd() {}
+    };
+
+    // Single-pass reader for the plist-style XML GD uses in its save files
+    // (<k>key</k><s>value</s>, <d> for nested dictionaries). Data can be fed
+    // in pieces of any size, and memory use stays fixed no matter how large
+    // the save is
+    class PlistReader final {
+    private:
+        enum class Text {
+            None,
+            Key,
+            Value,
+            StreamValue,
+            SkipValue,
+        };
+
+        PlistHandler& m_handler;
+        std::vector<std::string> m_path;
+        std::string m_key;
+        std::string m_text;
+        std::string m_tag;
+        Text m_textMode = Text::None;
+        bool m_inTag = false;
+        bool m_wantValue = false;
+        bool m_streamValue = false;
+
+        void onTag();
+        void emitValue(char type, std::string_view value);
+
+    public:
+        PlistReader(PlistHandler& handler);
+
+        void feed(std::string_view data);
+        size_t getDepth() const;
+    };
+
+    // A level found by LevelScanner
+    struct ScannedLevel final {
+        // Where the level's <d> element starts in the data
+        size_t offset = 0;
+        // The whole <d> element, exactly as it's stored
+        std::string_view data;
+        std::string name;
+        // Online ID, 0 if the level was never uploaded
+        int id = 0;
+        // Version shown in the editor
+        int version = 0;
+        // Hash of the level string, the same one the level index uses
+        uint64_t hash = 0;
+    };
+
+    // Finds the levels in decompressed CCLocalLevels.dat data fed a piece at 
+    // a time. Only tags are looked at to find where each level starts and 
+    // ends, so the rest of the save isn't parsed, and levels are handed out 
+    // exactly as they're stored
+    class LevelScanner final {
+    private:
+        enum class Next {
+            Other,
+            Name,
+            ID,
+            Version,
+            LevelString,
+        };
+
+        std::function<void(ScannedLevel const&)> m_onLevel;
+        // How much data has been fed in total
+        size_t m_offset = 0;
+        size_t m_tagStart = 0;
+        std::string m_tag;
+        // The key or level name being read
+        std::string m_text;
+        bool m_inTag = false;
+        bool m_inText = false;
+        size_t m_depth = 0;
+        // Depth inside LLM_01, where every dictionary is a level. 0 outside 
+        // of it
+        size_t m_listDepth = 0;
+        bool m_inLevel = false;
+        std::string m_level;
+        ScannedLevel m_current;
+        // What the value after the last key is, if it's one we care about
+        Next m_next = Next::Other;
+        bool m_inLevelString = false;
+        xxh::Hasher m_hasher;
+
+        void onTag();
+
+    public:
+        LevelScanner(std::function<void(ScannedLevel const&)> onLevel);
+
+        void feed(std::string_view data);
+    };
 }
@@ -0,0 +1,15 @@
+#pragma once
+
+// The backup core is also built without the game for the command line tool 
+// (see cli/), in which case BACKUPS_HEADLESS is defined and the parts of 
+// Geode it uses come from cli/Geode.hpp instead. Core files include this 
+// rather than Geode directly
+#ifdef BACKUPS_HEADLESS
+    #include "../cli/Geode.hpp"
+#else
+    #include <Geode/DefaultInclude.hpp>
+    #include <Geode/utils/file.hpp>
+    #include <Geode/utils/JsonValidation.hpp>
+#endif
+
+using namespace geode::prelude;
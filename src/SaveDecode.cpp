@@ -0,0 +1,288 @@
+#include "SaveDecode.hpp"
+#include <array>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define BACKUPS_DECODE_X86
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+    // Kernels are compiled for their instruction set no matter what the rest 
+    // of the mod targets, and only called if the CPU supports it
+    #if defined(__clang__) || defined(__GNUC__)
+        #define BACKUPS_TARGET(x) __attribute__((target(x)))
+    #else
+        #define BACKUPS_TARGET(x)
+    #endif
+#endif
+
+static constexpr uint8_t INVALID = 0xff;
+
+std::string_view cc::getDecodeKernelName(DecodeKernel kernel) {
+    switch (kernel) {
+        case DecodeKernel::AVX2: return "AVX2";
+        case DecodeKernel::SSE41: return "SSE4.1";
+        case DecodeKernel::Scalar: default: return "scalar";
+    }
+}
+
+#ifdef BACKUPS_DECODE_X86
+
+struct CPUFeatures final {
+    bool sse41 = false;
+    bool avx2 = false;
+};
+
+static void cpuid(int leaf, int subleaf, uint32_t (&regs)[4]) {
+#if defined(_MSC_VER)
+    int out[4];
+    __cpuidex(out, leaf, subleaf);
+    for (size_t i = 0; i < 4; i += 1) {
+        regs[i] = static_cast<uint32_t>(out[i]);
+    }
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+static uint64_t xgetbv() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+static CPUFeatures detectFeatures() {
+    auto features = CPUFeatures();
+    uint32_t regs[4];
+    cpuid(0, 0, regs);
+    auto maxLeaf = regs[0];
+    if (maxLeaf < 1) {
+        return features;
+    }
+    cpuid(1, 0, regs);
+    bool ssse3 = regs[2] & (1u << 9);
+    features.sse41 = ssse3 && (regs[2] & (1u << 19));
+    // AVX needs the OS to save the YMM registers too
+    bool osxsave = regs[2] & (1u << 27);
+    bool avx = regs[2] & (1u << 28);
+    if (maxLeaf >= 7 && osxsave && avx && (xgetbv() & 0x6) == 0x6) {
+        cpuid(7, 0, regs);
+        features.avx2 = regs[1] & (1u << 5);
+    }
+    return features;
+}
+static CPUFeatures const& getFeatures() {
+    static auto features = detectFeatures();
+    return features;
+}
+
+// Maps XORed base64 characters to their 6-bit values. Invalid characters 
+// make the whole block fall back to the scalar path, which reports them
+// Lambdas don't get the target of the function they're in, so this is a 
+// separate function
+BACKUPS_TARGET("ssse3,sse4.1")
+static inline __m128i inRangeSSE(__m128i chars, char lo, char hi) {
+    return _mm_and_si128(
+        _mm_cmpgt_epi8(chars, _mm_set1_epi8(lo - 1)),
+        _mm_cmplt_epi8(chars, _mm_set1_epi8(hi + 1))
+    );
+}
+BACKUPS_TARGET("ssse3,sse4.1")
+static inline __m128i decodeCharsSSE(__m128i chars, __m128i& invalid) {
+    auto upper = inRangeSSE(chars, 'A', 'Z');
+    auto lower = inRangeSSE(chars, 'a', 'z');
+    auto digit = inRangeSSE(chars, '0', '9');
+    auto dash = _mm_cmpeq_epi8(chars, _mm_set1_epi8('-'));
+    auto underscore = _mm_cmpeq_epi8(chars, _mm_set1_epi8('_'));
+
+    auto shift = _mm_and_si128(upper, _mm_set1_epi8(-65));
+    shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(-71)));
+    shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(4)));
+    shift = _mm_or_si128(shift, _mm_and_si128(dash, _mm_set1_epi8(62 - '-')));
+    shift = _mm_or_si128(shift, _mm_and_si128(underscore, _mm_set1_epi8(63 - '_')));
+
+    auto valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(dash, underscore)));
+    invalid = _mm_or_si128(invalid, _mm_xor_si128(valid, _mm_set1_epi8(-1)));
+    return _mm_add_epi8(chars, shift);
+}
+
+// Packs every 4 6-bit values into 3 bytes
+BACKUPS_TARGET("ssse3,sse4.1")
+static inline __m128i packSSE(__m128i values) {
+    auto merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    auto packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+// Each block writes 16 bytes but only advances by 12, which is fine since 
+// the output never catches up with the input and `out` is as big as `in`
+BACKUPS_TARGET("ssse3,sse4.1")
+static size_t decodeSSE41(uint8_t const* in, size_t size, uint8_t* out, uint8_t key, size_t& written) {
+    auto keys = _mm_set1_epi8(static_cast<char>(key));
+    size_t pos = 0;
+    while (pos + 16 <= size) {
+        auto chars = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<__m128i const*>(in + pos)), keys);
+        auto invalid = _mm_setzero_si128();
+        auto values = decodeCharsSSE(chars, invalid);
+        if (!_mm_testz_si128(invalid, invalid)) {
+            break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + written), packSSE(values));
+        pos += 16;
+        written += 12;
+    }
+    return pos;
+}
+
+BACKUPS_TARGET("avx2")
+static inline __m256i inRangeAVX2(__m256i chars, char lo, char hi) {
+    return _mm256_and_si256(
+        _mm256_cmpgt_epi8(chars, _mm256_set1_epi8(lo - 1)),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), chars)
+    );
+}
+BACKUPS_TARGET("avx2")
+static inline __m256i decodeCharsAVX2(__m256i chars, __m256i& invalid) {
+    auto upper = inRangeAVX2(chars, 'A', 'Z');
+    auto lower = inRangeAVX2(chars, 'a', 'z');
+    auto digit = inRangeAVX2(chars, '0', '9');
+    auto dash = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('-'));
+    auto underscore = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('_'));
+
+    auto shift = _mm256_and_si256(upper, _mm256_set1_epi8(-65));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(lower, _mm256_set1_epi8(-71)));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(digit, _mm256_set1_epi8(4)));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(dash, _mm256_set1_epi8(62 - '-')));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(underscore, _mm256_set1_epi8(63 - '_')));
+
+    auto valid = _mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, _mm256_or_si256(dash, underscore)));
+    invalid = _mm256_or_si256(invalid, _mm256_xor_si256(valid, _mm256_set1_epi8(-1)));
+    return _mm256_add_epi8(chars, shift);
+}
+
+BACKUPS_TARGET("avx2")
+static size_t decodeAVX2(uint8_t const* in, size_t size, uint8_t* out, uint8_t key, size_t& written) {
+    auto keys = _mm256_set1_epi8(static_cast<char>(key));
+    size_t pos = 0;
+    while (pos + 32 <= size) {
+        auto chars = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(in + pos)), keys);
+        auto invalid = _mm256_setzero_si256();
+        auto values = decodeCharsAVX2(chars, invalid);
+        if (!_mm256_testz_si256(invalid, invalid)) {
+            break;
+        }
+        auto merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        auto packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        // Shuffles only work within each 128-bit half, so the 12 bytes of 
+        // each half are moved next to each other afterwards
+        packed = _mm256_shuffle_epi8(packed, _mm256_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+        ));
+        packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + written), packed);
+        pos += 32;
+        written += 24;
+    }
+    return pos;
+}
+
+#endif
+
+cc::DecodeKernel cc::getBestDecodeKernel() {
+#ifdef BACKUPS_DECODE_X86
+    if (getFeatures().avx2) {
+        return DecodeKernel::AVX2;
+    }
+    if (getFeatures().sse41) {
+        return DecodeKernel::SSE41;
+    }
+#endif
+    return DecodeKernel::Scalar;
+}
+bool cc::isDecodeKernelSupported(DecodeKernel kernel) {
+    switch (kernel) {
+#ifdef BACKUPS_DECODE_X86
+        case DecodeKernel::AVX2: return getFeatures().avx2;
+        case DecodeKernel::SSE41: return getFeatures().sse41;
+#endif
+        case DecodeKernel::Scalar: return true;
+        default: return false;
+    }
+}
+
+static constexpr std::array<uint8_t, 256> makeDecodeTable() {
+    std::array<uint8_t, 256> table {};
+    for (auto& value : table) {
+        value = INVALID;
+    }
+    for (uint8_t i = 0; i < 26; i += 1) {
+        table['A' + i] = i;
+        table['a' + i] = 26 + i;
+    }
+    for (uint8_t i = 0; i < 10; i += 1) {
+        table['0' + i] = 52 + i;
+    }
+    table['-'] = 62;
+    table['_'] = 63;
+    return table;
+}
+static constexpr auto DECODE_TABLE = makeDecodeTable();
+
+static bool isPadding(uint8_t c) {
+    return c == '=' || c == '\0' || c == '\n' || c == '\r' || c == ' ';
+}
+
+Result<size_t> cc::decodeXorBase64(
+    uint8_t const* in, size_t size, uint8_t* out, uint8_t key, DecodeKernel kernel
+) {
+    while (size > 0 && isPadding(in[size - 1] ^ key)) {
+        size -= 1;
+    }
+
+    size_t pos = 0;
+    size_t written = 0;
+#ifdef BACKUPS_DECODE_X86
+    if (kernel == DecodeKernel::AVX2 && getFeatures().avx2) {
+        pos = decodeAVX2(in, size, out, key, written);
+    }
+    else if (kernel != DecodeKernel::Scalar && getFeatures().sse41) {
+        pos = decodeSSE41(in, size, out, key, written);
+    }
+#endif
+
+    // Whatever is left over (or everything, without SIMD)
+    uint32_t bits = 0;
+    size_t count = 0;
+    for (; pos < size; pos += 1) {
+        auto value = DECODE_TABLE[in[pos] ^ key];
+        if (value == INVALID) {
+            return Err("Invalid base64 character at offset {}", pos);
+        }
+        bits = (bits << 6) | value;
+        count += 1;
+        if (count == 4) {
+            out[written] = static_cast<uint8_t>(bits >> 16);
+            out[written + 1] = static_cast<uint8_t>(bits >> 8);
+            out[written + 2] = static_cast<uint8_t>(bits);
+            written += 3;
+            bits = 0;
+            count = 0;
+        }
+    }
+    if (count == 1) {
+        return Err("Base64 data is truncated");
+    }
+    if (count == 2) {
+        out[written++] = static_cast<uint8_t>(bits >> 4);
+    }
+    else if (count == 3) {
+        out[written++] = static_cast<uint8_t>(bits >> 10);
+        out[written++] = static_cast<uint8_t>(bits >> 2);
+    }
+    return Ok(written);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Platform.hpp"
+#include <cstdint>
+#include <string_view>
+
+using namespace geode::prelude;
+
+// GD's save files are XORed with a key, then URL-safe base64 encoded, then 
+// gzipped. These undo the first two in a single pass, which is most of the 
+// work besides inflating for saves that are hundreds of MB
+namespace cc {
+    enum class DecodeKernel {
+        Scalar,
+        // 16 bytes at a time; needs SSSE3 and SSE4.1
+        SSE41,
+        // 32 bytes at a time
+        AVX2,
+    };
+
+    std::string_view getDecodeKernelName(DecodeKernel kernel);
+    // Fastest kernel the CPU supports, detected once
+    DecodeKernel getBestDecodeKernel();
+    bool isDecodeKernelSupported(DecodeKernel kernel);
+
+    // Decode XORed base64 from `in` into `out`, returning the amount of bytes 
+    // written. `out` must have room for at least `size` bytes and may be the 
+    // same as `in` to decode in place. Trailing padding is ignored
+    Result<size_t> decodeXorBase64(
+        uint8_t const* in, size_t size, uint8_t* out, uint8_t key,
+        DecodeKernel kernel = getBestDecodeKernel()
+    );
+}
@@ -0,0 +1,473 @@
+#include "Storage.hpp"
+#include "FastCopy.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+std::shared_ptr<Storage> Storage::local() {
+    static auto storage = std::make_shared<LocalStorage>();
+    return storage;
+}
+
+static std::string getErrorMessage(std::error_code const& ec) {
+    return fmt::format("{} (code {})", ec.message(), ec.value());
+}
+
+namespace {
+    class LocalReader final : public StorageReader {
+    private:
+        std::ifstream m_file;
+
+    public:
+        LocalReader(std::ifstream&& file) : m_file(std::move(file)) {}
+
+        size_t read(void* data, size_t size) override {
+            m_file.read(static_cast<char*>(data), size);
+            return static_cast<size_t>(m_file.gcount());
+        }
+    };
+
+    class MemoryReader final : public StorageReader {
+    private:
+        // Kept alive even if the file is replaced while it's being read
+        std::shared_ptr<std::string const> m_data;
+        size_t m_offset = 0;
+
+    public:
+        MemoryReader(std::shared_ptr<std::string const> data) : m_data(std::move(data)) {}
+
+        size_t read(void* data, size_t size) override {
+            auto read = std::min(size, m_data->size() - m_offset);
+            std::memcpy(data, m_data->data() + m_offset, read);
+            m_offset += read;
+            return read;
+        }
+    };
+}
+
+bool LocalStorage::exists(std::filesystem::path const& path) const {
+    std::error_code ec;
+    return std::filesystem::exists(path, ec);
+}
+bool LocalStorage::isDirectory(std::filesystem::path const& path) const {
+    std::error_code ec;
+    return std::filesystem::is_directory(path, ec);
+}
+Result<std::vector<std::filesystem::path>> LocalStorage::list(std::filesystem::path const& dir) const {
+    return file::readDirectory(dir, false);
+}
+size_t LocalStorage::size(std::filesystem::path const& path) const {
+    std::error_code ec;
+    if (std::filesystem::is_regular_file(path, ec)) {
+        auto size = std::filesystem::file_size(path, ec);
+        return ec ? 0 : size;
+    }
+    // Walked one folder at a time so folders removed while this runs (by 
+    // backups being made or deleted meanwhile) are skipped instead of ending 
+    // the walk
+    size_t size = 0;
+    std::vector<std::filesystem::path> dirs { path };
+    while (!dirs.empty()) {
+        auto dir = std::move(dirs.back());
+        dirs.pop_back();
+        std::error_code iterEc;
+        auto it = std::filesystem::directory_iterator(dir, iterEc);
+        for (; !iterEc && it != std::filesystem::directory_iterator(); it.increment(iterEc)) {
+            if (it->is_symlink(ec)) {
+                continue;
+            }
+            if (it->is_directory(ec)) {
+                dirs.push_back(it->path());
+            }
+            else if (it->is_regular_file(ec)) {
+                auto fileSize = it->file_size(ec);
+                if (!ec) {
+                    size += fileSize;
+                }
+            }
+        }
+    }
+    return size;
+}
+std::optional<std::filesystem::file_time_type> LocalStorage::getWriteTime(std::filesystem::path const& path) const {
+    std::error_code ec;
+    auto time = std::filesystem::last_write_time(path, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+    return time;
+}
+
+Result<std::string> LocalStorage::read(std::filesystem::path const& path) const {
+    return file::readString(path);
+}
+Result<std::unique_ptr<StorageReader>> LocalStorage::open(std::filesystem::path const& path) const {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return Err("Unable to open {}", path.filename());
+    }
+    return Ok(std::make_unique<LocalReader>(std::move(file)));
+}
+Result<std::string> LocalStorage::readRange(std::filesystem::path const& path, size_t offset, size_t size) const {
+    std::ifstream file(path, std::ios::binary);
+    file.seekg(offset);
+    std::string data(size, '\0');
+    file.read(data.data(), size);
+    if (!file || static_cast<size_t>(file.gcount()) != size) {
+        return Err("Unable to read {}", path.filename());
+    }
+    return Ok(std::move(data));
+}
+
+// Backups being created at the same time can write the same chunk, so each 
+// write needs a temporary file of its own
+std::filesystem::path LocalStorage::getTmpPath(std::filesystem::path const& path) {
+    static auto const process = std::random_device()();
+    static std::atomic_size_t counter = 0;
+    auto tmp = path;
+    tmp += fmt::format(".{:08x}-{}.backups-tmp", process, counter++);
+    return tmp;
+}
+
+Result<> LocalStorage::write(std::filesystem::path const& path, std::string_view data) {
+    auto tmp = getTmpPath(path);
+    {
+        std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), data.size());
+        if (!file) {
+            std::error_code ec;
+            std::filesystem::remove(tmp, ec);
+            return Err("Unable to write {}", path.filename());
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        std::error_code rec;
+        std::filesystem::remove(tmp, rec);
+        return Err("Unable to write {}: {}", path.filename(), getErrorMessage(ec));
+    }
+    return Ok();
+}
+Result<> LocalStorage::patch(std::filesystem::path const& path, size_t offset, std::string_view data) {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(offset);
+    file.write(data.data(), data.size());
+    if (!file) {
+        return Err("Unable to write {}", path.filename());
+    }
+    return Ok();
+}
+Result<> LocalStorage::createDirectories(std::filesystem::path const& path) {
+    return file::createDirectoryAll(path);
+}
+Result<bool> LocalStorage::createDirectory(std::filesystem::path const& path) {
+    std::error_code ec;
+    auto created = std::filesystem::create_directory(path, ec);
+    if (ec) {
+        return Err("Unable to create {}: {}", path.filename(), getErrorMessage(ec));
+    }
+    return Ok(created);
+}
+Result<> LocalStorage::copy(std::filesystem::path const& from, std::filesystem::path const& to, bool overwrite) {
+    GEODE_UNWRAP_INTO(auto stats, fastcopy::copyFile(from, to, overwrite));
+    log::debug(
+        "Copied {} using {} ({} bytes)",
+        from.filename(), fastcopy::getStrategyName(stats.strategy), stats.bytes
+    );
+    return Ok();
+}
+std::error_code LocalStorage::rename(std::filesystem::path const& from, std::filesystem::path const& to) {
+    std::error_code ec;
+    std::filesystem::rename(from, to, ec);
+    return ec;
+}
+Result<> LocalStorage::remove(std::filesystem::path const& path) {
+    std::error_code ec;
+    std::filesystem::remove_all(path, ec);
+    if (ec) {
+        return Err("Unable to remove {}: {}", path.filename(), getErrorMessage(ec));
+    }
+    return Ok();
+}
+
+static std::filesystem::path normalize(std::filesystem::path const& path) {
+    auto normal = path.lexically_normal();
+    // "dir/" and "dir" are the same folder
+    if (!normal.has_filename() && normal.has_relative_path()) {
+        normal = normal.parent_path();
+    }
+    return normal;
+}
+// Whether the path is somewhere inside the folder, not counting the folder
+// itself
+static bool isInside(std::filesystem::path const& path, std::filesystem::path const& dir) {
+    auto [dirEnd, pathEnd] = std::mismatch(dir.begin(), dir.end(), path.begin(), path.end());
+    return dirEnd == dir.end() && pathEnd != path.end();
+}
+
+std::filesystem::file_time_type MemoryStorage::tick() {
+    // Every change has to be visible in the write time, even ones made
+    // faster than the clock updates
+    auto now = std::filesystem::file_time_type::clock::now();
+    if (now <= m_lastTime) {
+        now = m_lastTime + std::filesystem::file_time_type::duration(1);
+    }
+    m_lastTime = now;
+    return now;
+}
+void MemoryStorage::touchParent(std::filesystem::path const& path) {
+    auto parent = m_nodes.find(path.parent_path());
+    if (parent != m_nodes.end() && !parent->second.data) {
+        parent->second.time = this->tick();
+    }
+}
+MemoryStorage::Node const* MemoryStorage::find(std::filesystem::path const& path) const {
+    auto node = m_nodes.find(path);
+    return node != m_nodes.end() ? &node->second : nullptr;
+}
+Result<> MemoryStorage::setFile(std::filesystem::path const& path, std::shared_ptr<std::string const> data) {
+    auto parent = this->find(path.parent_path());
+    if (!parent || parent->data) {
+        return Err("Unable to write {}: the folder it's in doesn't exist", path.filename());
+    }
+    auto node = m_nodes.find(path);
+    if (node == m_nodes.end()) {
+        m_nodes.emplace(path, Node { .data = std::move(data), .time = this->tick() });
+        this->touchParent(path);
+        return Ok();
+    }
+    if (!node->second.data) {
+        return Err("Unable to write {}: it's a folder", path.filename());
+    }
+    node->second.data = std::move(data);
+    node->second.time = this->tick();
+    return Ok();
+}
+
+Result<> MemoryStorage::load(std::filesystem::path const& from, std::filesystem::path const& to) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(from, ec)) {
+        GEODE_UNWRAP_INTO(auto data, file::readString(from));
+        return this->write(to, data);
+    }
+    GEODE_UNWRAP(this->createDirectories(to));
+    auto it = std::filesystem::recursive_directory_iterator(from, ec);
+    for (; !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+        auto& entry = *it;
+        auto target = to / entry.path().lexically_relative(from);
+        if (entry.is_directory(ec)) {
+            GEODE_UNWRAP(this->createDirectories(target));
+        }
+        else {
+            GEODE_UNWRAP_INTO(auto data, file::readString(entry.path()));
+            GEODE_UNWRAP(this->write(target, data));
+        }
+    }
+    if (ec) {
+        return Err("Unable to read {}: {}", from, getErrorMessage(ec));
+    }
+    return Ok();
+}
+
+bool MemoryStorage::exists(std::filesystem::path const& path) const {
+    std::lock_guard lock(m_lock);
+    return this->find(normalize(path));
+}
+bool MemoryStorage::isDirectory(std::filesystem::path const& path) const {
+    std::lock_guard lock(m_lock);
+    auto node = this->find(normalize(path));
+    return node && !node->data;
+}
+Result<std::vector<std::filesystem::path>> MemoryStorage::list(std::filesystem::path const& dir) const {
+    std::lock_guard lock(m_lock);
+    auto key = normalize(dir);
+    auto node = this->find(key);
+    if (!node || node->data) {
+        return Err("Unable to read {}: not a folder", dir);
+    }
+    std::vector<std::filesystem::path> paths;
+    for (auto it = m_nodes.upper_bound(key); it != m_nodes.end() && isInside(it->first, key); ++it) {
+        if (it->first.parent_path() == key) {
+            paths.push_back(it->first);
+        }
+    }
+    return Ok(std::move(paths));
+}
+size_t MemoryStorage::size(std::filesystem::path const& path) const {
+    std::lock_guard lock(m_lock);
+    auto key = normalize(path);
+    auto node = this->find(key);
+    if (!node) {
+        return 0;
+    }
+    if (node->data) {
+        return node->data->size();
+    }
+    size_t size = 0;
+    for (auto it = m_nodes.upper_bound(key); it != m_nodes.end() && isInside(it->first, key); ++it) {
+        if (it->second.data) {
+            size += it->second.data->size();
+        }
+    }
+    return size;
+}
+std::optional<std::filesystem::file_time_type> MemoryStorage::getWriteTime(std::filesystem::path const& path) const {
+    std::lock_guard lock(m_lock);
+    auto node = this->find(normalize(path));
+    if (!node) {
+        return std::nullopt;
+    }
+    return node->time;
+}
+
+Result<std::string> MemoryStorage::read(std::filesystem::path const& path) const {
+    std::lock_guard lock(m_lock);
+    auto node = this->find(normalize(path));
+    if (!node || !node->data) {
+        return Err("Unable to open {}", path.filename());
+    }
+    return Ok(*node->data);
+}
+Result<std::unique_ptr<StorageReader>> MemoryStorage::open(std::filesystem::path const& path) const {
+    std::lock_guard lock(m_lock);
+    auto node = this->find(normalize(path));
+    if (!node || !node->data) {
+        return Err("Unable to open {}", path.filename());
+    }
+    return Ok(std::make_unique<MemoryReader>(node->data));
+}
+Result<std::string> MemoryStorage::readRange(std::filesystem::path const& path, size_t offset, size_t size) const {
+    std::lock_guard lock(m_lock);
+    auto node = this->find(normalize(path));
+    if (!node || !node->data || offset > node->data->size() || size > node->data->size() - offset) {
+        return Err("Unable to read {}", path.filename());
+    }
+    return Ok(node->data->substr(offset, size));
+}
+
+Result<> MemoryStorage::write(std::filesystem::path const& path, std::string_view data) {
+    auto copy = std::make_shared<std::string const>(data);
+    std::lock_guard lock(m_lock);
+    return this->setFile(normalize(path), std::move(copy));
+}
+Result<> MemoryStorage::patch(std::filesystem::path const& path, size_t offset, std::string_view data) {
+    std::lock_guard lock(m_lock);
+    auto node = m_nodes.find(normalize(path));
+    if (node == m_nodes.end() || !node->second.data || offset + data.size() > node->second.data->size()) {
+        return Err("Unable to write {}", path.filename());
+    }
+    // Readers and copies may still be using the old data
+    auto patched = std::make_shared<std::string>(*node->second.data);
+    patched->replace(offset, data.size(), data);
+    node->second.data = std::move(patched);
+    node->second.time = this->tick();
+    return Ok();
+}
+Result<> MemoryStorage::createDirectories(std::filesystem::path const& path) {
+    std::lock_guard lock(m_lock);
+    std::filesystem::path current;
+    for (auto& part : normalize(path)) {
+        current /= part;
+        auto node = m_nodes.find(current);
+        if (node == m_nodes.end()) {
+            m_nodes.emplace(current, Node { .data = nullptr, .time = this->tick() });
+            this->touchParent(current);
+        }
+        else if (node->second.data) {
+            return Err("Unable to create {}: {} is a file", path, current);
+        }
+    }
+    return Ok();
+}
+Result<bool> MemoryStorage::createDirectory(std::filesystem::path const& path) {
+    std::lock_guard lock(m_lock);
+    auto key = normalize(path);
+    if (this->find(key)) {
+        return Ok(false);
+    }
+    auto parent = this->find(key.parent_path());
+    if (!parent || parent->data) {
+        return Err("Unable to create {}: the folder it's in doesn't exist", path.filename());
+    }
+    m_nodes.emplace(key, Node { .data = nullptr, .time = this->tick() });
+    this->touchParent(key);
+    return Ok(true);
+}
+Result<> MemoryStorage::copy(std::filesystem::path const& from, std::filesystem::path const& to, bool overwrite) {
+    std::lock_guard lock(m_lock);
+    auto source = this->find(normalize(from));
+    if (!source || !source->data) {
+        return Err("Unable to open {}", from.filename());
+    }
+    auto target = normalize(to);
+    if (!overwrite && this->find(target)) {
+        return Err("Unable to copy to {}: it already exists", to.filename());
+    }
+    return this->setFile(target, source->data);
+}
+std::error_code MemoryStorage::rename(std::filesystem::path const& from, std::filesystem::path const& to) {
+    std::lock_guard lock(m_lock);
+    auto source = normalize(from);
+    auto target = normalize(to);
+    if (source == target) {
+        return std::error_code();
+    }
+    auto node = m_nodes.find(source);
+    auto parent = this->find(target.parent_path());
+    if (node == m_nodes.end() || !parent || parent->data) {
+        return std::make_error_code(std::errc::no_such_file_or_directory);
+    }
+    if (isInside(target, source)) {
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+    // Same rules as the OS: folders can only replace empty folders, and
+    // files can only replace files
+    if (auto existing = m_nodes.find(target); existing != m_nodes.end()) {
+        if (!existing->second.data != !node->second.data) {
+            return std::make_error_code(
+                existing->second.data ? std::errc::not_a_directory : std::errc::is_a_directory
+            );
+        }
+        auto next = std::next(existing);
+        if (next != m_nodes.end() && isInside(next->first, target)) {
+            return std::make_error_code(std::errc::directory_not_empty);
+        }
+        m_nodes.erase(existing);
+    }
+
+    std::vector<std::pair<std::filesystem::path, Node>> moved;
+    auto end = std::next(node);
+    while (end != m_nodes.end() && isInside(end->first, source)) {
+        ++end;
+    }
+    for (auto it = node; it != end; ++it) {
+        moved.emplace_back(target / it->first.lexically_relative(source), std::move(it->second));
+    }
+    // "." for the moved path itself
+    moved.front().first = target;
+    m_nodes.erase(node, end);
+    for (auto& [path, moving] : moved) {
+        m_nodes.emplace(std::move(path), std::move(moving));
+    }
+    this->touchParent(source);
+    this->touchParent(target);
+    return std::error_code();
+}
+Result<> MemoryStorage::remove(std::filesystem::path const& path) {
+    std::lock_guard lock(m_lock);
+    auto key = normalize(path);
+    auto node = m_nodes.find(key);
+    if (node == m_nodes.end()) {
+        return Ok();
+    }
+    auto end = std::next(node);
+    while (end != m_nodes.end() && isInside(end->first, key)) {
+        ++end;
+    }
+    m_nodes.erase(node, end);
+    this->touchParent(key);
+    return Ok();
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "Platform.hpp"
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+using namespace geode::prelude;
+
+// Reads a file a piece at a time
+class StorageReader {
+public:
+	virtual ~StorageReader() = default;
+
+	// Returns how many bytes were read, which is only less than asked for
+	// once the end of the file is reached
+	virtual size_t read(void* data, size_t size) = 0;
+};
+
+// Where backups and the save files they're made from are kept. The backup
+// core only touches files through this, so backups can be stored somewhere
+// other than a local folder, and benchmarks can leave the disk out of what
+// they measure. Everything can be called from any thread
+class Storage {
+public:
+	virtual ~Storage() = default;
+
+	virtual bool exists(std::filesystem::path const& path) const = 0;
+	virtual bool isDirectory(std::filesystem::path const& path) const = 0;
+	// Files and folders directly inside a folder
+	virtual Result<std::vector<std::filesystem::path>> list(std::filesystem::path const& dir) const = 0;
+	// Size of a file, or of every file inside a folder. 0 if it's missing
+	virtual size_t size(std::filesystem::path const& path) const = 0;
+	// A folder's write time changes whenever something is added to, removed
+	// from or renamed inside it
+	virtual std::optional<std::filesystem::file_time_type> getWriteTime(std::filesystem::path const& path) const = 0;
+
+	virtual Result<std::string> read(std::filesystem::path const& path) const = 0;
+	virtual Result<std::unique_ptr<StorageReader>> open(std::filesystem::path const& path) const = 0;
+	// Reads only part of a file. Fails if the file is shorter than that
+	virtual Result<std::string> readRange(std::filesystem::path const& path, size_t offset, size_t size) const = 0;
+
+	// The folder has to exist already. The file is replaced all at once, so
+	// it's never left half-written
+	virtual Result<> write(std::filesystem::path const& path, std::string_view data) = 0;
+	// Overwrites part of an existing file in place, which unlike write
+	// doesn't change the write time of the folder it's in
+	virtual Result<> patch(std::filesystem::path const& path, size_t offset, std::string_view data) = 0;
+	virtual Result<> createDirectories(std::filesystem::path const& path) = 0;
+	// Creates a single folder inside an existing one. Returns false if 
+	// something is already there, in one step so two callers can't both 
+	// think they created the same folder
+	virtual Result<bool> createDirectory(std::filesystem::path const& path) = 0;
+	// When overwriting, the target is replaced all at once like with write
+	virtual Result<> copy(std::filesystem::path const& from, std::filesystem::path const& to, bool overwrite = false) = 0;
+	// Returns the error as-is so moves across drives can be told apart
+	virtual std::error_code rename(std::filesystem::path const& from, std::filesystem::path const& to) = 0;
+	// Removes a file or a whole folder. Missing ones are fine
+	virtual Result<> remove(std::filesystem::path const& path) = 0;
+
+	// Files on this computer
+	static std::shared_ptr<Storage> local();
+};
+
+class LocalStorage final : public Storage {
+public:
+	// Temporary file next to a file for replacing it all at once. Unique 
+	// every call, so writes to the same file at the same time don't clash
+	static std::filesystem::path getTmpPath(std::filesystem::path const& path);
+
+	bool exists(std::filesystem::path const& path) const override;
+	bool isDirectory(std::filesystem::path const& path) const override;
+	Result<std::vector<std::filesystem::path>> list(std::filesystem::path const& dir) const override;
+	size_t size(std::filesystem::path const& path) const override;
+	std::optional<std::filesystem::file_time_type> getWriteTime(std::filesystem::path const& path) const override;
+
+	Result<std::string> read(std::filesystem::path const& path) const override;
+	Result<std::unique_ptr<StorageReader>> open(std::filesystem::path const& path) const override;
+	Result<std::string> readRange(std::filesystem::path const& path, size_t offset, size_t size) const override;
+
+	Result<> write(std::filesystem::path const& path, std::string_view data) override;
+	Result<> patch(std::filesystem::path const& path, size_t offset, std::string_view data) override;
+	Result<> createDirectories(std::filesystem::path const& path) override;
+	Result<bool> createDirectory(std::filesystem::path const& path) override;
+	Result<> copy(std::filesystem::path const& from, std::filesystem::path const& to, bool overwrite = false) override;
+	std::error_code rename(std::filesystem::path const& from, std::filesystem::path const& to) override;
+	Result<> remove(std::filesystem::path const& path) override;
+};
+
+// Keeps everything in memory, for measuring how much of the time spent on
+// backups isn't spent waiting on the disk. Paths are compared as written
+// (after normalizing), so stick to absolute ones. Copies share their data
+// until one of them is written to, same as a reflink
+class MemoryStorage final : public Storage {
+private:
+	struct Node final {
+		// Null for folders
+		std::shared_ptr<std::string const> data;
+		std::filesystem::file_time_type time;
+	};
+
+	mutable std::mutex m_lock;
+	// Sorted by path, so everything inside a folder comes right after it
+	std::map<std::filesystem::path, Node> m_nodes;
+	std::filesystem::file_time_type m_lastTime;
+
+	std::filesystem::file_time_type tick();
+	// Updates the write time of the folder the path is in
+	void touchParent(std::filesystem::path const& path);
+	Result<> setFile(std::filesystem::path const& path, std::shared_ptr<std::string const> data);
+	Node const* find(std::filesystem::path const& path) const;
+
+public:
+	// Copy a file or folder from this computer, e.g. the saves to back up
+	Result<> load(std::filesystem::path const& from, std::filesystem::path const& to);
+
+	bool exists(std::filesystem::path const& path) const override;
+	bool isDirectory(std::filesystem::path const& path) const override;
+	Result<std::vector<std::filesystem::path>> list(std::filesystem::path const& dir) const override;
+	size_t size(std::filesystem::path const& path) const override;
+	std::optional<std::filesystem::file_time_type> getWriteTime(std::filesystem::path const& path) const override;
+
+	Result<std::string> read(std::filesystem::path const& path) const override;
+	Result<std::unique_ptr<StorageReader>> open(std::filesystem::path const& path) const override;
+	Result<std::string> readRange(std::filesystem::path const& path, size_t offset, size_t size) const override;
+
+	Result<> write(std::filesystem::path const& path, std::string_view data) override;
+	Result<> patch(std::filesystem::path const& path, size_t offset, std::string_view data) override;
+	Result<> createDirectories(std::filesystem::path const& path) override;
+	Result<bool> createDirectory(std::filesystem::path const& path) override;
+	Result<> copy(std::filesystem::path const& from, std::filesystem::path const& to, bool overwrite = false) override;
+	std::error_code rename(std::filesystem::path const& from, std::filesystem::path const& to) override;
+	Result<> remove(std::filesystem::path const& path) override;
+};
@@ -0,0 +1,158 @@
+#include "Zstd.hpp"
+#include <zstd.h>
+#include <zdict.h>
+#include <memory>
+#include <vector>
+
+// Saves are way bigger than what dictionaries are usually trained for, so 
+// the dictionary mostly helps with the start of each level string
+static constexpr size_t DICT_SIZE = 112 * 1024;
+static constexpr size_t SAMPLE_SIZE = 8 * 1024;
+static constexpr size_t MAX_SAMPLES = 1024;
+
+struct FreeCCtx {
+    void operator()(ZSTD_CCtx* ctx) const {
+        ZSTD_freeCCtx(ctx);
+    }
+};
+struct FreeDCtx {
+    void operator()(ZSTD_DCtx* ctx) const {
+        ZSTD_freeDCtx(ctx);
+    }
+};
+
+Result<std::string> zstd::compress(std::string_view data, int level, std::string_view dict) {
+    auto ctx = std::unique_ptr<ZSTD_CCtx, FreeCCtx>(ZSTD_createCCtx());
+    if (!ctx) {
+        return Err("Unable to create zstd context");
+    }
+    ZSTD_CCtx_setParameter(ctx.get(), ZSTD_c_compressionLevel, level);
+    // Backups are meant to be kept for a long time, so catch bit rot
+    ZSTD_CCtx_setParameter(ctx.get(), ZSTD_c_checksumFlag, 1);
+    if (!dict.empty()) {
+        auto res = ZSTD_CCtx_loadDictionary(ctx.get(), dict.data(), dict.size());
+        if (ZSTD_isError(res)) {
+            return Err("Unable to load zstd dictionary: {}", ZSTD_getErrorName(res));
+        }
+    }
+    std::string out;
+    out.resize(ZSTD_compressBound(data.size()));
+    auto size = ZSTD_compress2(ctx.get(), out.data(), out.size(), data.data(), data.size());
+    if (ZSTD_isError(size)) {
+        return Err("Unable to compress: {}", ZSTD_getErrorName(size));
+    }
+    out.resize(size);
+    return Ok(std::move(out));
+}
+
+Result<std::string> zstd::decompress(std::string_view frame, std::string_view dict) {
+    // Frames are always written in one go, so they know their size
+    auto contentSize = ZSTD_getFrameContentSize(frame.data(), frame.size());
+    if (contentSize == ZSTD_CONTENTSIZE_ERROR || contentSize == ZSTD_CONTENTSIZE_UNKNOWN) {
+        return Err("Not a zstd frame");
+    }
+    auto ctx = std::unique_ptr<ZSTD_DCtx, FreeDCtx>(ZSTD_createDCtx());
+    if (!ctx) {
+        return Err("Unable to create zstd context");
+    }
+    if (!dict.empty()) {
+        auto res = ZSTD_DCtx_loadDictionary(ctx.get(), dict.data(), dict.size());
+        if (ZSTD_isError(res)) {
+            return Err("Unable to load zstd dictionary: {}", ZSTD_getErrorName(res));
+        }
+    }
+    std::string out;
+    out.resize(static_cast<size_t>(contentSize));
+    auto size = ZSTD_decompressDCtx(ctx.get(), out.data(), out.size(), frame.data(), frame.size());
+    if (ZSTD_isError(size)) {
+        return Err("Unable to decompress: {}", ZSTD_getErrorName(size));
+    }
+    if (size != out.size()) {
+        return Err("Unable to decompress: frame is truncated");
+    }
+    return Ok(std::move(out));
+}
+
+uint32_t zstd::getDictID(std::string_view frame) {
+    return ZSTD_getDictID_fromFrame(frame.data(), frame.size());
+}
+
+static std::filesystem::path getDictionaryPath(std::filesystem::path const& backupsDir, uint32_t id) {
+    return backupsDir / zstd::DICTS_DIR / fmt::format("{:08x}.dict", id);
+}
+
+Result<std::string> zstd::loadDictionary(Storage const& storage, std::filesystem::path const& backupsDir, uint32_t id) {
+    auto res = storage.read(getDictionaryPath(backupsDir, id));
+    if (!res) {
+        return Err("Missing zstd dictionary {:08x}", id);
+    }
+    return res;
+}
+
+Result<std::string> zstd::getDictionary(Storage& storage, std::filesystem::path const& backupsDir, std::string_view sample) {
+    std::optional<std::filesystem::path> newest;
+    std::filesystem::file_time_type newestTime;
+    if (storage.isDirectory(backupsDir / DICTS_DIR)) {
+        for (auto path : storage.list(backupsDir / DICTS_DIR).unwrapOrDefault()) {
+            auto time = storage.getWriteTime(path).value_or(std::filesystem::file_time_type());
+            if (path.extension() == ".dict" && (!newest || time > newestTime)) {
+                newest = path;
+                newestTime = time;
+            }
+        }
+    }
+    if (newest) {
+        return storage.read(*newest);
+    }
+
+    // Samples are spread out over the whole save so the dictionary isn't 
+    // just the first few levels
+    std::vector<size_t> sizes;
+    std::string samples;
+    auto count = std::min(MAX_SAMPLES, sample.size() / SAMPLE_SIZE);
+    if (count < 16) {
+        return Err("Not enough save data to train a dictionary");
+    }
+    auto stride = sample.size() / count;
+    for (size_t i = 0; i < count; i += 1) {
+        samples.append(sample.substr(i * stride, SAMPLE_SIZE));
+        sizes.push_back(SAMPLE_SIZE);
+    }
+    std::string dict;
+    dict.resize(DICT_SIZE);
+    auto size = ZDICT_trainFromBuffer(
+        dict.data(), dict.size(), samples.data(), sizes.data(), static_cast<unsigned>(sizes.size())
+    );
+    if (ZDICT_isError(size)) {
+        return Err("Unable to train dictionary: {}", ZDICT_getErrorName(size));
+    }
+    dict.resize(size);
+
+    auto id = ZDICT_getDictID(dict.data(), dict.size());
+    GEODE_UNWRAP(storage.createDirectories(backupsDir / DICTS_DIR));
+    auto res = storage.write(getDictionaryPath(backupsDir, id), dict);
+    if (!res) {
+        return Err("Unable to save dictionary: {}", res.unwrapErr());
+    }
+    log::info("Trained zstd dictionary {:08x} ({} bytes)", id, dict.size());
+    return Ok(std::move(dict));
+}
+
+Result<> zstd::importDictionaries(Storage& storage, std::filesystem::path const& from, std::filesystem::path const& to) {
+    if (!storage.isDirectory(from / DICTS_DIR)) {
+        return Ok();
+    }
+    GEODE_UNWRAP(storage.createDirectories(to / DICTS_DIR));
+    for (auto path : storage.list(from / DICTS_DIR).unwrapOrDefault()) {
+        // Dictionaries are named by their id, so existing ones are the same
+        auto target = to / DICTS_DIR / path.filename();
+        if (path.extension() != ".dict" || storage.exists(target)) {
+            continue;
+        }
+        auto res = storage.copy(path, target);
+        if (!res) {
+            return Err("Unable to copy {}: {}", path.filename(), res.unwrapErr());
+        }
+    }
+    return Ok();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Platform.hpp"
+#include "Storage.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+using namespace geode::prelude;
+
+// Save data stored as zstd-compressed XML instead of in GD's own format, 
+// which is gzip on top of base64 and so both larger and slower to read
+namespace zstd {
+    constexpr std::string_view EXT = ".zst";
+    // Dictionaries are stored by id next to the backups, since every backup 
+    // needs the one it was compressed with for as long as it exists
+    constexpr std::string_view DICTS_DIR = ".zstd-dicts";
+
+    Result<std::string> compress(std::string_view data, int level, std::string_view dict = {});
+    Result<std::string> decompress(std::string_view frame, std::string_view dict = {});
+    // Id of the dictionary a frame was compressed with, or 0 if none was used
+    uint32_t getDictID(std::string_view frame);
+
+    Result<std::string> loadDictionary(Storage const& storage, std::filesystem::path const& backupsDir, uint32_t id);
+    // Returns the newest dictionary in the backups directory, training one 
+    // from the given save data first if there isn't any
+    Result<std::string> getDictionary(Storage& storage, std::filesystem::path const& backupsDir, std::string_view sample);
+    // Copy over dictionaries that are missing from another backups directory
+    Result<> importDictionaries(Storage& storage, std::filesystem::path const& from, std::filesystem::path const& to);
+}
@@ -19,9 +19,57 @@ static std::chrono::hours backupRateToHours(std::string const& rate) {
 	}
 }
 
+class ShowMoveProgress : public CCAction {
+protected:
+	std::shared_ptr<ImportProgress> m_progress;
+
+public:
+	static ShowMoveProgress* create(std::shared_ptr<ImportProgress> progress) {
+		auto ret = new ShowMoveProgress();
+		ret->m_progress = progress;
+		ret->autorelease();
+		return ret;
+	}
+	void step(float) override {
+		static_cast<Notification*>(m_pTarget)->setString(fmt::format(
+			"Moving backups... {}/{} ({:.1f} MB/s)",
+			m_progress->getImported() + m_progress->getFailed(), m_progress->getFound(),
+			m_progress->getCopySpeed() / 1'000'000
+		));
+	}
+	bool isDone() override {
+		return m_progress->isFinished();
+	}
+};
+
+// Moving to another drive can take a while, so show how it's going
+template <class F>
+static void showBackupsMove(F&& startMove) {
+	auto notification = Ref(Notification::create("Moving backups...", NotificationIcon::Loading, 0));
+	auto progress = startMove([notification](ImportSummary summary) {
+		if (summary.failed) {
+			notification->setString(fmt::format(
+				"Moved {} backups ({} failed, see logs)", summary.imported, summary.failed
+			));
+			notification->setIcon(NotificationIcon::Error);
+		}
+		else {
+			notification->setString(fmt::format("Moved {} backups", summary.imported));
+			notification->setIcon(NotificationIcon::Success);
+		}
+		notification->setTime(2.f);
+	});
+	if (progress) {
+		notification->runAction(ShowMoveProgress::create(progress));
+		notification->show();
+	}
+}
+
 $execute {
 	listenForSettingChanges<std::filesystem::path>("backup-directory", +[](std::filesystem::path dir) {
-		(void)Backups::get()->updateBackupsDirectory(dir);
+		showBackupsMove([dir](auto onFinished) {
+			return Backups::get()->updateBackupsDirectory(dir, std::move(onFinished));
+		});
 	});
 }
 
@@ -89,37 +137,31 @@ class $modify(MenuLayer) {
 			alert->show();
 		}
 
-		auto backupRate = Mod::get()->template getSettingValue<std::string>("auto-local-backup-rate");
-		if (backupRate == "Never") {
-			return true;
+		static bool checkedMove = false;
+		if (!checkedMove) {
+			checkedMove = true;
+			showBackupsMove([](auto onFinished) {
+				return Backups::get()->resumeDirectoryMove(std::move(onFinished));
+			});
 		}
 
-		// Restoring a backup in old versions resulted in the new backup being 
-		// nested inside the old one
-		Backups::get()->fixNestedBackups();
-
-		// Backups is sorted from latest to oldest
-		auto backups = Backups::get()->getAllBackups();
-		if (backups.size() && backups.front()->getTimeSince() < backupRateToHours(backupRate)) {
+		auto backupRate = Mod::get()->template getSettingValue<std::string>("auto-local-backup-rate");
+		if (backupRate == "Never") {
 			return true;
 		}
 
-		// Try cleaning up automated backups. If this fails, not a big deal honestly
-		auto cleanup = Backups::get()->cleanupAutomated();
-		if (!cleanup) {
-			log::error("Unable to clean up automated backups: {}", cleanup.unwrapErr());
-		}
-
-		// Create new backup
-		auto res = Backups::get()->createBackup(true);
-		if (res) {
-			log::info("Backed up CCGameManager & CCLocalLevels");
-			Notification::create("Save Data has been Backed Up!", NotificationIcon::Success)->show();
-		}
-		else {
-			log::error("Backup failed: {}", res.unwrapErr());
-			Notification::create("Failed to back up Save Data", NotificationIcon::Error)->show();
-		}
+		// The save files are backed up on a background thread so entering the 
+		// menu isn't held up by it
+		Backups::get()->startAutoBackup(backupRateToHours(backupRate), [](Result<> res) {
+			if (res) {
+				log::info("Backed up CCGameManager & CCLocalLevels");
+				Notification::create("Save Data has been Backed Up!", NotificationIcon::Success)->show();
+			}
+			else {
+				log::error("Backup failed: {}", res.unwrapErr());
+				Notification::create("Failed to back up Save Data", NotificationIcon::Error)->show();
+			}
+		});
 
 		return true;
 	}